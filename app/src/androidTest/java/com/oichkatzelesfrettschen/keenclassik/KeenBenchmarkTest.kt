@@ -62,6 +62,28 @@ class KeenBenchmarkTest {
         }
     }
 
+    /*
+     * Generation latency on large grids; targets are in docs/perf/README.md.
+     * Each iteration draws a new seed, so this measures the mean over puzzles.
+     */
+    private fun benchmarkGenerate(size: Int, diff: Int) {
+        val builder = KeenModelBuilder()
+        var seed = 1L
+        benchmarkRule.measureRepeated {
+            builder.build(size, diff, 0, seed++)
+                ?: error("Generation failed: ${builder.lastJniError}")
+        }
+    }
+
+    @Test
+    fun benchmarkGenerate12x12Easy() = benchmarkGenerate(12, 0)
+
+    @Test
+    fun benchmarkGenerate12x12Normal() = benchmarkGenerate(12, 1)
+
+    @Test
+    fun benchmarkGenerate16x16Normal() = benchmarkGenerate(16, 1)
+
     @Test
     fun perfMetricsHooks() {
         val context = InstrumentationRegistry.getInstrumentation().targetContext
@@ -165,8 +165,8 @@ class KeenActivity : AppCompatActivity() {
         val profileName = extras?.getString(MenuActivity.GAME_PROFILE) ?: KeenProfile.DEFAULT.name
         gameProfile = KeenProfile.fromName(profileName)
 
-        // Classik supports 3x3 to 9x9 grids.
-        if (size < 3 || size > 9) {
+        // Classik supports 3x3 to 16x16 grids.
+        if (size < 3 || size > KeenModel.MAX_SIZE) {
             Log.e("KEEN", "Got invalid game size, quitting...")
             setResult(RESULT_CANCELED)
             finish()
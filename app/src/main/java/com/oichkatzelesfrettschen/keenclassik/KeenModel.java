@@ -15,7 +15,7 @@ import java.util.Stack;
  */
 public class KeenModel {
 
-    public static final int MAX_SIZE = 9;
+    public static final int MAX_SIZE = 16;
 
     //holds the data about a single grid cell
     public static class GridCell
@@ -84,12 +84,13 @@ public class KeenModel {
     private static class CellState{
         /*
          * state pos 0: 0 = not final 1 = final
-         * state pos 1-9: 0 = false 1 = true
+         * state pos 1-16: 0 = false 1 = true (an int, as 16x16 notes
+         * need 17 bits)
          */
-        short state;
+        int state;
         short x,y;
 
-        CellState(short state, short x, short y){
+        CellState(int state, short x, short y){
             this.state = state;
             this.x = x;
             this.y = y;
@@ -204,24 +205,30 @@ public class KeenModel {
 
     //public methods that allow other classes to modify/view the variables
     public void addCurToUndo(short x, short y){
-        short state = 1;
+        int state = 1;
         GridCell curCell = gameGrid[x][y];
         if(curCell.finalGuessValue == -1) {
             state = 0;
             for (int i = 1; i <= curCell.guesses.length; ++i) {
                 if (curCell.guesses[i - 1]) {
-                    state |= (short) (1 << i);
+                    state |= 1 << i;
                 }
             }
         } else {
-            state |= (short) (1<<curCell.finalGuessValue);
+            state |= 1<<curCell.finalGuessValue;
         }
         CellState val = new CellState(state,x,y);
 
         undo.push(val);
     }
 
-    public void undoOneStep(){
+    /**
+     * Restore the most recently saved cell state.
+     *
+     * @return flat index (x * size + y) of the restored cell, or -1 if
+     *         there was nothing to undo
+     */
+    public int undoOneStep(){
         if(!undo.empty()) {
             CellState oldCell = undo.pop();
             short x = oldCell.x;
@@ -239,7 +246,9 @@ public class KeenModel {
                     }
                 }
             }
+            return x * size + y;
         }
+        return -1;
     }
 
     public short getActiveY(){return activeY;}
@@ -104,16 +104,19 @@ public class KeenModelBuilder {
         KeenModel.GridCell[][] cells = new KeenModel.GridCell[size][size];
         HashSet<Integer> diffZones = new HashSet<>();
 
-        for(int i = 0; i < levelAsString.length(); i+=3)
+        // Zone roots are zero-padded to the width of the largest cell index
+        int rootWidth = Math.max(2, String.valueOf(size * size - 1).length());
+
+        for(int i = 0; i < levelAsString.length(); i+=rootWidth+1)
         {
-            int dsfCount = Integer.parseInt(levelAsString.substring(i,i+2));
+            int dsfCount = Integer.parseInt(levelAsString.substring(i,i+rootWidth));
             diffZones.add(dsfCount);
 
-            if(levelAsString.charAt(i+2)==';')
+            if(levelAsString.charAt(i+rootWidth)==';')
             {
 
-                ZoneData = levelAsString.substring(0,i+3);
-                levelAsString = levelAsString.substring(i+3);
+                ZoneData = levelAsString.substring(0,i+rootWidth+1);
+                levelAsString = levelAsString.substring(i+rootWidth+1);
                 break;
             }
         }
@@ -181,9 +184,10 @@ public class KeenModelBuilder {
         for(int i = 0; i<size*size; ++i)
         {
 
-            int val = Integer.parseInt(levelAsString.substring(i,i+1));
-            int zone = Integer.parseInt(ZoneData.substring(0,2));
-            ZoneData = ZoneData.substring(3);
+            // Digits above 9 come as letters ('A' = 10)
+            int val = Character.digit(levelAsString.charAt(i), 36);
+            int zone = Integer.parseInt(ZoneData.substring(0,rootWidth));
+            ZoneData = ZoneData.substring(rootWidth+1);
 
             boolean exists = false;
             int zoneIndex = 0;
@@ -144,8 +144,13 @@ class MenuActivity : AppCompatActivity() {
             MenuScreen(
                 state = menuState,
                 onSizeChange = { size ->
-                    menuState = menuState.copy(selectedSize = size)
+                    // Easy isn't offered on the largest grids
+                    val sizeDiffs = Difficulty.forGridSize(size, menuState.selectedProfile)
+                    val clampedDiff = sizeDiffs.firstOrNull { it.level == menuState.selectedDifficulty }?.level
+                        ?: Difficulty.DEFAULT.level
+                    menuState = menuState.copy(selectedSize = size, selectedDifficulty = clampedDiff)
                     app.gameSize = size
+                    app.gameDiff = clampedDiff
                 },
                 onDifficultyChange = { diff ->
                     menuState = menuState.copy(selectedDifficulty = diff)
@@ -14,14 +14,43 @@ interface GridValidator {
         clues: LongArray,
         modeFlags: Int
     ): IntArray?
+
+    /** Drop any per-puzzle state (e.g. a cached native index). */
+    fun release() {}
 }
 
+/**
+ * Native validation. The cage index is built once per puzzle (keyed on the
+ * identity of its dsf array) and reused for every edit; [release] frees it.
+ */
 object NativeGridValidator : GridValidator {
+    private var indexedDsf: IntArray? = null
+    private var indexedSize = 0
+    private var cageIndex = 0L
+
+    @Synchronized
     override fun validateGrid(
         size: Int,
         grid: IntArray,
         dsf: IntArray,
         clues: LongArray,
         modeFlags: Int
-    ): IntArray? = KeenValidator.validateGrid(size, grid, dsf, clues, modeFlags)
+    ): IntArray? {
+        if (dsf !== indexedDsf || size != indexedSize) {
+            if (cageIndex != 0L) KeenValidator.freeCageIndex(cageIndex)
+            cageIndex = KeenValidator.createCageIndex(size, dsf)
+            indexedDsf = dsf
+            indexedSize = size
+        }
+        if (cageIndex == 0L) return KeenValidator.validateGrid(size, grid, dsf, clues, modeFlags)
+        return KeenValidator.validateGridIndexed(cageIndex, size, grid, clues, modeFlags)
+    }
+
+    @Synchronized
+    override fun release() {
+        if (cageIndex != 0L) KeenValidator.freeCageIndex(cageIndex)
+        cageIndex = 0L
+        indexedDsf = null
+        indexedSize = 0
+    }
 }
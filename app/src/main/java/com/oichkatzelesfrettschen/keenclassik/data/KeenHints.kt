@@ -18,7 +18,8 @@ enum class HintType(val code: Int) {
     NAKED_SINGLE(1),   // Only one value fits in this cell
     HIDDEN_SINGLE(2),  // Value can only go in this cell in row/column
     CAGE_FORCE(3),     // Cage arithmetic forces this value
-    CAGE_SINGLE(4);    // Single-cell cage with given value
+    CAGE_SINGLE(4),    // Single-cell cage with given value
+    ADVANCED(5);       // Needs set elimination or forcing chains
 
     companion object {
         fun fromCode(code: Int): HintType = values().find { it.code == code } ?: NONE
@@ -35,7 +36,9 @@ data class Hint(
     val col: Int,
     val value: Int,
     val cageRoot: Int,
-    val relatedPosition: Int
+    val relatedPosition: Int,
+    val difficulty: Int = 0, // Solver difficulty level of the reasoning (0 = Easy)
+    val rank: Int = 0        // Cost rank: lower is cheaper to spot
 ) {
     /**
      * Generate a human-readable explanation of the hint.
@@ -59,6 +62,10 @@ data class Hint(
 
         HintType.CAGE_FORCE ->
             "Based on the cage constraints, cell (${row + 1}, ${col + 1}) must be $value."
+
+        HintType.ADVANCED ->
+            "Combining the candidates across several rows, columns and cages shows " +
+            "that cell (${row + 1}, ${col + 1}) must be $value."
     }
 
     /**
@@ -79,6 +86,7 @@ data class Hint(
                 if (isRow) "Focus on row $position." else "Focus on column $position."
             }
             HintType.CAGE_FORCE -> "Examine the cage at (${row + 1}, ${col + 1})."
+            HintType.ADVANCED -> "Write down the candidates around (${row + 1}, ${col + 1})."
             HintType.NONE -> "No hints available."
         }
 
@@ -124,6 +132,50 @@ object KeenHints {
         modeFlags: Int
     ): IntArray?
 
+    /**
+     * Every available deduction, one per cell, cheapest first.
+     * Packed as [HINT_FIELDS] ints per hint.
+     */
+    @JvmStatic
+    external fun getAllHints(
+        size: Int,
+        grid: IntArray,
+        dsf: IntArray,
+        clues: LongArray,
+        modeFlags: Int,
+        max: Int
+    ): IntArray?
+
+    /**
+     * Create a persistent hint engine for a puzzle.
+     * Returns 0 on invalid input.
+     */
+    @JvmStatic
+    external fun createHintEngine(
+        size: Int,
+        dsf: IntArray,
+        clues: LongArray,
+        modeFlags: Int
+    ): Long
+
+    /**
+     * Record a single player edit (value 0 clears the cell).
+     */
+    @JvmStatic
+    external fun hintEngineSetCell(handle: Long, cell: Int, value: Int)
+
+    /**
+     * Sync the engine with the grid and get its next hint.
+     */
+    @JvmStatic
+    external fun hintEngineNext(handle: Long, size: Int, grid: IntArray): IntArray?
+
+    /**
+     * Release a hint engine.
+     */
+    @JvmStatic
+    external fun freeHintEngine(handle: Long)
+
     /**
      * Get a hint with Kotlin-friendly return type.
      */
@@ -155,8 +207,28 @@ object KeenHints {
         return parseHintResult(result)
     }
 
-    private fun parseHintResult(data: IntArray): Hint {
-        require(data.size == 7) { "Invalid hint result size: ${data.size}" }
+    /**
+     * All hints available for the grid (e.g. for an overlay), sorted by rank.
+     */
+    fun allHints(
+        size: Int,
+        grid: IntArray,
+        dsf: IntArray,
+        clues: LongArray,
+        modeFlags: Int = 0,
+        max: Int = size * size
+    ): List<Hint> {
+        val packed = getAllHints(size, grid, dsf, clues, modeFlags, max) ?: return emptyList()
+        return (0 until packed.size / HINT_FIELDS).map { i ->
+            parseHintResult(packed.copyOfRange(i * HINT_FIELDS, (i + 1) * HINT_FIELDS))
+        }
+    }
+
+    /** Ints per hint in the packed array returned by [getAllHints]. */
+    const val HINT_FIELDS = 9
+
+    internal fun parseHintResult(data: IntArray): Hint {
+        require(data.size in 7..HINT_FIELDS) { "Invalid hint result size: ${data.size}" }
         return Hint(
             type = HintType.fromCode(data[0]),
             cell = data[1],
@@ -164,7 +236,53 @@ object KeenHints {
             col = data[3],
             value = data[4],
             cageRoot = data[5],
-            relatedPosition = data[6]
+            relatedPosition = data[6],
+            difficulty = if (data.size >= 8) data[7] else 0,
+            rank = if (data.size >= 9) data[8] else 0
         )
     }
 }
+
+/**
+ * Persistent native hint engine for one puzzle.
+ *
+ * Keeps the solver's candidate state between hint requests, so each
+ * request only has to account for the cells changed since the last one.
+ * Hints come from the full solver ladder (cage reasoning, set elimination
+ * and forcing chains), not just naked and hidden singles.
+ */
+class HintEngine private constructor(
+    private var handle: Long,
+    val size: Int
+) : AutoCloseable {
+
+    /**
+     * Record a single player edit (value 0 clears the cell).
+     */
+    fun setCell(cell: Int, value: Int) {
+        if (handle != 0L) KeenHints.hintEngineSetCell(handle, cell, value)
+    }
+
+    /**
+     * Next hint for the given grid, or null if none can be deduced.
+     */
+    fun nextHint(grid: IntArray): Hint? {
+        if (handle == 0L) return null
+        val result = KeenHints.hintEngineNext(handle, size, grid) ?: return null
+        return KeenHints.parseHintResult(result)
+    }
+
+    override fun close() {
+        if (handle != 0L) {
+            KeenHints.freeHintEngine(handle)
+            handle = 0L
+        }
+    }
+
+    companion object {
+        fun create(size: Int, dsf: IntArray, clues: LongArray, modeFlags: Int = 0): HintEngine? {
+            val handle = KeenHints.createHintEngine(size, dsf, clues, modeFlags)
+            return if (handle != 0L) HintEngine(handle, size) else null
+        }
+    }
+}
@@ -19,10 +19,12 @@ object ValidationError {
     const val ROW = 0x01       // Duplicate in row
     const val COLUMN = 0x02   // Duplicate in column
     const val CAGE = 0x04     // Cage constraint violated
+    const val CAGE_INFEASIBLE = 0x08 // Partly filled cage can no longer meet its clue
 
     fun hasRowError(flags: Int) = (flags and ROW) != 0
     fun hasColumnError(flags: Int) = (flags and COLUMN) != 0
     fun hasCageError(flags: Int) = (flags and CAGE) != 0
+    fun hasCageInfeasible(flags: Int) = (flags and CAGE_INFEASIBLE) != 0
     fun hasAnyError(flags: Int) = flags != OK
 }
 
@@ -55,6 +57,33 @@ object KeenValidator {
         modeFlags: Int
     ): IntArray?
 
+    /**
+     * Build a native cage index for a puzzle, so repeated validation
+     * doesn't have to rediscover cage membership from the DSF.
+     *
+     * @return Handle for [validateGridIndexed], or 0 on invalid input
+     */
+    @JvmStatic
+    external fun createCageIndex(size: Int, dsf: IntArray): Long
+
+    /**
+     * Release a cage index from [createCageIndex].
+     */
+    @JvmStatic
+    external fun freeCageIndex(handle: Long)
+
+    /**
+     * [validateGrid] using a cage index from [createCageIndex].
+     */
+    @JvmStatic
+    external fun validateGridIndexed(
+        handle: Long,
+        size: Int,
+        grid: IntArray,
+        clues: LongArray,
+        modeFlags: Int
+    ): IntArray?
+
     /**
      * Check if puzzle is complete and valid.
      *
@@ -116,6 +145,7 @@ data class CellError(
     val hasRowError get() = ValidationError.hasRowError(flags)
     val hasColumnError get() = ValidationError.hasColumnError(flags)
     val hasCageError get() = ValidationError.hasCageError(flags)
+    val hasCageInfeasible get() = ValidationError.hasCageInfeasible(flags)
 }
 
 /**
@@ -80,7 +80,7 @@ object PuzzleParser {
             val zoneIndicesRaw = payload.substring(0, semicolonIndex)
             val remainder = payload.substring(semicolonIndex + 1)
 
-            // Parse zone indices (2-digit numbers separated by commas or directly concatenated)
+            // Parse zone indices (zero-padded numbers separated by commas or directly concatenated)
             val zoneIndices = parseZoneIndices(zoneIndicesRaw, size)
             if (zoneIndices.size != size * size) {
                 return@section ParseResult.Failure(
@@ -143,7 +143,8 @@ object PuzzleParser {
 
             for (i in 0 until size * size) {
                 val digitChar = solutionPart[i]
-                val digit = digitChar.digitToIntOrNull()
+                // Digits above 9 are letters ('A' = 10), as the encoder writes them
+                val digit = digitChar.digitToIntOrNull(radix = 36)?.takeIf { it <= size }
                     ?: return@section ParseResult.Failure("Invalid digit: $digitChar", semicolonIndex + 1 + pos + i)
 
                 val x = i / size
@@ -163,9 +164,9 @@ object PuzzleParser {
 
     /**
      * Parse zone indices from the header section.
-     * Format: "00,01,01,02,..." or "00010102..." (2 digits per cell)
+     * Format: "00,01,01,02,..." or "00010102..." (each index zero-padded to
+     * the width of the largest cell index, at least 2 digits)
      */
-    @Suppress("UNUSED_PARAMETER")  // size reserved for future validation
     private fun parseZoneIndices(raw: String, size: Int): List<Int> {
         val indices = mutableListOf<Int>()
 
@@ -175,11 +176,12 @@ object PuzzleParser {
                 part.trim().toIntOrNull()?.let { indices.add(it) }
             }
         } else {
-            // Assume 2-digit concatenated
+            // Fixed-width concatenated
+            val width = maxOf(2, (size * size - 1).toString().length)
             var i = 0
-            while (i + 1 < raw.length) {
-                raw.substring(i, i + 2).toIntOrNull()?.let { indices.add(it) }
-                i += 2
+            while (i + width <= raw.length) {
+                raw.substring(i, i + width).toIntOrNull()?.let { indices.add(it) }
+                i += width
             }
         }
 
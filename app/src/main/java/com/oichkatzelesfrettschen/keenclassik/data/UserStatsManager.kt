@@ -10,6 +10,7 @@ package com.oichkatzelesfrettschen.keenclassik.data
 import android.content.Context
 import android.content.SharedPreferences
 import androidx.core.content.edit
+import com.oichkatzelesfrettschen.keenclassik.KeenModel
 import kotlin.math.max
 import kotlin.math.min
 
@@ -22,7 +23,7 @@ data class PlayerStats(
     val totalPuzzlesAbandoned: Int = 0,
     val totalHintsUsed: Int = 0,
     val averageSolveTimeSeconds: Long = 0,
-    // Per-size stats: key = gridSize (3-9), value = (solveCount, avgTimeSeconds)
+    // Per-size stats: key = gridSize (3-16), value = (solveCount, avgTimeSeconds)
     val sizeStats: Map<Int, SizeStats> = emptyMap(),
     // Computed skill score: 0.0 (beginner) to 1.0 (expert)
     val skillScore: Float = 0.5f,
@@ -79,7 +80,14 @@ class UserStatsManager(context: Context) {
             6 to 240L,
             7 to 360L,
             8 to 480L,
-            9 to 600L
+            9 to 600L,
+            10 to 780L,
+            11 to 960L,
+            12 to 1200L,
+            13 to 1500L,
+            14 to 1800L,
+            15 to 2100L,
+            16 to 2400L
         )
     }
 
@@ -88,7 +96,7 @@ class UserStatsManager(context: Context) {
 
     fun getStats(): PlayerStats {
         val sizeStats = mutableMapOf<Int, SizeStats>()
-        for (size in 3..9) {
+        for (size in 3..KeenModel.MAX_SIZE) {
             val key = "$KEY_SIZE_STATS_PREFIX$size"
             val count = prefs.getInt("${key}_count", 0)
             if (count > 0) {
@@ -118,7 +126,7 @@ class UserStatsManager(context: Context) {
 
     /**
      * Record a completed puzzle for stats tracking.
-     * @param gridSize The puzzle grid size (3-9)
+     * @param gridSize The puzzle grid size (3-16)
      * @param solveTimeSeconds Time taken to solve
      * @param hintsUsed Number of hints used
      * @param difficulty Original difficulty level (0-3)
@@ -256,7 +264,7 @@ class UserStatsManager(context: Context) {
 
     /**
      * Get a recommended grid size based on player experience.
-     * @return Recommended grid size (3-9)
+     * @return Recommended grid size (3-9; larger grids are left to the player)
      */
     fun getRecommendedGridSize(): Int {
         val stats = getStats()
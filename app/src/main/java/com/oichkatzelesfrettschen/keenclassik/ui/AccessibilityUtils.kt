@@ -176,6 +176,7 @@ fun buildCellAccessibilityDescription(
         if (ValidationError.hasRowError(errorFlags)) errorParts.add("row conflict")
         if (ValidationError.hasColumnError(errorFlags)) errorParts.add("column conflict")
         if (ValidationError.hasCageError(errorFlags)) errorParts.add("cage conflict")
+        if (ValidationError.hasCageInfeasible(errorFlags)) errorParts.add("cage cannot be completed")
         parts.add("error: ${errorParts.joinToString(" and ")}")
     }
 
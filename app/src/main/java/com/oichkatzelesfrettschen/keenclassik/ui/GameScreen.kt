@@ -81,10 +81,23 @@ import kotlin.math.min
 
 /**
  * Convert cell value to display string.
- * Classik uses decimal digits for 3x3-9x9 grids.
+ * Digits above 9 (10x10 to 16x16 grids) show as letters, 'A' = 10, as
+ * in the notes grid and puzzle descriptions.
  */
 private fun valueToDisplay(value: Int): String {
-    return value.toString()
+    return if (value <= 9) value.toString() else ('A' + (value - 10)).toString()
+}
+
+/** Digit typed with a letter key (A = 10 ... G = 16), or 0 for other keys. */
+private fun letterDigit(key: Key): Int = when (key) {
+    Key.A -> 10
+    Key.B -> 11
+    Key.C -> 12
+    Key.D -> 13
+    Key.E -> 14
+    Key.F -> 15
+    Key.G -> 16
+    else -> 0
 }
 
 /**
@@ -505,6 +518,8 @@ fun GameScreen(
  * Keyboard support:
  * - Arrow keys/WASD: Navigation
  * - 1-9: Number input
+ * - A-G: Number input 10-16 on grids above 9x9 (arrow keys navigate there,
+ *   since A and D are digits)
  * - N/Space: Toggle notes mode
  * - U/Z: Undo
  * - Delete/Backspace/0: Clear cell
@@ -524,6 +539,11 @@ private fun handleKeyEvent(
     size: Int,
     haptic: androidx.compose.ui.hapticfeedback.HapticFeedback
 ): Boolean {
+    val letter = if (size > 9) letterDigit(event.key) else 0
+    if (letter != 0) {
+        if (letter <= size) viewModel.onInput(letter)
+        return letter <= size
+    }
     return when (event.key) {
         // Arrow key / D-pad navigation
         Key.DirectionUp, Key.W -> {
@@ -1552,7 +1572,6 @@ private fun NumberButton(
     screenWidth: Dp = 0.dp
 ) {
     val dimensions = LocalGameDimensions.current
-    // Classik uses decimal digits only.
     val displayText = valueToDisplay(number)
     val description = if (number > 9) "$displayText ($number)" else displayText
 
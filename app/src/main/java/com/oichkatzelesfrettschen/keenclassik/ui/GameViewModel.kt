@@ -12,9 +12,13 @@ import android.content.SharedPreferences
 import androidx.core.content.edit
 import androidx.lifecycle.ViewModel
 import androidx.lifecycle.viewModelScope
+import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.Job
+import kotlinx.coroutines.NonCancellable
 import kotlinx.coroutines.delay
+import kotlinx.coroutines.isActive
 import kotlinx.coroutines.launch
+import kotlinx.coroutines.withContext
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.asStateFlow
@@ -30,6 +34,7 @@ import com.oichkatzelesfrettschen.keenclassik.data.PuzzleResult
 import com.oichkatzelesfrettschen.keenclassik.data.SaveManager
 import com.oichkatzelesfrettschen.keenclassik.data.SaveSlotInfo
 import com.oichkatzelesfrettschen.keenclassik.data.GridValidator
+import com.oichkatzelesfrettschen.keenclassik.data.HintEngine
 import com.oichkatzelesfrettschen.keenclassik.data.KeenHints
 import com.oichkatzelesfrettschen.keenclassik.data.KeenProfile
 import com.oichkatzelesfrettschen.keenclassik.data.NativeGridValidator
@@ -37,12 +42,16 @@ import com.oichkatzelesfrettschen.keenclassik.data.UserStatsManager
 
 class GameViewModel(
     private val repository: PuzzleRepository = PuzzleRepositoryImpl(),
-    private val validator: GridValidator = NativeGridValidator
+    private val validator: GridValidator = NativeGridValidator,
+    private val hintEngineFactory: (Int, IntArray, LongArray, Int) -> HintEngine? =
+        { size, dsf, clues, modeFlags -> HintEngine.create(size, dsf, clues, modeFlags) }
 ) : ViewModel() {
     private val _uiState = MutableStateFlow(GameUiState())
     val uiState: StateFlow<GameUiState> = _uiState.asStateFlow()
 
     private var keenModel: KeenModel? = null
+    private var hintEngine: HintEngine? = null  // Built in the background when a puzzle loads
+    private var hintEngineJob: Job? = null
     private var saveManager: SaveManager? = null
     private var statsManager: UserStatsManager? = null
     private var settingsPrefs: SharedPreferences? = null
@@ -125,6 +134,7 @@ class GameViewModel(
         preservedElapsedSeconds: Long? = null
     ) {
         keenModel = model
+        buildHintEngine(model, gameMode)
         currentDifficulty = difficulty
         currentGameMode = gameMode
         currentProfile = profile
@@ -359,6 +369,7 @@ class GameViewModel(
              model.clearFinal(x, y) // Clear value when entering notes
              model.addToCellGuesses(x, y, number)
         }
+        syncHintCell(model, x * model.size + y)
         
         model.puzzleWon()
         refreshState()
@@ -380,7 +391,8 @@ class GameViewModel(
 
     fun onUndo() {
         val model = keenModel ?: return
-        model.undoOneStep()
+        val cell = model.undoOneStep()
+        if (cell >= 0) syncHintCell(model, cell)
         refreshState()
         saveAutoSave()
     }
@@ -523,6 +535,7 @@ class GameViewModel(
         model.addCurToUndo(x, y)
         model.clearFinal(x, y)
         model.clearGuesses(x, y)
+        syncHintCell(model, x * model.size + y)
         refreshState()
         saveAutoSave()
     }
@@ -669,7 +682,8 @@ class GameViewModel(
             clues = model.clues,
             solution = null,
             modeFlags = currentGameMode.cFlags
-        ) ?: KeenHints.getHint(
+        ) ?: hintEngine?.nextHint(grid)
+        ?: KeenHints.getHint(
             size = size,
             grid = grid,
             dsf = model.dsf,
@@ -700,6 +714,41 @@ class GameViewModel(
         }
     }
 
+    /**
+     * Replace the hint engine with one for [model]. Creating it records the
+     * solver's deduction trace (about one grading solve), so it runs on
+     * [Dispatchers.Default]; until it is ready, hints use the stateless
+     * search. Edits made meanwhile are picked up by the grid sync in
+     * [HintEngine.nextHint].
+     */
+    private fun buildHintEngine(model: KeenModel, gameMode: GameMode) {
+        hintEngineJob?.cancel()
+        hintEngine?.close()
+        hintEngine = null
+        model.ensureInitialized()
+        val size = model.size
+        val dsf = model.dsf
+        val clues = model.clues
+        hintEngineJob = viewModelScope.launch {
+            val engine = withContext(NonCancellable + Dispatchers.Default) {
+                hintEngineFactory(size, dsf, clues, gameMode.cFlags)
+            }
+            if (isActive && keenModel === model) hintEngine = engine else engine?.close()
+        }
+    }
+
+    /**
+     * Pass one cell's current value to the hint engine, if one exists for
+     * this puzzle, so it updates its candidates incrementally instead of
+     * diffing the whole grid on the next hint request.
+     */
+    private fun syncHintCell(model: KeenModel, cell: Int) {
+        val engine = hintEngine ?: return
+        val size = model.size
+        val value = model.getCell((cell / size).toShort(), (cell % size).toShort()).finalGuessValue
+        engine.setCell(cell, if (value == -1) 0 else value)
+    }
+
     fun dismissHint() {
         _uiState.update { it.copy(showHintDialog = false, currentHint = null) }
     }
@@ -712,6 +761,7 @@ class GameViewModel(
             model.setActiveY(hint.cellY.toShort())
             model.addCurToUndo(hint.cellX.toShort(), hint.cellY.toShort())
             model.setCellFinalGuess(hint.cellX.toShort(), hint.cellY.toShort(), hint.suggestedDigit)
+            syncHintCell(model, hint.cellX * model.size + hint.cellY)
             model.puzzleWon()
             refreshState()
 
@@ -732,4 +782,12 @@ class GameViewModel(
     // Expose stats for UI display (Phase 4b)
     fun getPlayerStats() = statsManager?.getStats()
 
+    override fun onCleared() {
+        hintEngineJob?.cancel()
+        hintEngine?.close()
+        hintEngine = null
+        validator.release()
+        super.onCleared()
+    }
+
 }
@@ -34,6 +34,7 @@
 #include "jni_error_codes.h"
 #include "keen.h"
 #include "keen_hints.h"
+#include "keen_internal.h"
 #include "keen_modes.h"
 #include "keen_validate.h"
 
@@ -62,6 +63,22 @@ static char* jni_make_success(const char* payload) {
     return result;
 }
 
+/**
+ * Turn the cage map Kotlin passes (dsf[i] = root square of i's cage) into
+ * the native disjoint-set forest, in place. Out-of-range roots become
+ * single-cell cages.
+ */
+static void jni_roots_to_dsf(int* dsf, int n) {
+    int* forest = snew_dsf(n);
+
+    for (int i = 0; i < n; i++) {
+        int root = dsf[i] >= 0 && dsf[i] < n ? dsf[i] : i;
+        dsf_merge(forest, root, i);
+    }
+    memcpy(dsf, forest, (size_t)n * sizeof(int));
+    sfree(forest);
+}
+
 JNIEXPORT jstring JNICALL Java_com_oichkatzelesfrettschen_keenclassik_KeenModelBuilder_getLevelFromC(
     JNIEnv* env, jobject __attribute__((unused)) instance, jint size, jint diff, jint multOnly,
     jlong seed, jint modeFlags, jint profileId) {
@@ -74,12 +91,11 @@ JNIEXPORT jstring JNICALL Java_com_oichkatzelesfrettschen_keenclassik_KeenModelB
         return retval;
     }
 
-    int max_size = 9;
     int max_diff = 3;
 
-    if (size < 3 || size > max_size) {
+    if (size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE) {
         char* err = jni_make_error(JNI_ERR_INVALID_PARAMS,
-                                   "Size must be 3-9 for Classik profiles");
+                                   "Size must be 3-16 for Classik profiles");
         jstring retval = (*env)->NewStringUTF(env, err);
         sfree(err);
         return retval;
@@ -93,6 +109,13 @@ JNIEXPORT jstring JNICALL Java_com_oichkatzelesfrettschen_keenclassik_KeenModelB
         return retval;
     }
 
+    if (diff == DIFF_EASY && size > KEEN_EASY_MAX_SIZE) {
+        char* err = jni_make_error(JNI_ERR_INVALID_PARAMS, "Easy is available up to 12x12");
+        jstring retval = (*env)->NewStringUTF(env, err);
+        sfree(err);
+        return retval;
+    }
+
     if (keen_profile_is_classik(profileId)) {
         /* Classik allows STANDARD (modeFlags=0, multOnly=0) or
          * MULTIPLICATION_ONLY (modeFlags=MODE_MULT_ONLY, multOnly=1) */
@@ -247,7 +270,7 @@ JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_Kee
     (void)clazz; /* Unused static method receiver */
 
     /* Validate size parameter */
-    if (size < 3 || size > 9) {
+    if (size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE) {
         return nullptr;
     }
 
@@ -284,6 +307,7 @@ JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_Kee
         dsf[i] = dsf_body[i];
         clues[i] = (clue_t)clues_body[i];
     }
+    jni_roots_to_dsf(dsf, n);
 
     /* Release Java arrays */
     (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
@@ -297,6 +321,7 @@ JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_Kee
     ctx.dsf = dsf;
     ctx.clues = clues;
     ctx.mode_flags = modeFlags;
+    ctx.cages = nullptr;
 
     /* Validate */
     kenken_validate_grid(&ctx, errors);
@@ -327,7 +352,7 @@ JNIEXPORT jint JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenVali
     (void)clazz;
 
     /* Validate size parameter */
-    if (size < 3 || size > 9) {
+    if (size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE) {
         return 0;
     }
 
@@ -361,6 +386,7 @@ JNIEXPORT jint JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenVali
         dsf[i] = dsf_body[i];
         clues[i] = (clue_t)clues_body[i];
     }
+    jni_roots_to_dsf(dsf, n);
 
     (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
     (*env)->ReleaseIntArrayElements(env, dsfFlat, dsf_body, 0);
@@ -372,6 +398,7 @@ JNIEXPORT jint JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenVali
     ctx.dsf = dsf;
     ctx.clues = clues;
     ctx.mode_flags = modeFlags;
+    ctx.cages = nullptr;
 
     int result = kenken_is_complete(&ctx);
 
@@ -382,6 +409,129 @@ JNIEXPORT jint JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenVali
     return result;
 }
 
+/**
+ * Build the cage index for a puzzle once, for validateGridIndexed.
+ *
+ * @param size Grid dimension (NxN)
+ * @param dsfFlat Cage membership
+ * @return Opaque handle (0 on invalid input); release with freeCageIndex
+ */
+JNIEXPORT jlong JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenValidator_createCageIndex(
+    JNIEnv* env, jclass clazz, jint size, jintArray dsfFlat) {
+    (void)clazz;
+
+    /* Validate size parameter */
+    if (size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE) {
+        return 0;
+    }
+
+    int n = size * size;
+
+    /* Validate array length to prevent buffer over-read */
+    if ((*env)->GetArrayLength(env, dsfFlat) != n) {
+        return 0;
+    }
+
+    jint* dsf_body = (*env)->GetIntArrayElements(env, dsfFlat, 0);
+    if (!dsf_body) {
+        return 0;
+    }
+
+    int* dsf = snewn((size_t)n, int);
+    for (int i = 0; i < n; i++) {
+        dsf[i] = dsf_body[i];
+    }
+    jni_roots_to_dsf(dsf, n);
+
+    (*env)->ReleaseIntArrayElements(env, dsfFlat, dsf_body, 0);
+
+    cage_index* idx = kenken_cage_index_new(size, dsf);
+    sfree(dsf);
+
+    return (jlong)(intptr_t)idx;
+}
+
+/**
+ * Release a cage index. Passing 0 is a no-op.
+ */
+JNIEXPORT void JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenValidator_freeCageIndex(
+    JNIEnv* env, jclass clazz, jlong handle) {
+    (void)env;
+    (void)clazz;
+
+    kenken_cage_index_free((cage_index*)(intptr_t)handle);
+}
+
+/**
+ * Validate grid using a cage index from createCageIndex.
+ *
+ * @param handle Cage index handle
+ * @param size Grid dimension the index was built for (null result if not)
+ * @param gridFlat Current cell values as flat array (0 = empty)
+ * @param cluesFlat Cage clues with operation in upper bits
+ * @param modeFlags Mode flags (e.g., MODE_KILLER)
+ * @return IntArray of error flags, as validateGrid
+ */
+JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenValidator_validateGridIndexed(
+    JNIEnv* env, jclass clazz, jlong handle, jint size, jintArray gridFlat, jlongArray cluesFlat,
+    jint modeFlags) {
+    (void)clazz;
+
+    const cage_index* idx = (const cage_index*)(intptr_t)handle;
+    if (!idx || size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE || idx->w != size) {
+        return nullptr;
+    }
+
+    int n = size * size;
+
+    /* Validate array lengths to prevent buffer over-read */
+    if ((*env)->GetArrayLength(env, gridFlat) != n || (*env)->GetArrayLength(env, cluesFlat) != n) {
+        return nullptr;
+    }
+
+    jint* grid_body = (*env)->GetIntArrayElements(env, gridFlat, 0);
+    jlong* clues_body = (*env)->GetLongArrayElements(env, cluesFlat, 0);
+
+    if (!grid_body || !clues_body) {
+        if (grid_body) (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
+        if (clues_body) (*env)->ReleaseLongArrayElements(env, cluesFlat, clues_body, 0);
+        return nullptr;
+    }
+
+    digit* grid = snewn((size_t)n, digit);
+    clue_t* clues = snewn((size_t)n, clue_t);
+    int* errors = snewn((size_t)n, int);
+
+    for (int i = 0; i < n; i++) {
+        grid[i] = (digit)grid_body[i];
+        clues[i] = (clue_t)clues_body[i];
+    }
+
+    (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
+    (*env)->ReleaseLongArrayElements(env, cluesFlat, clues_body, 0);
+
+    validate_ctx ctx;
+    ctx.w = size;
+    ctx.grid = grid;
+    ctx.dsf = nullptr; /* membership comes from the index */
+    ctx.clues = clues;
+    ctx.mode_flags = modeFlags;
+    ctx.cages = idx;
+
+    kenken_validate_grid(&ctx, errors);
+
+    jintArray result = (*env)->NewIntArray(env, n);
+    if (result) {
+        (*env)->SetIntArrayRegion(env, result, 0, n, errors);
+    }
+
+    sfree(grid);
+    sfree(clues);
+    sfree(errors);
+
+    return result;
+}
+
 /*
  * Hint System JNI Entry Points
  * ----------------------------
@@ -406,7 +556,7 @@ JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_Kee
     (void)clazz;
 
     /* Validate size parameter */
-    if (size < 3 || size > 9) {
+    if (size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE) {
         return nullptr;
     }
 
@@ -450,6 +600,7 @@ JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_Kee
         clues[i] = (clue_t)clues_body[i];
         if (solution) solution[i] = (digit)solution_body[i];
     }
+    jni_roots_to_dsf(dsf, n);
 
     (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
     (*env)->ReleaseIntArrayElements(env, dsfFlat, dsf_body, 0);
@@ -493,7 +644,7 @@ JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_Kee
     (void)clazz;
 
     /* Validate size parameter */
-    if (size < 3 || size > 9) {
+    if (size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE) {
         return nullptr;
     }
 
@@ -542,6 +693,7 @@ JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_Kee
         clues[i] = (clue_t)clues_body[i];
         if (solution) solution[i] = (digit)solution_body[i];
     }
+    jni_roots_to_dsf(dsf, n);
 
     (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
     (*env)->ReleaseIntArrayElements(env, dsfFlat, dsf_body, 0);
@@ -575,3 +727,249 @@ JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_Kee
 
     return ret;
 }
+
+/*
+ * Persistent Hint Engine JNI Entry Points
+ * ---------------------------------------
+ * A hint engine keeps the solver's candidate state for one puzzle between
+ * requests. Kotlin owns the returned handle and must release it with
+ * freeHintEngine().
+ */
+
+/**
+ * Create a hint engine for a puzzle.
+ *
+ * @param size Grid dimension
+ * @param dsfFlat DSF array for cage membership
+ * @param cluesFlat Cage clues with operation in upper bits
+ * @param modeFlags Mode flags
+ * @return Opaque engine handle, or 0 on invalid input
+ */
+JNIEXPORT jlong JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenHints_createHintEngine(
+    JNIEnv* env, jclass clazz, jint size, jintArray dsfFlat, jlongArray cluesFlat,
+    jint modeFlags) {
+    (void)clazz;
+
+    /* Validate size parameter */
+    if (size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE) {
+        return 0;
+    }
+
+    int n = size * size;
+
+    /* Validate array lengths to prevent buffer over-read */
+    jsize dsfLen = (*env)->GetArrayLength(env, dsfFlat);
+    jsize cluesLen = (*env)->GetArrayLength(env, cluesFlat);
+    if (dsfLen != n || cluesLen != n) {
+        return 0;
+    }
+
+    jint* dsf_body = (*env)->GetIntArrayElements(env, dsfFlat, 0);
+    jlong* clues_body = (*env)->GetLongArrayElements(env, cluesFlat, 0);
+
+    if (!dsf_body || !clues_body) {
+        if (dsf_body) (*env)->ReleaseIntArrayElements(env, dsfFlat, dsf_body, 0);
+        if (clues_body) (*env)->ReleaseLongArrayElements(env, cluesFlat, clues_body, 0);
+        return 0;
+    }
+
+    int* dsf = snewn((size_t)n, int);
+    clue_t* clues = snewn((size_t)n, clue_t);
+
+    for (int i = 0; i < n; i++) {
+        dsf[i] = dsf_body[i];
+        clues[i] = (clue_t)clues_body[i];
+    }
+    jni_roots_to_dsf(dsf, n);
+
+    (*env)->ReleaseIntArrayElements(env, dsfFlat, dsf_body, 0);
+    (*env)->ReleaseLongArrayElements(env, cluesFlat, clues_body, 0);
+
+    /* The engine keeps its own copies of dsf and clues. */
+    hint_engine* eng = kenken_hint_engine_new(size, dsf, clues, modeFlags, nullptr);
+
+    sfree(dsf);
+    sfree(clues);
+
+    return (jlong)(intptr_t)eng;
+}
+
+/**
+ * Record a single player edit.
+ *
+ * @param handle Engine handle from createHintEngine
+ * @param cell Cell index (same layout as the dsf array)
+ * @param value New digit, or 0 when the cell was cleared
+ */
+JNIEXPORT void JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenHints_hintEngineSetCell(
+    JNIEnv* env, jclass clazz, jlong handle, jint cell, jint value) {
+    (void)env;
+    (void)clazz;
+
+    hint_engine* eng = (hint_engine*)(intptr_t)handle;
+    if (eng) kenken_hint_engine_set_cell(eng, cell, value);
+}
+
+/**
+ * Bring the engine up to date with the grid and return the next hint.
+ *
+ * @param handle Engine handle from createHintEngine
+ * @param size Grid dimension the engine was created with
+ * @param gridFlat Current cell values (0 = empty)
+ * @return IntArray: [hint_type, cell, row, col, value, cage_root, related_pos, difficulty]
+ *         Returns null if no hint available
+ */
+JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenHints_hintEngineNext(
+    JNIEnv* env, jclass clazz, jlong handle, jint size, jintArray gridFlat) {
+    (void)clazz;
+
+    hint_engine* eng = (hint_engine*)(intptr_t)handle;
+    if (!eng || size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE) {
+        return nullptr;
+    }
+
+    int n = size * size;
+
+    /* Validate array length to prevent buffer over-read */
+    if ((*env)->GetArrayLength(env, gridFlat) != n) {
+        return nullptr;
+    }
+
+    jint* grid_body = (*env)->GetIntArrayElements(env, gridFlat, 0);
+    if (!grid_body) {
+        return nullptr;
+    }
+
+    digit* grid = snewn((size_t)n, digit);
+    for (int i = 0; i < n; i++) {
+        grid[i] = (digit)grid_body[i];
+    }
+
+    (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
+
+    kenken_hint_engine_sync(eng, grid);
+
+    hint_result result;
+    jintArray ret = nullptr;
+
+    if (kenken_hint_engine_next(eng, &result)) {
+        ret = (*env)->NewIntArray(env, 8);
+        if (ret) {
+            jint data[8] = {result.hint_type, result.cell,      result.row,
+                            result.col,       result.value,     result.cage_root,
+                            result.related_pos, result.difficulty};
+            (*env)->SetIntArrayRegion(env, ret, 0, 8, data);
+        }
+    }
+
+    sfree(grid);
+
+    return ret;
+}
+
+/**
+ * Release a hint engine. Passing 0 is a no-op.
+ */
+JNIEXPORT void JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenHints_freeHintEngine(
+    JNIEnv* env, jclass clazz, jlong handle) {
+    (void)env;
+    (void)clazz;
+
+    kenken_hint_engine_free((hint_engine*)(intptr_t)handle);
+}
+
+/**
+ * Every deduction currently available, one per cell, cheapest first.
+ *
+ * @param size Grid dimension (3-16)
+ * @param gridFlat Current cell values (0 = empty)
+ * @param dsfFlat Cage membership
+ * @param cluesFlat Cage clues
+ * @param modeFlags Mode flags the puzzle was generated with
+ * @param max Maximum number of hints to return
+ * @return IntArray of 9 ints per hint:
+ *         [hint_type, cell, row, col, value, cage_root, related_pos, difficulty, rank]
+ *         Returns null on invalid input
+ */
+JNIEXPORT jintArray JNICALL Java_com_oichkatzelesfrettschen_keenclassik_data_KeenHints_getAllHints(
+    JNIEnv* env, jclass clazz, jint size, jintArray gridFlat, jintArray dsfFlat,
+    jlongArray cluesFlat, jint modeFlags, jint max) {
+    (void)clazz;
+
+    if (size < KEEN_MIN_SIZE || size > KEEN_MAX_SIZE || max < 0) {
+        return nullptr;
+    }
+
+    int n = size * size;
+    if (max > n) max = n;
+
+    /* Validate array lengths to prevent buffer over-read */
+    if ((*env)->GetArrayLength(env, gridFlat) != n || (*env)->GetArrayLength(env, dsfFlat) != n ||
+        (*env)->GetArrayLength(env, cluesFlat) != n) {
+        return nullptr;
+    }
+
+    jint* grid_body = (*env)->GetIntArrayElements(env, gridFlat, 0);
+    jint* dsf_body = (*env)->GetIntArrayElements(env, dsfFlat, 0);
+    jlong* clues_body = (*env)->GetLongArrayElements(env, cluesFlat, 0);
+
+    if (!grid_body || !dsf_body || !clues_body) {
+        if (grid_body) (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
+        if (dsf_body) (*env)->ReleaseIntArrayElements(env, dsfFlat, dsf_body, 0);
+        if (clues_body) (*env)->ReleaseLongArrayElements(env, cluesFlat, clues_body, 0);
+        return nullptr;
+    }
+
+    digit* grid = snewn((size_t)n, digit);
+    int* dsf = snewn((size_t)n, int);
+    clue_t* clues = snewn((size_t)n, clue_t);
+
+    for (int i = 0; i < n; i++) {
+        grid[i] = (digit)grid_body[i];
+        dsf[i] = dsf_body[i];
+        clues[i] = (clue_t)clues_body[i];
+    }
+    jni_roots_to_dsf(dsf, n);
+
+    (*env)->ReleaseIntArrayElements(env, gridFlat, grid_body, 0);
+    (*env)->ReleaseIntArrayElements(env, dsfFlat, dsf_body, 0);
+    (*env)->ReleaseLongArrayElements(env, cluesFlat, clues_body, 0);
+
+    hint_ctx ctx;
+    ctx.w = size;
+    ctx.grid = grid;
+    ctx.dsf = dsf;
+    ctx.clues = clues;
+    ctx.mode_flags = modeFlags;
+    ctx.solution = nullptr;
+
+    hint_result* results = snewn((size_t)(max > 0 ? max : 1), hint_result);
+    int count = kenken_get_all_hints(&ctx, results, max);
+    jintArray ret = (*env)->NewIntArray(env, count * 9);
+
+    if (ret) {
+        jint* data = snewn((size_t)(count > 0 ? count * 9 : 1), jint);
+        for (int i = 0; i < count; i++) {
+            const hint_result* h = &results[i];
+            jint* p = data + i * 9;
+            p[0] = h->hint_type;
+            p[1] = h->cell;
+            p[2] = h->row;
+            p[3] = h->col;
+            p[4] = h->value;
+            p[5] = h->cage_root;
+            p[6] = h->related_pos;
+            p[7] = h->difficulty;
+            p[8] = h->rank;
+        }
+        (*env)->SetIntArrayRegion(env, ret, 0, count * 9, data);
+        sfree(data);
+    }
+
+    sfree(results);
+    sfree(grid);
+    sfree(dsf);
+    sfree(clues);
+
+    return ret;
+}
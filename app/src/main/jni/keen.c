@@ -260,12 +260,12 @@ static const char* preset_profile_label(int profile) {
 }
 
 [[maybe_unused]] static char* validate_params(const game_params* params, [[maybe_unused]] int full) {
-    if (keen_profile_is_classik(params->profile)) {
-        if (params->w < 3 || params->w > 9) return "Grid size must be between 3 and 9";
-        if (params->diff > DIFF_EXTREME) return "Difficulty must be between 0 and 3";
-    } else if (params->w < 3 || params->w > 16) {
+    if (params->w < KEEN_MIN_SIZE || params->w > KEEN_MAX_SIZE)
         return "Grid size must be between 3 and 16";
-    }
+    if (keen_profile_is_classik(params->profile) && params->diff > DIFF_EXTREME)
+        return "Difficulty must be between 0 and 3";
+    if (params->diff == DIFF_EASY && params->w > KEEN_EASY_MAX_SIZE)
+        return "Easy is available up to 12x12";
     if (params->diff >= DIFFCOUNT) return "Unknown difficulty rating";
     return nullptr;
 }
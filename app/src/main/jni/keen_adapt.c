@@ -0,0 +1,280 @@
+/*
+ * keen_adapt.c: Adaptive partition and clue-typing parameters
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Each (size, difficulty, profile) cell keeps, per tunable, attempt and
+ * hit counts for every candidate value. Tunables are chosen
+ * independently: each goes to the value with the best estimated hit
+ * rate, where an estimate is shrunk toward the cell's pooled rate so that
+ * a value tried a few times without a hit isn't written off (hit rates
+ * at hard targets are well under 1%). Ties keep the default. Now and
+ * then a tunable instead takes a random allowed value; exploration drops
+ * once the cell has seen enough hits.
+ */
+
+#include "keen_adapt.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "keen_internal.h"
+#include "puzzles.h"
+
+#define ADAPT_MAXW 16
+#define ADAPT_PROFILES 3
+#define ADAPT_KNOBS 3
+#define ADAPT_MAXARMS 6
+
+/* Explore one attempt in EXPLORE_EARLY per tunable until the cell has
+ * WARMUP_HITS hits, then one in EXPLORE_LATE. */
+#define EXPLORE_EARLY 8
+#define EXPLORE_LATE 32
+#define WARMUP_HITS 32
+
+/* Cage caps further than this from the default aren't tried. */
+#define MAXBLK_REACH 4
+
+static const struct {
+    const char* name;
+    int narms;
+    int arms[ADAPT_MAXARMS];
+} knobs[ADAPT_KNOBS] = {
+    {"divisor", 5, {2, 3, 4, 6, 64}},
+    {"maxblk", 6, {4, 6, 8, 10, 12, 16}},
+    {"ops", 3, {KEEN_OPS_EASY, KEEN_OPS_NORMAL, KEEN_OPS_HARD}},
+};
+
+typedef struct {
+    long tries[ADAPT_KNOBS][ADAPT_MAXARMS];
+    long hits[ADAPT_KNOBS][ADAPT_MAXARMS];
+} adapt_cell;
+
+struct keen_adapt {
+    adapt_cell* cells; /* [w][diff][profile] */
+    uint64_t rng;      /* exploration only; never the generator's */
+};
+
+#define NCELLS ((ADAPT_MAXW + 1) * DIFFCOUNT * ADAPT_PROFILES)
+#define RNG_SEED 0x9E3779B97F4A7C15ULL
+
+keen_adapt* keen_adapt_new(void) {
+    keen_adapt* ad = snew(keen_adapt);
+    ad->cells = snewn(NCELLS, adapt_cell);
+    memset(ad->cells, 0, NCELLS * sizeof(adapt_cell));
+    ad->rng = RNG_SEED;
+    return ad;
+}
+
+void keen_adapt_free(keen_adapt* ad) {
+    if (!ad) return;
+    sfree(ad->cells);
+    sfree(ad);
+}
+
+static adapt_cell* cell_of(const keen_adapt* ad, int w, int diff, int profile) {
+    if (!ad || w < 0 || w > ADAPT_MAXW || diff < 0 || diff >= DIFFCOUNT || profile < 0 ||
+        profile >= ADAPT_PROFILES)
+        return nullptr;
+    return &ad->cells[(w * DIFFCOUNT + diff) * ADAPT_PROFILES + profile];
+}
+
+static int* knob_field(keen_knobs* k, int knob) {
+    return knob == 0 ? &k->domino_divisor : knob == 1 ? &k->maxblk : &k->op_order;
+}
+
+static int knob_value(const keen_knobs* k, int knob) {
+    return knob == 0 ? k->domino_divisor : knob == 1 ? k->maxblk : k->op_order;
+}
+
+static int arm_index(int knob, int value) {
+    for (int i = 0; i < knobs[knob].narms; i++)
+        if (knobs[knob].arms[i] == value) return i;
+    return -1;
+}
+
+static int arm_allowed(int knob, int value, int def, int limit) {
+    if (knob != 1) return true;
+    return value <= limit && value >= def - MAXBLK_REACH && value <= def + MAXBLK_REACH;
+}
+
+/* xorshift64* */
+static uint64_t adapt_random(keen_adapt* ad) {
+    ad->rng ^= ad->rng >> 12;
+    ad->rng ^= ad->rng << 25;
+    ad->rng ^= ad->rng >> 27;
+    return ad->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static int best_arm(const adapt_cell* c, int knob, int def, int limit) {
+    long n = 0, h = 0;
+
+    for (int i = 0; i < knobs[knob].narms; i++)
+        if (arm_allowed(knob, knobs[knob].arms[i], def, limit)) {
+            n += c->tries[knob][i];
+            h += c->hits[knob][i];
+        }
+    if (h == 0) return def;
+
+    /* One pseudo-hit at the pooled rate: an untried value scores the pool */
+    double pool = (h + 1.0) / (n + 2.0);
+    int best = def, di = arm_index(knob, def);
+    double best_score = di < 0 ? pool : (c->hits[knob][di] + 1.0) /
+                                            (c->tries[knob][di] + 1.0 / pool);
+
+    for (int i = 0; i < knobs[knob].narms; i++) {
+        int v = knobs[knob].arms[i];
+        if (v == def || !arm_allowed(knob, v, def, limit)) continue;
+        double score = (c->hits[knob][i] + 1.0) / (c->tries[knob][i] + 1.0 / pool);
+        if (score > best_score * (1 + 1e-9)) best = v, best_score = score;
+    }
+    return best;
+}
+
+static void choose(keen_adapt* ad, int w, int diff, int profile, const keen_knobs* defaults,
+                   int limit, keen_knobs* out, int explore) {
+    const adapt_cell* c = cell_of(ad, w, diff, profile);
+
+    *out = *defaults;
+    if (!c) return;
+
+    long hits = 0;
+    for (int i = 0; i < knobs[0].narms; i++) hits += c->hits[0][i];
+    uint64_t rate = hits < WARMUP_HITS ? EXPLORE_EARLY : EXPLORE_LATE;
+
+    for (int k = 0; k < ADAPT_KNOBS; k++) {
+        int def = knob_value(defaults, k);
+        int* v = knob_field(out, k);
+
+        if (explore && adapt_random(ad) % rate == 0) {
+            int allowed[ADAPT_MAXARMS], n = 0;
+            for (int i = 0; i < knobs[k].narms; i++)
+                if (arm_allowed(k, knobs[k].arms[i], def, limit))
+                    allowed[n++] = knobs[k].arms[i];
+            if (n) {
+                *v = allowed[adapt_random(ad) % (uint64_t)n];
+                continue;
+            }
+        }
+        *v = best_arm(c, k, def, limit);
+    }
+}
+
+void keen_adapt_choose(keen_adapt* ad, int w, int diff, int profile,
+                       const keen_knobs* defaults, int limit, keen_knobs* out) {
+    choose(ad, w, diff, profile, defaults, limit, out, true);
+}
+
+void keen_adapt_best(const keen_adapt* ad, int w, int diff, int profile,
+                     const keen_knobs* defaults, int limit, keen_knobs* out) {
+    choose((keen_adapt*)ad, w, diff, profile, defaults, limit, out, false);
+}
+
+void keen_adapt_record(keen_adapt* ad, int w, int diff, int profile, const keen_knobs* used,
+                       int hit) {
+    adapt_cell* c = cell_of(ad, w, diff, profile);
+
+    if (!c) return;
+    for (int k = 0; k < ADAPT_KNOBS; k++) {
+        int i = arm_index(k, knob_value(used, k));
+        if (i < 0) continue;
+        c->tries[k][i]++;
+        if (hit) c->hits[k][i]++;
+    }
+}
+
+void keen_adapt_totals(const keen_adapt* ad, int w, int diff, int profile, long* tries,
+                       long* hits) {
+    const adapt_cell* c = cell_of(ad, w, diff, profile);
+
+    *tries = *hits = 0;
+    if (!c) return;
+    /* Every attempt is recorded against exactly one divisor */
+    for (int i = 0; i < knobs[0].narms; i++) {
+        *tries += c->tries[0][i];
+        *hits += c->hits[0][i];
+    }
+}
+
+/*
+ * The file is line-based text:
+ *
+ *   keen-adapt 1
+ *   <w> <diff> <profile> <knob> <value> <tries> <hits>
+ *   ...
+ *
+ * with one line per value that has been tried, knob being one of the
+ * names above. Lines for values this build doesn't offer are skipped.
+ */
+#define ADAPT_MAGIC "keen-adapt 1\n"
+
+int keen_adapt_load(keen_adapt* ad, const char* path) {
+    FILE* fp = fopen(path, "r");
+    char line[128];
+    int ok = false;
+
+    memset(ad->cells, 0, NCELLS * sizeof(adapt_cell));
+    if (!fp) return false;
+    if (!fgets(line, sizeof(line), fp) || strcmp(line, ADAPT_MAGIC)) goto done;
+
+    while (fgets(line, sizeof(line), fp)) {
+        int w, diff, profile, value, k;
+        long tries, hits;
+        char name[16];
+
+        if (line[0] == '\n' || line[0] == '#') continue;
+        if (sscanf(line, "%d %d %d %15s %d %ld %ld", &w, &diff, &profile, name, &value, &tries,
+                   &hits) != 7 ||
+            tries < 0 || hits < 0 || hits > tries)
+            goto done;
+        for (k = 0; k < ADAPT_KNOBS && strcmp(name, knobs[k].name); k++);
+        adapt_cell* c = cell_of(ad, w, diff, profile);
+        int i = k < ADAPT_KNOBS ? arm_index(k, value) : -1;
+        if (!c || i < 0) continue;
+        c->tries[k][i] = tries;
+        c->hits[k][i] = hits;
+    }
+    ok = !ferror(fp);
+
+done:
+    if (!ok) memset(ad->cells, 0, NCELLS * sizeof(adapt_cell));
+    fclose(fp);
+    return ok;
+}
+
+int keen_adapt_save(const keen_adapt* ad, const char* path) {
+    size_t len = strlen(path);
+    char* tmp = snewn(len + 5, char);
+    FILE* fp;
+    int ok;
+
+    /* Write aside and rename, so a crash never leaves half a file */
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    fp = fopen(tmp, "w");
+    if (!fp) {
+        sfree(tmp);
+        return false;
+    }
+
+    fputs(ADAPT_MAGIC, fp);
+    for (int w = 0; w <= ADAPT_MAXW; w++)
+        for (int diff = 0; diff < DIFFCOUNT; diff++)
+            for (int profile = 0; profile < ADAPT_PROFILES; profile++) {
+                const adapt_cell* c = cell_of(ad, w, diff, profile);
+                for (int k = 0; k < ADAPT_KNOBS; k++)
+                    for (int i = 0; i < knobs[k].narms; i++)
+                        if (c->tries[k][i])
+                            fprintf(fp, "%d %d %d %s %d %ld %ld\n", w, diff, profile,
+                                    knobs[k].name, knobs[k].arms[i], c->tries[k][i],
+                                    c->hits[k][i]);
+            }
+
+    ok = !ferror(fp);
+    ok = (fclose(fp) == 0) && ok;
+    if (ok) ok = rename(tmp, path) == 0;
+    if (!ok) remove(tmp);
+    sfree(tmp);
+    return ok;
+}
@@ -0,0 +1,72 @@
+/*
+ * keen_adapt.h: Adaptive partition and clue-typing parameters
+ *
+ * The generator's tunables (the chance of placing a domino, the cage size
+ * cap and the clue-type ordering) are fixed per profile and difficulty,
+ * and most attempts at a narrow target band are thrown away. A controller
+ * records, for each (size, difficulty, profile), how often attempts made
+ * with each setting of each tunable produced a puzzle, and picks the
+ * settings for later attempts from those hit rates, exploring now and
+ * then. The counts can be saved to and loaded from a small text file, so
+ * what one batch learns carries over to the next.
+ *
+ * A generator only adapts when given a controller (keen_gen_set_adapt);
+ * without one it uses the fixed settings and stays deterministic in its
+ * seed. A controller is not thread-safe: give each generating thread its
+ * own.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef KEEN_ADAPT_H
+#define KEEN_ADAPT_H
+
+/* One setting of every tunable. */
+typedef struct {
+    int domino_divisor; /* a square pairs up with probability 1 - 1/divisor */
+    int maxblk;         /* largest cage the partitioner folds squares into */
+    int op_order;       /* KEEN_OPS_EASY, _NORMAL or _HARD clue-type ordering */
+} keen_knobs;
+
+#define KEEN_OPS_EASY 0
+#define KEEN_OPS_NORMAL 1
+#define KEEN_OPS_HARD 2
+
+typedef struct keen_adapt keen_adapt;
+
+keen_adapt* keen_adapt_new(void);
+void keen_adapt_free(keen_adapt* ad);
+
+/*
+ * Settings for the next attempt at (w, diff, profile): the best observed
+ * value of each tunable, or now and then another one to keep measuring
+ * it. Values stay near the defaults (the generator's fixed settings) and
+ * never let the cage cap exceed limit. Cells the controller has no data
+ * for, or doesn't track, get the defaults.
+ */
+void keen_adapt_choose(keen_adapt* ad, int w, int diff, int profile,
+                       const keen_knobs* defaults, int limit, keen_knobs* out);
+
+/* As keen_adapt_choose, without exploring. */
+void keen_adapt_best(const keen_adapt* ad, int w, int diff, int profile,
+                     const keen_knobs* defaults, int limit, keen_knobs* out);
+
+/* Records an attempt made with the given settings, and whether it hit. */
+void keen_adapt_record(keen_adapt* ad, int w, int diff, int profile, const keen_knobs* used,
+                       int hit);
+
+/* Attempts and hits recorded for (w, diff, profile). */
+void keen_adapt_totals(const keen_adapt* ad, int w, int diff, int profile, long* tries,
+                       long* hits);
+
+/*
+ * Replace the counts with the contents of a file written by
+ * keen_adapt_save. Returns false (leaving the counts cleared) if the file
+ * can't be read or isn't one.
+ */
+int keen_adapt_load(keen_adapt* ad, const char* path);
+
+/* Returns false if the file can't be written. */
+int keen_adapt_save(const keen_adapt* ad, const char* path);
+
+#endif /* KEEN_ADAPT_H */
@@ -0,0 +1,373 @@
+/*
+ * keen_cpu.c: Runtime CPU feature detection and SIMD kernel dispatch
+ *
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (C) 2024-2025 KeenKenning Contributors
+ *
+ * x86 kernels beyond the SSE2 baseline are compiled with per-function
+ * target attributes, so the translation unit itself needs no -m flags.
+ * NEON is part of the arm64 baseline (and of the armeabi-v7a build
+ * flags); the ARMv8 SHA1 instructions are optional and checked at
+ * runtime. The active table is chosen by a load-time constructor and
+ * starts out scalar, so calls made before it runs are still correct.
+ */
+
+#include "keen_cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define KEEN_X86 1
+#endif
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD (1 << 1)
+#endif
+#ifndef HWCAP_SHA1
+#define HWCAP_SHA1 (1 << 5)
+#endif
+/*
+ * The SHA1 intrinsics need the feature enabled on the function; clang
+ * before 16 only declares them when it is enabled for the whole file.
+ */
+#if defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO) || !defined(__clang__) || \
+    __clang_major__ >= 16
+#define KEEN_ARM_SHA1 1
+#endif
+#endif
+#include <string.h>
+
+#include "puzzles.h" /* For fatal */
+
+/* ----------------------------------------------------------------------
+ * Scalar reference kernels.
+ */
+
+static void fill_i32_scalar(int* dst, int n, int value) {
+    for (int i = 0; i < n; i++) dst[i] = value;
+}
+
+static void dup_masks_scalar(const uint16_t* m, int n, uint16_t* twice) {
+    uint16_t once[16] = {0};
+    memset(twice, 0, 16 * sizeof(uint16_t));
+    for (int r = 0; r < n; r++)
+        for (int k = 0; k < 16; k++) {
+            twice[k] |= once[k] & m[r * 16 + k];
+            once[k] |= m[r * 16 + k];
+        }
+}
+
+#define rol(x, y) (((x) << (y)) | (((uint32_t)x) >> (32 - y)))
+
+static void sha1_block_scalar(uint32_t h[5], const unsigned char* block) {
+    uint32_t w[80];
+    uint32_t a, b, c, d, e;
+    int t;
+
+    /* Gather bytes big-endian into words */
+    for (t = 0; t < 16; t++)
+        w[t] = ((uint32_t)block[t * 4 + 0] << 24) | ((uint32_t)block[t * 4 + 1] << 16) |
+               ((uint32_t)block[t * 4 + 2] << 8) | ((uint32_t)block[t * 4 + 3] << 0);
+
+    for (t = 16; t < 80; t++) {
+        uint32_t tmp = w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16];
+        w[t] = rol(tmp, 1);
+    }
+
+    a = h[0];
+    b = h[1];
+    c = h[2];
+    d = h[3];
+    e = h[4];
+
+    for (t = 0; t < 80; t++) {
+        uint32_t f, k;
+        if (t < 20) {
+            f = (b & c) | (d & ~b);
+            k = 0x5a827999;
+        } else if (t < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (t < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        uint32_t tmp = rol(a, 5) + f + e + w[t] + k;
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = tmp;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+/* ----------------------------------------------------------------------
+ * x86 kernels.
+ */
+
+#if defined(KEEN_X86) && defined(__SSE2__)
+static void fill_i32_sse2(int* dst, int n, int value) {
+    __m128i v = _mm_set1_epi32(value);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i*)(dst + i), v);
+    for (; i < n; i++) dst[i] = value;
+}
+
+static void dup_masks_sse2(const uint16_t* m, int n, uint16_t* twice) {
+    __m128i once0 = _mm_setzero_si128(), once1 = once0, twice0 = once0, twice1 = once0;
+    for (int r = 0; r < n; r++) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(m + r * 16));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(m + r * 16 + 8));
+        twice0 = _mm_or_si128(twice0, _mm_and_si128(once0, v0));
+        twice1 = _mm_or_si128(twice1, _mm_and_si128(once1, v1));
+        once0 = _mm_or_si128(once0, v0);
+        once1 = _mm_or_si128(once1, v1);
+    }
+    _mm_storeu_si128((__m128i*)twice, twice0);
+    _mm_storeu_si128((__m128i*)(twice + 8), twice1);
+}
+#endif
+
+#ifdef KEEN_X86
+__attribute__((target("avx2"))) static void fill_i32_avx2(int* dst, int n, int value) {
+    __m256i v = _mm256_set1_epi32(value);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i*)(dst + i), v);
+    for (; i < n; i++) dst[i] = value;
+}
+
+__attribute__((target("avx2"))) static void dup_masks_avx2(const uint16_t* m, int n,
+                                                           uint16_t* twice) {
+    __m256i once_v = _mm256_setzero_si256(), twice_v = _mm256_setzero_si256();
+    for (int r = 0; r < n; r++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(m + r * 16));
+        twice_v = _mm256_or_si256(twice_v, _mm256_and_si256(once_v, v));
+        once_v = _mm256_or_si256(once_v, v);
+    }
+    _mm256_storeu_si256((__m256i*)twice, twice_v);
+}
+
+/*
+ * SHA extensions: four rounds per sha1rnds4, with the schedule for group
+ * g + 4 computed from groups g..g+3 as the rounds consume group g. The
+ * state is held with a in the top lane, hence the word reversals.
+ */
+#define SHA1_ROUNDS4(abcd, e, f)                                      \
+    ((f) == 0   ? _mm_sha1rnds4_epu32(abcd, e, 0)                     \
+     : (f) == 1 ? _mm_sha1rnds4_epu32(abcd, e, 1)                     \
+     : (f) == 2 ? _mm_sha1rnds4_epu32(abcd, e, 2)                     \
+                : _mm_sha1rnds4_epu32(abcd, e, 3))
+
+__attribute__((target("sha,sse4.1,ssse3"))) static void sha1_block_shani(
+    uint32_t h[5], const unsigned char* block) {
+    const __m128i bswap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)h), 0x1b);
+    __m128i e = _mm_set_epi32((int)h[4], 0, 0, 0);
+    __m128i abcd_save = abcd, e_save = e, prev = abcd;
+    __m128i w[4];
+
+    for (int i = 0; i < 4; i++)
+        w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 16 * i)), bswap);
+
+    for (int g = 0; g < 20; g++) {
+        __m128i x = w[g & 3];
+        e = g == 0 ? _mm_add_epi32(e, x) : _mm_sha1nexte_epu32(prev, x);
+        prev = abcd;
+        abcd = SHA1_ROUNDS4(abcd, e, g / 5);
+        if (g < 16)
+            w[g & 3] = _mm_sha1msg2_epu32(
+                _mm_xor_si128(_mm_sha1msg1_epu32(x, w[(g + 1) & 3]), w[(g + 2) & 3]),
+                w[(g + 3) & 3]);
+    }
+
+    e = _mm_sha1nexte_epu32(prev, e_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+    _mm_storeu_si128((__m128i*)h, _mm_shuffle_epi32(abcd, 0x1b));
+    h[4] = (uint32_t)_mm_extract_epi32(e, 3);
+}
+#undef SHA1_ROUNDS4
+#endif
+
+/* ----------------------------------------------------------------------
+ * ARM kernels.
+ */
+
+#ifdef __ARM_NEON
+static void fill_i32_neon(int* dst, int n, int value) {
+    int32x4_t v = vdupq_n_s32(value);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_s32(dst + i, v);
+    for (; i < n; i++) dst[i] = value;
+}
+
+static void dup_masks_neon(const uint16_t* m, int n, uint16_t* twice) {
+    uint16x8_t once0 = vdupq_n_u16(0), once1 = once0, twice0 = once0, twice1 = once0;
+    for (int r = 0; r < n; r++) {
+        uint16x8_t v0 = vld1q_u16(m + r * 16);
+        uint16x8_t v1 = vld1q_u16(m + r * 16 + 8);
+        twice0 = vorrq_u16(twice0, vandq_u16(once0, v0));
+        twice1 = vorrq_u16(twice1, vandq_u16(once1, v1));
+        once0 = vorrq_u16(once0, v0);
+        once1 = vorrq_u16(once1, v1);
+    }
+    vst1q_u16(twice, twice0);
+    vst1q_u16(twice + 8, twice1);
+}
+#endif
+
+#ifdef KEEN_ARM_SHA1
+/* Same schedule as the x86 version; the state keeps a in lane 0. */
+__attribute__((target("+sha2"))) static void sha1_block_armv8(uint32_t h[5],
+                                                              const unsigned char* block) {
+    static const uint32_t k[4] = {0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6};
+    uint32x4_t abcd = vld1q_u32(h), abcd_save = abcd;
+    uint32_t e = h[4];
+    uint32x4_t w[4];
+
+    for (int i = 0; i < 4; i++) w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(block + 16 * i)));
+
+    for (int g = 0; g < 20; g++) {
+        uint32x4_t x = w[g & 3];
+        uint32x4_t wk = vaddq_u32(x, vdupq_n_u32(k[g / 5]));
+        uint32_t e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        if (g < 5)
+            abcd = vsha1cq_u32(abcd, e, wk);
+        else if (g < 10 || g >= 15)
+            abcd = vsha1pq_u32(abcd, e, wk);
+        else
+            abcd = vsha1mq_u32(abcd, e, wk);
+        e = e_next;
+        if (g < 16)
+            w[g & 3] = vsha1su1q_u32(vsha1su0q_u32(x, w[(g + 1) & 3], w[(g + 2) & 3]),
+                                     w[(g + 3) & 3]);
+    }
+
+    vst1q_u32(h, vaddq_u32(abcd, abcd_save));
+    h[4] += e;
+}
+#endif
+
+/* ----------------------------------------------------------------------
+ * Detection and dispatch.
+ */
+
+unsigned keen_cpu_features(void) {
+    unsigned features = 0;
+#ifdef KEEN_X86
+    unsigned a, b, c, d;
+    if (__get_cpuid(1, &a, &b, &c, &d)) {
+        bool ssse3 = c & (1U << 9), sse41 = c & (1U << 19);
+        /* AVX state must also be enabled by the OS (OSXSAVE, XCR0 bits 1-2) */
+        bool avx_os = false;
+        if ((c & (1U << 27)) && (c & (1U << 28))) {
+            unsigned lo, hi;
+            __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            avx_os = (lo & 6) == 6;
+        }
+#ifdef __SSE2__
+        if (d & (1U << 26)) features |= KEEN_CPU_SSE2;
+#endif
+        if (__get_cpuid_max(0, nullptr) >= 7) {
+            __cpuid_count(7, 0, a, b, c, d);
+            if (avx_os && (b & (1U << 5))) features |= KEEN_CPU_AVX2;
+            if ((b & (1U << 29)) && ssse3 && sse41) features |= KEEN_CPU_SHA1;
+        }
+    }
+#elif defined(__aarch64__) && defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    if (hwcap & HWCAP_ASIMD) features |= KEEN_CPU_NEON;
+#ifdef KEEN_ARM_SHA1
+    if (hwcap & HWCAP_SHA1) features |= KEEN_CPU_SHA1;
+#endif
+#elif defined(__ARM_NEON)
+    features |= KEEN_CPU_NEON;
+#endif
+    return features;
+}
+
+keen_kernels keen_kernels_for(unsigned features) {
+    keen_kernels k = {"scalar", fill_i32_scalar, dup_masks_scalar, sha1_block_scalar};
+
+#ifdef KEEN_X86
+#ifdef __SSE2__
+    if (features & KEEN_CPU_SSE2) {
+        k.name = "sse2";
+        k.fill_i32 = fill_i32_sse2;
+        k.dup_masks = dup_masks_sse2;
+    }
+#endif
+    if (features & KEEN_CPU_AVX2) {
+        k.name = "avx2";
+        k.fill_i32 = fill_i32_avx2;
+        k.dup_masks = dup_masks_avx2;
+    }
+    if (features & KEEN_CPU_SHA1) k.sha1_block = sha1_block_shani;
+#endif
+#ifdef __ARM_NEON
+    if (features & KEEN_CPU_NEON) {
+        k.name = "neon";
+        k.fill_i32 = fill_i32_neon;
+        k.dup_masks = dup_masks_neon;
+    }
+#endif
+#ifdef KEEN_ARM_SHA1
+    if (features & KEEN_CPU_SHA1) k.sha1_block = sha1_block_armv8;
+#endif
+    return k;
+}
+
+static keen_kernels best_kernels = {"scalar", fill_i32_scalar, dup_masks_scalar,
+                                    sha1_block_scalar};
+static const keen_kernels* active_kernels = &best_kernels;
+
+__attribute__((constructor)) static void keen_kernels_init(void) {
+    best_kernels = keen_kernels_for(keen_cpu_features());
+}
+
+const keen_kernels* keen_kernels_get(void) {
+    return active_kernels;
+}
+
+/* Cross-check wrappers: run the selected kernel and the reference. */
+
+static void fill_i32_checked(int* dst, int n, int value) {
+    best_kernels.fill_i32(dst, n, value);
+    for (int i = 0; i < n; i++)
+        if (dst[i] != value) fatal("kernel %s: fill_i32 mismatch at %d", best_kernels.name, i);
+}
+
+static void dup_masks_checked(const uint16_t* m, int n, uint16_t* twice) {
+    uint16_t ref[16];
+    dup_masks_scalar(m, n, ref);
+    best_kernels.dup_masks(m, n, twice);
+    if (memcmp(ref, twice, sizeof(ref)))
+        fatal("kernel %s: dup_masks mismatch over %d rows", best_kernels.name, n);
+}
+
+static void sha1_block_checked(uint32_t h[5], const unsigned char* block) {
+    uint32_t ref[5];
+    memcpy(ref, h, sizeof(ref));
+    sha1_block_scalar(ref, block);
+    best_kernels.sha1_block(h, block);
+    if (memcmp(ref, h, sizeof(ref))) fatal("kernel sha1_block mismatch");
+}
+
+static const keen_kernels checked_kernels = {"crosscheck", fill_i32_checked, dup_masks_checked,
+                                             sha1_block_checked};
+
+void keen_kernels_set_crosscheck(bool on) {
+    active_kernels = on ? &checked_kernels : &best_kernels;
+}
@@ -0,0 +1,55 @@
+/*
+ * keen_cpu.h: Runtime CPU feature detection and SIMD kernel dispatch
+ *
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (C) 2024-2025 KeenKenning Contributors
+ *
+ * The hot vector kernels are compiled for every instruction set the
+ * toolchain can target and picked at load time from what the CPU
+ * reports (cpuid on x86, getauxval(AT_HWCAP) on arm64), so one binary
+ * runs everywhere and still uses the best path. Each kernel has a scalar
+ * reference implementation that defines its result.
+ */
+
+#ifndef KEEN_CPU_H
+#define KEEN_CPU_H
+
+#include <stdint.h>
+
+/* CPU feature bits, as reported by keen_cpu_features() */
+#define KEEN_CPU_SSE2 (1U << 0)
+#define KEEN_CPU_AVX2 (1U << 1)
+#define KEEN_CPU_NEON (1U << 2)
+#define KEEN_CPU_SHA1 (1U << 3) /* x86 SHA extensions or ARMv8 SHA1 */
+
+typedef struct keen_kernels {
+    const char* name;
+    /* Set n ints to value (maxflow's per-search visited reset) */
+    void (*fill_i32)(int* dst, int n, int value);
+    /*
+     * Duplicate digit masks down 16 lanes: twice[k] gets the bits set in
+     * more than one of rows 0..n-1 of lane k of the row-major n x 16
+     * matrix m (the validator's row/column check).
+     */
+    void (*dup_masks)(const uint16_t* m, int n, uint16_t* twice);
+    /* One SHA-1 compression of a 64-byte block into h[5] */
+    void (*sha1_block)(uint32_t h[5], const unsigned char* block);
+} keen_kernels;
+
+/* Features of the running CPU that have compiled-in kernels. */
+unsigned keen_cpu_features(void);
+
+/* The active kernel table; never null. */
+const keen_kernels* keen_kernels_get(void);
+
+/* Kernel table using only the given features; 0 gives the scalar one. */
+keen_kernels keen_kernels_for(unsigned features);
+
+/*
+ * Cross-check mode: while enabled, every dispatched kernel call also
+ * runs the scalar reference and aborts via fatal() on any difference.
+ * Not thread-safe; switch it before starting work.
+ */
+void keen_kernels_set_crosscheck(bool on);
+
+#endif /* KEEN_CPU_H */
@@ -0,0 +1,136 @@
+/*
+ * keen_generate.h: Staged puzzle generation
+ *
+ * new_game_desc() and new_game_desc_from_grid() are thin drivers over one
+ * pipeline of six stages:
+ *
+ *   square source -> partitioner -> clue typer -> clue valuer -> grader -> encoder
+ *
+ * with a cheap difficulty predictor between the valuer and the grader.
+ * Each attempt runs the first five stages; the grader either accepts the
+ * puzzle (merging cages where that lifts a too-easy one to the target)
+ * or the attempt starts again with a new square. A generator context owns
+ * every stage's buffers and solver context and keeps them between runs,
+ * so a caller generating many puzzles (a batch or pool worker) keeps one
+ * per thread, and can plug in its own square source or grader.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef KEEN_GENERATE_H
+#define KEEN_GENERATE_H
+
+#include "keen.h"
+#include "keen_adapt.h"
+#include "keen_internal.h"
+
+/* Pipeline stages, as reported to a stage timer. */
+enum {
+    KEEN_STAGE_SQUARE,
+    KEEN_STAGE_PARTITION,
+    KEEN_STAGE_TYPE,
+    KEEN_STAGE_VALUE,
+    KEEN_STAGE_PREDICT,
+    KEEN_STAGE_GRADE,
+    KEEN_STAGE_ENCODE,
+    KEEN_STAGE_COUNT
+};
+
+/*
+ * Fills grid (w*w digits, row-major, 1..w) with the latin square the next
+ * attempt is built on. Returns false to stop generating altogether.
+ */
+typedef int (*keen_square_source)(void* ctx, int w, digit* grid, random_state* rs);
+
+/*
+ * Divides the grid into cages of at most maxblk squares, merging squares
+ * in dsf (initialised to all singletons). Returns false to discard the
+ * attempt.
+ */
+typedef int (*keen_partitioner)(void* ctx, int w, int diff, int maxblk, int* dsf,
+                                random_state* rs);
+
+/* Grades a puzzle: the same contract as keen_solver(), soln cleared first. */
+typedef int (*keen_grade_fn)(void* ctx, int w, int* dsf, clue_t* clues, digit* soln,
+                             int maxdiff, int mode_flags);
+
+/* Called after every stage run with its wall-clock time. */
+typedef void (*keen_stage_timer)(void* ctx, int stage, long ns);
+
+typedef struct keen_gen keen_gen;
+
+keen_gen* keen_gen_new(void);
+void keen_gen_free(keen_gen* g);
+
+/*
+ * A null function restores the default (latin_generate, the domino
+ * partitioner, keen_grader).
+ */
+void keen_gen_set_square_source(keen_gen* g, keen_square_source fn, void* ctx);
+void keen_gen_set_partitioner(keen_gen* g, keen_partitioner fn, void* ctx);
+void keen_gen_set_grader(keen_gen* g, keen_grade_fn fn, void* ctx);
+void keen_gen_set_timer(keen_gen* g, keen_stage_timer fn, void* ctx);
+
+/*
+ * Difficulty predictor. Right after the clues are valued, an attempt is
+ * scored from its cage size histogram, op mix and the number of digit
+ * layouts each clue allows; attempts whose cages are tight enough that
+ * they should grade at Normal or below are turned away without being
+ * graded when the target is Extreme or above. Only Classik profiles are
+ * predicted (other profiles merge cages to lift easy attempts instead).
+ * In shadow mode every attempt is still graded, and the counters record
+ * how often a rejection would have thrown away a puzzle the grader
+ * accepted. Off by default: so far the features separate levels too
+ * weakly to save measurable time (see keen_generate.c).
+ */
+#define KEEN_PREDICT_OFF 0 /* the default */
+#define KEEN_PREDICT_REJECT 1
+#define KEEN_PREDICT_SHADOW 2
+
+void keen_gen_set_predictor(keen_gen* g, int mode);
+
+/* Counters accumulated over every run of a context. */
+typedef struct {
+    long runs, attempts; /* runs started; attempts over all runs */
+    long graded;         /* attempts that reached the grader */
+    long accepted;       /* puzzles produced */
+    long scored;         /* attempts the predictor scored */
+    long rejected;       /* ...and turned away before grading */
+    long shadow_rejects; /* shadow mode: attempts it would have turned away */
+    long shadow_lost;    /* ...that the grader then accepted */
+} keen_gen_stats;
+
+const keen_gen_stats* keen_gen_get_stats(const keen_gen* g);
+
+/*
+ * Steer the partitioner and clue typer with an adaptive controller (see
+ * keen_adapt.h), which every attempt is then recorded in. The caller
+ * keeps ownership; null (the default) goes back to the fixed settings.
+ */
+void keen_gen_set_adapt(keen_gen* g, keen_adapt* ad);
+
+/*
+ * Region-growing partitioner, for keen_gen_set_partitioner. Cages are
+ * grown one at a time from a random unassigned square by adding random
+ * free neighbours until a size drawn from a target distribution is
+ * reached. A square left with no free neighbour joins the smallest
+ * adjacent cage that has room. So every call succeeds, and the cage
+ * sizes follow the target instead of the domino partitioner's fixed mix.
+ * The ctx is a keen_cage_sizes; null picks a default for the difficulty.
+ */
+#define KEEN_MAX_CAGE 16
+
+typedef struct {
+    int weight[KEEN_MAX_CAGE + 1]; /* relative share of cages of each size; [0] unused */
+} keen_cage_sizes;
+
+int keen_partition_grow(void* ctx, int w, int diff, int maxblk, int* dsf, random_state* rs);
+
+/*
+ * Runs the pipeline for params. Returns the description and sets *aux to
+ * the solution string, or returns nullptr if no attempt within the retry
+ * budget met the difficulty exactly (or the square source gave up).
+ */
+char* keen_gen_run(keen_gen* g, const game_params* params, random_state* rs, char** aux);
+
+#endif /* KEEN_GENERATE_H */
@@ -13,50 +13,17 @@
 #include <string.h>
 
 #include "keen_modes.h"
+#include "keen_solver.h"
 #include "puzzles.h"
 
 /* Forward declaration */
 extern int dsf_canonify(int* dsf, int index);
 
-/*
- * Calculate candidates for a cell based on row/column constraints.
- * Returns a bitmask where bit i is set if value i is possible.
- */
-static int get_candidates(const hint_ctx* ctx, int cell) {
-    int w = ctx->w;
-    int row = cell / w;
-    int col = cell % w;
-    int candidates = (1 << (w + 1)) - 2; /* Bits 1..w set */
-
-    /* Eliminate values already in row */
-    for (int c = 0; c < w; c++) {
-        int other = row * w + c;
-        if (ctx->grid[other] != 0) {
-            candidates &= ~(1 << ctx->grid[other]);
-        }
-    }
-
-    /* Eliminate values already in column */
-    for (int r = 0; r < w; r++) {
-        int other = r * w + col;
-        if (ctx->grid[other] != 0) {
-            candidates &= ~(1 << ctx->grid[other]);
-        }
-    }
-
-    return candidates;
-}
-
 /*
  * Count bits set in a bitmask.
  */
 static int popcount(int x) {
-    int count = 0;
-    while (x) {
-        count += x & 1;
-        x >>= 1;
-    }
-    return count;
+    return __builtin_popcount((unsigned)x);
 }
 
 /*
@@ -65,34 +32,101 @@ static int popcount(int x) {
  */
 static int single_bit_pos(int x) {
     if (x == 0 || (x & (x - 1)) != 0) return 0; /* Not exactly one bit */
-    int pos = 1;
-    while ((x & (1 << pos)) == 0) pos++;
-    return pos;
+    return __builtin_ctz((unsigned)x);
+}
+
+/*
+ * Candidate state for one hint request, built once from the grid: the
+ * digits used in each row and column, every empty cell's candidates, and
+ * per-digit position bitboards (bit k of rowpos[row][val] is set if val
+ * still fits in column k of that row; colpos likewise by row). A hidden
+ * single is then a bitboard with exactly one bit set.
+ */
+typedef struct {
+    int w;
+    int* rowused; /* [row]: bit v set if v is placed in the row */
+    int* colused; /* [col]: likewise for the column */
+    int* cand;    /* [cell]: candidate mask, 0 for filled cells */
+    int* rowpos;  /* [row * (w + 1) + val] */
+    int* colpos;  /* [col * (w + 1) + val] */
+} hint_masks;
+
+/* Rebuild the position bitboards from m->cand. */
+static void masks_positions(hint_masks* m) {
+    int w = m->w;
+
+    memset(m->rowpos, 0, (size_t)(2 * w * (w + 1)) * sizeof(int));
+    for (int row = 0; row < w; row++)
+        for (int col = 0; col < w; col++) {
+            int c = m->cand[row * w + col];
+            while (c) {
+                int val = __builtin_ctz((unsigned)c);
+                m->rowpos[row * (w + 1) + val] |= 1 << col;
+                m->colpos[col * (w + 1) + val] |= 1 << row;
+                c &= c - 1;
+            }
+        }
+}
+
+/* Digits placed in each row and column: bit v set if v is there. */
+static void lines_used(int w, const digit* grid, int* rowused, int* colused) {
+    memset(rowused, 0, (size_t)w * sizeof(int));
+    memset(colused, 0, (size_t)w * sizeof(int));
+    for (int cell = 0; cell < w * w; cell++)
+        if (grid[cell]) {
+            rowused[cell / w] |= 1 << grid[cell];
+            colused[cell % w] |= 1 << grid[cell];
+        }
+}
+
+static void masks_alloc(hint_masks* m, int w) {
+    int n = w * w;
+
+    m->w = w;
+    m->rowused = snewn((size_t)(2 * w + n + 2 * w * (w + 1)), int);
+    m->colused = m->rowused + w;
+    m->cand = m->colused + w;
+    m->rowpos = m->cand + n;
+    m->colpos = m->rowpos + w * (w + 1);
+}
+
+/* Recompute allocated masks from the grid. */
+static void masks_fill(hint_masks* m, const digit* grid) {
+    int w = m->w, n = w * w, full = (1 << (w + 1)) - 2;
+
+    lines_used(w, grid, m->rowused, m->colused);
+    for (int cell = 0; cell < n; cell++)
+        m->cand[cell] = grid[cell] ? 0 : full & ~(m->rowused[cell / w] | m->colused[cell % w]);
+    masks_positions(m);
+}
+
+static void masks_init(hint_masks* m, int w, const digit* grid) {
+    masks_alloc(m, w);
+    masks_fill(m, grid);
+}
+
+static void masks_free(hint_masks* m) {
+    sfree(m->rowused);
 }
 
 /*
  * Check for naked single: only one candidate for a cell.
  */
-static int find_naked_single(const hint_ctx* ctx, hint_result* result) {
+static int find_naked_single(const hint_ctx* ctx, const hint_masks* m, hint_result* result) {
     int w = ctx->w;
     int n = w * w;
 
     for (int cell = 0; cell < n; cell++) {
-        if (ctx->grid[cell] != 0) continue; /* Already filled */
-
-        int candidates = get_candidates(ctx, cell);
-        if (popcount(candidates) == 1) {
-            int value = single_bit_pos(candidates);
-            if (value > 0) {
-                result->hint_type = HINT_NAKED_SINGLE;
-                result->cell = cell;
-                result->row = cell / w;
-                result->col = cell % w;
-                result->value = value;
-                result->cage_root = dsf_canonify(ctx->dsf, cell);
-                result->related_pos = -1;
-                return 1;
-            }
+        int value = single_bit_pos(m->cand[cell]);
+        if (value > 0) {
+            result->hint_type = HINT_NAKED_SINGLE;
+            result->cell = cell;
+            result->row = cell / w;
+            result->col = cell % w;
+            result->value = value;
+            result->cage_root = dsf_canonify(ctx->dsf, cell);
+            result->related_pos = -1;
+            return 1;
         }
     }
     return 0;
@@ -101,46 +135,23 @@ static int find_naked_single(const hint_ctx* ctx, hint_result* result) {
 /*
  * Check for hidden single: value can only go in one cell in a row.
  */
-static int find_hidden_single_row(const hint_ctx* ctx, hint_result* result) {
+static int find_hidden_single_row(const hint_ctx* ctx, const hint_masks* m, hint_result* result) {
     int w = ctx->w;
 
     for (int row = 0; row < w; row++) {
-        /* For each value 1..w */
         for (int val = 1; val <= w; val++) {
-            /* Check if value already in row */
-            int found = 0;
-            for (int col = 0; col < w; col++) {
-                if (ctx->grid[row * w + col] == val) {
-                    found = 1;
-                    break;
-                }
-            }
-            if (found) continue;
-
-            /* Count cells where this value can go */
-            int possible_cell = -1;
-            int count = 0;
-            for (int col = 0; col < w; col++) {
-                int cell = row * w + col;
-                if (ctx->grid[cell] != 0) continue;
-
-                int candidates = get_candidates(ctx, cell);
-                if (candidates & (1 << val)) {
-                    possible_cell = cell;
-                    count++;
-                }
-            }
+            int pos = m->rowpos[row * (w + 1) + val];
+            if (popcount(pos) != 1) continue;
 
-            if (count == 1 && possible_cell >= 0) {
-                result->hint_type = HINT_HIDDEN_SINGLE;
-                result->cell = possible_cell;
-                result->row = row;
-                result->col = possible_cell % w;
-                result->value = val;
-                result->cage_root = dsf_canonify(ctx->dsf, possible_cell);
-                result->related_pos = row; /* The row that forces this */
-                return 1;
-            }
+            int cell = row * w + __builtin_ctz((unsigned)pos);
+            result->hint_type = HINT_HIDDEN_SINGLE;
+            result->cell = cell;
+            result->row = row;
+            result->col = cell % w;
+            result->value = val;
+            result->cage_root = dsf_canonify(ctx->dsf, cell);
+            result->related_pos = row; /* The row that forces this */
+            return 1;
         }
     }
     return 0;
@@ -149,45 +160,23 @@ static int find_hidden_single_row(const hint_ctx* ctx, hint_result* result) {
 /*
  * Check for hidden single in column.
  */
-static int find_hidden_single_col(const hint_ctx* ctx, hint_result* result) {
+static int find_hidden_single_col(const hint_ctx* ctx, const hint_masks* m, hint_result* result) {
     int w = ctx->w;
 
     for (int col = 0; col < w; col++) {
         for (int val = 1; val <= w; val++) {
-            /* Check if value already in column */
-            int found = 0;
-            for (int row = 0; row < w; row++) {
-                if (ctx->grid[row * w + col] == val) {
-                    found = 1;
-                    break;
-                }
-            }
-            if (found) continue;
-
-            /* Count cells where this value can go */
-            int possible_cell = -1;
-            int count = 0;
-            for (int row = 0; row < w; row++) {
-                int cell = row * w + col;
-                if (ctx->grid[cell] != 0) continue;
-
-                int candidates = get_candidates(ctx, cell);
-                if (candidates & (1 << val)) {
-                    possible_cell = cell;
-                    count++;
-                }
-            }
+            int pos = m->colpos[col * (w + 1) + val];
+            if (popcount(pos) != 1) continue;
 
-            if (count == 1 && possible_cell >= 0) {
-                result->hint_type = HINT_HIDDEN_SINGLE;
-                result->cell = possible_cell;
-                result->row = possible_cell / w;
-                result->col = col;
-                result->value = val;
-                result->cage_root = dsf_canonify(ctx->dsf, possible_cell);
-                result->related_pos = col + 100; /* +100 to indicate column */
-                return 1;
-            }
+            int cell = __builtin_ctz((unsigned)pos) * w + col;
+            result->hint_type = HINT_HIDDEN_SINGLE;
+            result->cell = cell;
+            result->row = cell / w;
+            result->col = col;
+            result->value = val;
+            result->cage_root = dsf_canonify(ctx->dsf, cell);
+            result->related_pos = col + 100; /* +100 to indicate column */
+            return 1;
         }
     }
     return 0;
@@ -202,30 +191,21 @@ static int find_cage_single(const hint_ctx* ctx, hint_result* result) {
 
     for (int cell = 0; cell < n; cell++) {
         if (ctx->grid[cell] != 0) continue;
+        if (dsf_size(ctx->dsf, cell) != 1) continue;
 
-        int root = dsf_canonify(ctx->dsf, cell);
+        /* Single-cell cage - clue value IS the answer */
+        unsigned long clue = (unsigned long)(ctx->clues[cell]);
+        int value = (int)(clue & 0x1FFFFFFFL); /* Strip operation bits */
 
-        /* Count cells in this cage */
-        int cage_size = 0;
-        for (int i = 0; i < n; i++) {
-            if (dsf_canonify(ctx->dsf, i) == root) cage_size++;
-        }
-
-        if (cage_size == 1) {
-            /* Single-cell cage - clue value IS the answer */
-            unsigned long clue = (unsigned long)(ctx->clues[root]);
-            int value = (int)(clue & 0x1FFFFFFFL); /* Strip operation bits */
-
-            if (value >= 1 && value <= w) {
-                result->hint_type = HINT_CAGE_SINGLE;
-                result->cell = cell;
-                result->row = cell / w;
-                result->col = cell % w;
-                result->value = value;
-                result->cage_root = root;
-                result->related_pos = -1;
-                return 1;
-            }
+        if (value >= 1 && value <= w) {
+            result->hint_type = HINT_CAGE_SINGLE;
+            result->cell = cell;
+            result->row = cell / w;
+            result->col = cell % w;
+            result->value = value;
+            result->cage_root = cell;
+            result->related_pos = -1;
+            return 1;
         }
     }
     return 0;
@@ -235,19 +215,24 @@ static int find_cage_single(const hint_ctx* ctx, hint_result* result) {
  * Find next hint using progressive difficulty.
  */
 int kenken_get_hint(const hint_ctx* ctx, hint_result* result) {
-    memset(result, 0, sizeof(hint_result));
-
-    /* Priority 1: Single-cell cages (trivial) */
-    if (find_cage_single(ctx, result)) return 1;
-
-    /* Priority 2: Naked singles (only one candidate) */
-    if (find_naked_single(ctx, result)) return 1;
-
-    /* Priority 3: Hidden singles in rows */
-    if (find_hidden_single_row(ctx, result)) return 1;
+    hint_masks m;
+    int found;
 
-    /* Priority 4: Hidden singles in columns */
-    if (find_hidden_single_col(ctx, result)) return 1;
+    memset(result, 0, sizeof(hint_result));
+    masks_init(&m, ctx->w, ctx->grid);
+
+    /* Priority 1: Single-cell cages (trivial)
+     * Priority 2: Naked singles (only one candidate)
+     * Priority 3: Hidden singles in rows
+     * Priority 4: Hidden singles in columns */
+    found = find_cage_single(ctx, result) || find_naked_single(ctx, &m, result) ||
+            find_hidden_single_row(ctx, &m, result) || find_hidden_single_col(ctx, &m, result);
+    masks_free(&m);
+
+    if (found) {
+        result->rank = kenken_hint_rank(result);
+        return 1;
+    }
 
     /* No simple hint available - puzzle may need guessing */
     result->hint_type = HINT_NONE;
@@ -257,10 +242,11 @@ int kenken_get_hint(const hint_ctx* ctx, hint_result* result) {
 /*
  * Explain a specific cell.
  */
-int kenken_explain_cell(const hint_ctx* ctx, int cell, hint_result* result) {
+static int explain_cell(const hint_ctx* ctx, int cell, hint_result* result) {
     int w = ctx->w;
+    int rowused[KEEN_MAX_SIZE], colused[KEEN_MAX_SIZE];
 
-    if (cell < 0 || cell >= w * w) return 0;
+    if (w > KEEN_MAX_SIZE || cell < 0 || cell >= w * w) return 0;
 
     if (ctx->grid[cell] != 0) return 0; /* Already filled */
 
@@ -268,12 +254,7 @@ int kenken_explain_cell(const hint_ctx* ctx, int cell, hint_result* result) {
 
     /* Check if this is a single-cell cage */
     int root = dsf_canonify(ctx->dsf, cell);
-    int cage_size = 0;
-    for (int i = 0; i < w * w; i++) {
-        if (dsf_canonify(ctx->dsf, i) == root) cage_size++;
-    }
-
-    if (cage_size == 1) {
+    if (dsf_size(ctx->dsf, cell) == 1) {
         unsigned long clue = (unsigned long)(ctx->clues[root]);
         int value = (int)(clue & 0x1FFFFFFFL);
         if (value >= 1 && value <= w) {
@@ -288,7 +269,8 @@ int kenken_explain_cell(const hint_ctx* ctx, int cell, hint_result* result) {
     }
 
     /* Check for naked single */
-    int candidates = get_candidates(ctx, cell);
+    lines_used(w, ctx->grid, rowused, colused);
+    int candidates = ((1 << (w + 1)) - 2) & ~(rowused[cell / w] | colused[cell % w]);
     if (popcount(candidates) == 1) {
         result->hint_type = HINT_NAKED_SINGLE;
         result->cell = cell;
@@ -317,3 +299,358 @@ int kenken_explain_cell(const hint_ctx* ctx, int cell, hint_result* result) {
 
     return 0;
 }
+
+int kenken_explain_cell(const hint_ctx* ctx, int cell, hint_result* result) {
+    if (!explain_cell(ctx, cell, result)) return 0;
+    result->rank = kenken_hint_rank(result);
+    return 1;
+}
+
+int kenken_hint_rank(const hint_result* result) {
+    /* Cheapest first: what a player spots by eye before what needs arithmetic. */
+    static const int type_cost[] = {
+        [HINT_NONE] = 0,         [HINT_CAGE_SINGLE] = 0, [HINT_NAKED_SINGLE] = 1,
+        [HINT_HIDDEN_SINGLE] = 2, [HINT_CAGE_FORCE] = 3, [HINT_ADVANCED] = 4,
+    };
+    int type = result->hint_type;
+
+    if (type < 0 || type > HINT_ADVANCED) return 0;
+    return result->difficulty * 8 + type_cost[type];
+}
+
+/* Record a deduction for cell unless it already has a cheaper one. */
+static void batch_offer(const hint_ctx* ctx, hint_result* best, int cell, int type, int value,
+                        int related_pos, int difficulty) {
+    hint_result h;
+    int w = ctx->w;
+
+    h.hint_type = type;
+    h.cell = cell;
+    h.row = cell / w;
+    h.col = cell % w;
+    h.value = value;
+    h.cage_root = dsf_canonify(ctx->dsf, cell);
+    h.related_pos = related_pos;
+    h.difficulty = difficulty;
+    h.rank = kenken_hint_rank(&h);
+
+    if (best[cell].hint_type == HINT_NONE || h.rank < best[cell].rank) best[cell] = h;
+}
+
+/*
+ * Hidden singles over a set of candidate masks: for each row and column,
+ * a digit whose position bitboard has exactly one bit.
+ */
+static void batch_hidden(const hint_ctx* ctx, const hint_masks* m, hint_result* best, int type,
+                         int difficulty) {
+    int w = ctx->w;
+
+    for (int line = 0; line < w; line++)
+        for (int val = 1; val <= w; val++) {
+            int rpos = m->rowpos[line * (w + 1) + val];
+            int cpos = m->colpos[line * (w + 1) + val];
+            if (popcount(rpos) == 1)
+                batch_offer(ctx, best, line * w + __builtin_ctz((unsigned)rpos), type, val, line,
+                            difficulty);
+            if (popcount(cpos) == 1)
+                batch_offer(ctx, best, __builtin_ctz((unsigned)cpos) * w + line, type, val,
+                            line + 100, difficulty);
+        }
+}
+
+int kenken_get_all_hints(const hint_ctx* ctx, hint_result* results, int max) {
+    int w = ctx->w, n = w * w;
+    hint_masks m;
+    hint_result* best = snewn((size_t)n, hint_result);
+    int count = 0;
+
+    memset(best, 0, (size_t)n * sizeof(hint_result));
+
+    /* Row and column masks once; every cell's candidates follow from them. */
+    masks_init(&m, w, ctx->grid);
+
+    for (int cell = 0; cell < n; cell++) {
+        if (ctx->grid[cell]) continue;
+        if (dsf_size(ctx->dsf, cell) == 1) {
+            int value = (int)((unsigned long)ctx->clues[cell] & 0x1FFFFFFFL);
+            if (value >= 1 && value <= w) {
+                batch_offer(ctx, best, cell, HINT_CAGE_SINGLE, value, -1, 0);
+                continue;
+            }
+        }
+        if (single_bit_pos(m.cand[cell]))
+            batch_offer(ctx, best, cell, HINT_NAKED_SINGLE, single_bit_pos(m.cand[cell]), -1, 0);
+    }
+    batch_hidden(ctx, &m, best, HINT_HIDDEN_SINGLE, 0);
+
+    /*
+     * Cage arithmetic: one pass of the solver's Normal-level clue
+     * deductions on top of the grid's row/column eliminations. Anything
+     * it pins down that the plain masks did not is a cage-forced cell.
+     */
+    keen_session* s = keen_session_new(w, ctx->dsf, ctx->clues, ctx->mode_flags);
+    if (keen_session_load(s, ctx->grid) && keen_session_cage_pass(s, DIFF_NORMAL) > 0) {
+        for (int cell = 0; cell < n; cell++) {
+            if (ctx->grid[cell]) continue;
+            m.cand[cell] = (int)keen_session_candidates(s, cell);
+            if (single_bit_pos(m.cand[cell]))
+                batch_offer(ctx, best, cell, HINT_CAGE_FORCE, single_bit_pos(m.cand[cell]), -1,
+                            DIFF_NORMAL);
+        }
+        masks_positions(&m);
+        batch_hidden(ctx, &m, best, HINT_CAGE_FORCE, DIFF_NORMAL);
+    }
+    keen_session_free(s);
+
+    /* Stable by rank, then by cell: insertion into the (small) output. */
+    for (int cell = 0; cell < n; cell++) {
+        int i;
+        if (best[cell].hint_type == HINT_NONE) continue;
+        if (count == max && (max == 0 || results[max - 1].rank <= best[cell].rank)) continue;
+        i = count < max ? count++ : max - 1;
+        while (i > 0 && results[i - 1].rank > best[cell].rank) {
+            results[i] = results[i - 1];
+            i--;
+        }
+        results[i] = best[cell];
+    }
+
+    sfree(best);
+    masks_free(&m);
+    return count;
+}
+
+/* ----------------------------------------------------------------------
+ * Persistent hint engine.
+ */
+
+struct hint_engine {
+    int w;
+    int* dsf;
+    clue_t* clues;
+    digit* grid;              /* the player's digits */
+    keen_session* session;    /* givens = grid, plus deductions so far */
+    keen_deduction* pending;  /* deductions made since the last reload */
+    int npending;
+    int stale;                /* session must be reloaded from grid */
+
+    /*
+     * Deduction trace of the puzzle from an empty grid, recorded once at
+     * creation. While the player's digits agree with it, the next hint
+     * is simply the first placement step whose cell is still empty.
+     */
+    keen_trace trace;
+    int* trace_place;         /* per cell: index of its placement step, or -1 */
+    int trace_pos;            /* no unsatisfied placement step before this */
+    int trace_conflicts;      /* player digits disagreeing with the trace */
+
+    hint_masks masks;         /* scratch for describing a deduction */
+};
+
+hint_engine* kenken_hint_engine_new(int w, int* dsf, clue_t* clues, int mode_flags,
+                                    const digit* grid) {
+    hint_engine* eng = snew(hint_engine);
+    int a = w * w;
+
+    eng->w = w;
+    eng->dsf = snewn((size_t)a, int);
+    memcpy(eng->dsf, dsf, (size_t)a * sizeof(int));
+    eng->clues = snewn((size_t)a, clue_t);
+    memcpy(eng->clues, clues, (size_t)a * sizeof(clue_t));
+    eng->grid = snewn((size_t)a, digit);
+    if (grid)
+        memcpy(eng->grid, grid, (size_t)a);
+    else
+        memset(eng->grid, 0, (size_t)a);
+    eng->session = keen_session_new(w, eng->dsf, eng->clues, mode_flags);
+    eng->pending = snewn((size_t)a, keen_deduction);
+    eng->npending = 0;
+    eng->stale = 1;
+
+    digit* soln = snewn((size_t)a, digit);
+    memset(soln, 0, (size_t)a);
+    memset(&eng->trace, 0, sizeof(eng->trace));
+    keen_solver_trace(w, eng->dsf, eng->clues, soln, DIFF_EXTREME, mode_flags, &eng->trace);
+    sfree(soln);
+
+    eng->trace_place = snewn((size_t)a, int);
+    for (int i = 0; i < a; i++) eng->trace_place[i] = -1;
+    for (int i = 0; i < eng->trace.nsteps; i++)
+        if (eng->trace.steps[i].value) eng->trace_place[eng->trace.steps[i].cell] = i;
+    eng->trace_pos = 0;
+    eng->trace_conflicts = 0;
+    masks_alloc(&eng->masks, w);
+    for (int i = 0; i < a; i++)
+        if (eng->grid[i] && eng->trace_place[i] >= 0 &&
+            eng->trace.steps[eng->trace_place[i]].value != eng->grid[i])
+            eng->trace_conflicts++;
+
+    return eng;
+}
+
+void kenken_hint_engine_free(hint_engine* eng) {
+    if (!eng) return;
+    keen_session_free(eng->session);
+    keen_trace_free(&eng->trace);
+    masks_free(&eng->masks);
+    sfree(eng->trace_place);
+    sfree(eng->pending);
+    sfree(eng->grid);
+    sfree(eng->clues);
+    sfree(eng->dsf);
+    sfree(eng);
+}
+
+void kenken_hint_engine_set_cell(hint_engine* eng, int cell, int value) {
+    int old;
+
+    if (cell < 0 || cell >= eng->w * eng->w) return;
+    if (value < 0 || value > eng->w) value = 0;
+
+    old = eng->grid[cell];
+    if (old == value) return;
+    eng->grid[cell] = (digit)value;
+
+    int step = eng->trace_place[cell];
+    if (step >= 0) {
+        int want = eng->trace.steps[step].value;
+        if (old && old != want) eng->trace_conflicts--;
+        if (value && value != want) eng->trace_conflicts++;
+        if (!value && step < eng->trace_pos) eng->trace_pos = step;
+    }
+
+    if (eng->stale) return;
+
+    /*
+     * Filling an empty cell with a digit the session still allows (or
+     * has already deduced) just narrows the candidates. Anything else
+     * may invalidate earlier eliminations, so start again from the grid.
+     */
+    if (old || !keen_session_place(eng->session, cell, value)) eng->stale = 1;
+}
+
+void kenken_hint_engine_sync(hint_engine* eng, const digit* grid) {
+    int a = eng->w * eng->w;
+
+    for (int i = 0; i < a; i++)
+        if (grid[i] != eng->grid[i]) kenken_hint_engine_set_cell(eng, i, grid[i]);
+}
+
+/*
+ * Turn a solver placement into a hint. Prefer the plain row/column
+ * explanation whenever the player's own grid supports it, since the
+ * solver may have made unrelated cage eliminations since its last
+ * placement.
+ */
+static void describe_deduction(hint_engine* eng, const keen_deduction* d, hint_result* result) {
+    int w = eng->w;
+    int cell = d->cell, row = cell / w, col = cell % w;
+    int bit = 1 << d->value;
+    hint_masks* m = &eng->masks;
+
+    memset(result, 0, sizeof(hint_result));
+    result->cell = cell;
+    result->row = row;
+    result->col = col;
+    result->value = d->value;
+    result->cage_root = dsf_canonify(eng->dsf, cell);
+    result->related_pos = -1;
+
+    if (dsf_size(eng->dsf, cell) == 1) {
+        result->hint_type = HINT_CAGE_SINGLE;
+        return;
+    }
+
+    masks_fill(m, eng->grid);
+    int naked = m->cand[cell] == bit;
+    int rhidden = m->rowpos[row * (w + 1) + d->value] == 1 << col;
+    int chidden = m->colpos[col * (w + 1) + d->value] == 1 << row;
+
+    if (naked) {
+        result->hint_type = HINT_NAKED_SINGLE;
+        return;
+    }
+    if (rhidden || chidden) {
+        result->hint_type = HINT_HIDDEN_SINGLE;
+        result->related_pos = rhidden ? row : col + 100;
+        return;
+    }
+
+    result->difficulty = d->diff;
+    if (d->techniques &
+        ((1 << LATIN_TECH_SET) | (1 << LATIN_TECH_SET_EXTREME) | (1 << LATIN_TECH_FORCING)))
+        result->hint_type = HINT_ADVANCED;
+    else
+        result->hint_type = HINT_CAGE_FORCE;
+}
+
+static void engine_describe(hint_engine* eng, const keen_deduction* d, hint_result* result) {
+    describe_deduction(eng, d, result);
+    result->rank = kenken_hint_rank(result);
+}
+
+/*
+ * Summarise the reasoning behind trace placement step i: everything the
+ * solver did since the previous placement.
+ */
+static void trace_deduction(const hint_engine* eng, int i, keen_deduction* d) {
+    const keen_trace_step* st = &eng->trace.steps[i];
+
+    d->cell = st->cell;
+    d->value = st->value;
+    d->support = st->support_kind;
+    d->diff = st->diff;
+    d->techniques = 1 << st->technique;
+    while (--i >= 0 && !eng->trace.steps[i].value) {
+        d->diff = max(d->diff, eng->trace.steps[i].diff);
+        d->techniques |= 1 << eng->trace.steps[i].technique;
+    }
+}
+
+int kenken_hint_engine_next(hint_engine* eng, hint_result* result) {
+    int a = eng->w * eng->w;
+
+    if (!eng->trace_conflicts) {
+        const keen_trace_step* steps = eng->trace.steps;
+        while (eng->trace_pos < eng->trace.nsteps &&
+               (!steps[eng->trace_pos].value || eng->grid[steps[eng->trace_pos].cell]))
+            eng->trace_pos++;
+        if (eng->trace_pos < eng->trace.nsteps) {
+            keen_deduction d;
+            trace_deduction(eng, eng->trace_pos, &d);
+            engine_describe(eng, &d, result);
+            return 1;
+        }
+    }
+
+    /*
+     * The player has strayed from the trace (or it ran out because the
+     * puzzle needs guessing): step the solver from the actual grid.
+     */
+
+    if (eng->stale) {
+        keen_session_load(eng->session, eng->grid);
+        eng->npending = 0;
+        eng->stale = 0;
+    }
+
+    /* Deductions already made whose cells the player hasn't filled yet. */
+    for (int i = 0; i < eng->npending; i++)
+        if (!eng->grid[eng->pending[i].cell]) {
+            engine_describe(eng, &eng->pending[i], result);
+            return 1;
+        }
+
+    while (eng->npending < a &&
+           keen_session_next(eng->session, DIFF_EXTREME, &eng->pending[eng->npending]) > 0) {
+        keen_deduction* d = &eng->pending[eng->npending++];
+        if (!eng->grid[d->cell]) {
+            engine_describe(eng, d, result);
+            return 1;
+        }
+    }
+
+    memset(result, 0, sizeof(hint_result));
+    result->hint_type = HINT_NONE;
+    return 0;
+}
@@ -23,6 +23,7 @@
 #define HINT_HIDDEN_SINGLE 2 /* Value can only go in this cell in row/col */
 #define HINT_CAGE_FORCE 3    /* Cage arithmetic forces this value */
 #define HINT_CAGE_SINGLE 4   /* Single-cell cage with given value */
+#define HINT_ADVANCED 5      /* Needs set elimination or forcing chains */
 
 /*
  * Hint result structure.
@@ -36,6 +37,8 @@ typedef struct {
     int value;       /* The value for this cell (1-N) */
     int cage_root;   /* Root cell of the relevant cage (for HINT_CAGE_*) */
     int related_pos; /* Related position (row/col index for HIDDEN_SINGLE) */
+    int difficulty;  /* DIFF_* level of the reasoning (0 for simple hints) */
+    int rank;        /* Cost rank: lower is cheaper to spot (see kenken_hint_rank) */
 } hint_result;
 
 /*
@@ -81,4 +84,61 @@ int kenken_get_hint(const hint_ctx* ctx, hint_result* result);
  */
 int kenken_explain_cell(const hint_ctx* ctx, int cell, hint_result* result);
 
+/*
+ * Find every deduction currently available, at most one per empty cell
+ * (its cheapest explanation), in one pass.
+ *
+ * Candidate masks are computed once from the grid; single-cell cages,
+ * naked singles, hidden singles and cage-forced cells (one pass of the
+ * solver's Normal-level clue deductions) are then enumerated together.
+ *
+ * Parameters:
+ *   ctx     - Hint context with puzzle state
+ *   results - Output array of at least max entries, sorted by rank
+ *   max     - Capacity of results
+ *
+ * Returns:
+ *   Number of hints written
+ */
+int kenken_get_all_hints(const hint_ctx* ctx, hint_result* results, int max);
+
+/* Cost rank of a hint: single-cell cage < naked < hidden < cage < advanced. */
+int kenken_hint_rank(const hint_result* result);
+
+/*
+ * Persistent hint engine.
+ *
+ * Keeps a solver session (candidate cube plus clue context) for one
+ * puzzle alive across hint requests. Player edits are applied
+ * incrementally; only clearing or overwriting a digit forces the
+ * candidates to be rebuilt. Deductions are drawn from the full solver
+ * ladder, cage reasoning, set elimination and forcing chains included,
+ * and are cached until the player fills the cells in.
+ *
+ * The solver's deduction trace from the empty grid is recorded once at
+ * creation; while the player's digits agree with it, a hint is just the
+ * first trace placement whose cell is still empty. Recording it costs
+ * about one grading solve, so create the engine when the puzzle loads
+ * and off the UI thread.
+ */
+typedef struct hint_engine hint_engine;
+
+/* Create an engine for the puzzle; grid (may be nullptr) holds the player's digits. */
+hint_engine* kenken_hint_engine_new(int w, int* dsf, clue_t* clues, int mode_flags,
+                                    const digit* grid);
+void kenken_hint_engine_free(hint_engine* eng);
+
+/* Record that the player set cell (row * w + col) to value (0 = cleared). */
+void kenken_hint_engine_set_cell(hint_engine* eng, int cell, int value);
+
+/* Apply every cell that differs between grid and the engine's copy. */
+void kenken_hint_engine_sync(hint_engine* eng, const digit* grid);
+
+/*
+ * Next deduction for an empty cell, in the order the solver finds them.
+ * Returns 1 if a hint was found, 0 if the ladder is stuck or the player's
+ * digits contradict each other or the clues.
+ */
+int kenken_hint_engine_next(hint_engine* eng, hint_result* result);
+
 #endif /* KENKEN_HINTS_H */
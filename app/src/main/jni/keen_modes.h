@@ -55,6 +55,13 @@ static inline int keen_profile_is_classik(int profile) {
     return profile == KEEN_PROFILE_CLASSIK_MODERN || profile == KEEN_PROFILE_CLASSIK_LEGACY;
 }
 
+/* Grid sizes accepted by the generator and the JNI entry points */
+#define KEEN_MIN_SIZE 3
+#define KEEN_MAX_SIZE 16
+
+/* Above this, the Easy deductions alone almost never finish a grid */
+#define KEEN_EASY_MAX_SIZE 12
+
 /* Utility macros */
 #define HAS_MODE(flags, mode) (((flags) & (mode)) != 0)
 #define SET_MODE(flags, mode) ((flags) | (mode))
@@ -15,7 +15,35 @@ struct solver_ctx {
     digit *soln;
     digit *dscratch;
     int *iscratch;
+    unsigned long* lscratch; /* 2 * (a + 1): odometer masks and residues */
     int mode_flags; /* Mode flags for Killer, Modular, etc. */
+    int lastbox;    /* last box solver_common made a deduction from */
+    int branching;  /* KEEN_BRANCH_* strategy for recursion */
+    int nogoods;    /* cache impossible states during recursion */
+    int batch;      /* batched propagation (see struct latin_solver) */
+    struct latin_search_stats* stats; /* recursion counters, if wanted */
+    struct layout_collector* collect; /* if set, layouts are gathered, not deduced from */
+
+    /*
+     * Per-level memo of solver_common's box scans (see box_memo_hit):
+     * for EASY, NORMAL and HARD, each box's squares of the cube as its
+     * last scan left them, whether it has been scanned since the puzzle
+     * was loaded, and (HARD only) the row/column requirements it found.
+     */
+    unsigned char* memo_cube; /* 3 * a * w */
+    unsigned char* memo_seen; /* 3 * nboxes */
+    int* memo_req;            /* nboxes * 2w */
+};
+
+/* ADD and MUL layouts are bounded for at most this many cells to go. */
+#define REACH_CELLS 16
+
+/* Gathers the layouts solver_box_layouts() finds for one box. */
+struct layout_collector {
+    int count;
+    int store;      /* keep the digits as well as counting */
+    digit* layouts; /* count * (box size) digits, if storing */
+    int size;       /* capacity of layouts, in layouts */
 };
 
 static long gcd_helper(long a, long b) {
@@ -33,26 +61,6 @@ static long lcm_helper(long a, long b) {
     return (a / g) * b; /* Avoid overflow by dividing first */
 }
 
-static long gcd_array(digit* arr, int n) {
-    if (n == 0) return 0;
-    long result = arr[0];
-    for (int i = 1; i < n; i++) {
-        result = gcd_helper(result, arr[i]);
-        if (result == 1) return 1; /* Early exit: GCD can't go lower */
-    }
-    return result;
-}
-
-static long lcm_array(digit* arr, int n) {
-    if (n == 0) return 0;
-    long result = arr[0];
-    for (int i = 1; i < n; i++) {
-        result = lcm_helper(result, arr[i]);
-        if (result > 1000000) return result; /* Prevent overflow */
-    }
-    return result;
-}
-
 static int clue_matches(unsigned long result, unsigned long value, int w, int modular) {
     if (!modular || w <= 0) {
         return result == value;
@@ -60,13 +68,31 @@ static int clue_matches(unsigned long result, unsigned long value, int w, int mo
     return (result % (unsigned long)w) == value;
 }
 
+/*
+ * Whether digit j at square i of a layout in ctx->dscratch repeats one
+ * of squares 0..i-1 along a row or column, or (Killer) anywhere in the
+ * cage.
+ */
+static bool digit_clashes(const struct solver_ctx* ctx, const int* sq, int i, int j) {
+    int w = ctx->w;
+    bool killer = HAS_MODE(ctx->mode_flags, MODE_KILLER);
+
+    for (int k = 0; k < i; k++)
+        if (ctx->dscratch[k] == j &&
+            (killer || sq[k] % w == sq[i] % w || sq[k] / w == sq[i] / w))
+            return true;
+    return false;
+}
+
 static void solver_clue_candidate(struct solver_ctx* ctx, int diff, int box) {
     int w = ctx->w;
     int n = ctx->boxes[box + 1] - ctx->boxes[box];
     int j;
 
     /*
-     * Killer mode: reject candidates with duplicate digits in the cage
+     * Killer mode: reject candidates with duplicate digits in the cage.
+     * The odometers never build one (see digit_clashes); this catches
+     * the SUB/DIV pair loops, which repeat a digit on a 0 or 1 clue.
      */
     if (HAS_MODE(ctx->mode_flags, MODE_KILLER)) {
         int seen = 0;
@@ -77,6 +103,19 @@ static void solver_clue_candidate(struct solver_ctx* ctx, int diff, int box) {
         }
     }
 
+    if (ctx->collect) {
+        struct layout_collector* lc = ctx->collect;
+        if (lc->store) {
+            if (lc->count >= lc->size) {
+                lc->size = lc->size * 2 + 16;
+                lc->layouts = sresize(lc->layouts, (size_t)lc->size * (size_t)n, digit);
+            }
+            memcpy(lc->layouts + (size_t)lc->count * (size_t)n, ctx->dscratch, (size_t)n);
+        }
+        lc->count++;
+        return;
+    }
+
     /*
      * This function is called from the main clue-based solver
      * routine when we discover a candidate layout for a given clue
@@ -151,600 +190,863 @@ static void solver_clue_candidate(struct solver_ctx* ctx, int diff, int box) {
     }
 }
 
-static int solver_common(struct latin_solver* solver, void* vctx, int diff) {
-    struct solver_ctx* ctx = (struct solver_ctx*)vctx;
-    int w = ctx->w;
-    int box, i, j, k;
-    int ret = 0, total;
+/*
+ * GCD and LCM cages, by prime masks over the digits (all below 32).
+ *
+ * With every digit a multiple of g, the GCD is g iff no prime divides
+ * every quotient digit / g; with every digit a divisor of L, the LCM is
+ * L iff each prime's full power in L divides some digit. So the
+ * odometer carries a mask (primes still common to every quotient, or
+ * full powers of L still missing), and a digit is only taken if the
+ * later squares' candidates can still clear what it leaves: avail[i]
+ * is the union over squares i.. of what one of their digits clears.
+ */
+static const int small_primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31};
+#define NSMALL_PRIMES ((int)(sizeof(small_primes) / sizeof(small_primes[0])))
+
+/* Bit k set iff small_primes[k] divides m. */
+static unsigned prime_mask(unsigned long m) {
+    unsigned mask = 0;
+    for (int k = 0; k < NSMALL_PRIMES; k++)
+        if (m % (unsigned long)small_primes[k] == 0) mask |= 1U << k;
+    return mask;
+}
 
-    /*
-     * Iterate over each clue box and deduce what we can.
-     */
-    for (box = 0; box < ctx->nboxes; box++) {
-        int* sq = ctx->boxlist + ctx->boxes[box];
-        int n = ctx->boxes[box + 1] - ctx->boxes[box];
-        unsigned long uclue = (unsigned long)ctx->clues[box];
-        unsigned long value = uclue & ~CMASK;
-        unsigned long op = uclue & CMASK;
-        int modular = HAS_MODE(ctx->mode_flags, MODE_MODULAR);
+/* Bit k set iff d holds the full power of small_primes[k] in L. */
+static unsigned full_power_mask(unsigned long d, unsigned long L) {
+    unsigned mask = 0;
+    for (int k = 0; k < NSMALL_PRIMES; k++) {
+        unsigned long p = (unsigned long)small_primes[k], pe = 1;
+        if (L % p) continue;
+        while (L % (pe * p) == 0) pe *= p;
+        if (d % pe == 0) mask |= 1U << k;
+    }
+    return mask;
+}
 
-        /*
-         * Initialise ctx->iscratch for this clue box. At different
-         * difficulty levels we must initialise a different amount of
-         * it to different things; see the comments in
-         * solver_clue_candidate explaining what each version does.
-         */
-        if (diff == DIFF_HARD) {
-            for (i = 0; i < 2 * w; i++) ctx->iscratch[i] = (1 << (w + 1)) - (1 << 1);
+/*
+ * Odometer over the box's squares, taking digit j at square i only if
+ * fits[j] and it doesn't clash along a row or column; clear[j] is what
+ * it clears from the carried mask, which starts as need and must be
+ * empty once every square is filled.
+ */
+static void box_layouts_masked(struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                               int box, const bool* fits, const unsigned* clear, unsigned need) {
+    int w = ctx->w;
+    int* sq = ctx->boxlist + ctx->boxes[box];
+    int n = ctx->boxes[box + 1] - ctx->boxes[box];
+    unsigned long* left = ctx->lscratch;        /* n + 1: mask before square i */
+    unsigned long* avail = ctx->lscratch + n + 1; /* n + 1 */
+    int i, j;
+
+    avail[n] = 0;
+    for (i = n; i-- > 0;) {
+        avail[i] = avail[i + 1];
+        for (j = 1; j <= w; j++)
+            if (fits[j] && solver->cube[sq[i] * w + j - 1]) avail[i] |= clear[j];
+    }
+    if (need & ~avail[0]) return;
+
+    i = 0;
+    left[0] = need;
+    ctx->dscratch[0] = 0;
+    while (1) {
+        if (i < n) {
+            for (j = ctx->dscratch[i] + 1; j <= w; j++) {
+                if (!fits[j] || (left[i] & ~clear[j] & ~avail[i + 1]))
+                    continue; /* won't fit, or the rest can't finish */
+                if (!solver->cube[sq[i] * w + j - 1]) continue;
+                if (digit_clashes(ctx, sq, i, j)) continue;
+                break;
+            }
+            if (j > w) {
+                i--;
+                if (i < 0) break;
+            } else {
+                ctx->dscratch[i] = (digit)j;
+                left[i + 1] = left[i] & ~clear[j];
+                ctx->dscratch[++i] = 0;
+            }
         } else {
-            for (i = 0; i < n; i++) ctx->iscratch[i] = 0;
+            /* The mask is empty here: the last square had nothing after it */
+            solver_clue_candidate(ctx, diff, box);
+            i--;
         }
+    }
+}
 
-                switch ((unsigned long)op) {
-
-                    case C_SUB:
-
-                    case C_DIV:
-
-                        /*
-
-                         * These two clue types must always apply to a box of
-
-                         * area 2. Also, the two digits in these boxes can never
-
-                         * be the same (because any domino must have its two
-
-                         * squares in either the same row or the same column).
+static void box_layouts_gcd(struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                            int box, unsigned long g) {
+    bool fits[32] = {false};
+    unsigned clear[32] = {0};
 
-                         * So we simply iterate over all possibilities for the
+    if (g == 0 || g > (unsigned long)ctx->w) return;
+    for (int d = (int)g; d <= ctx->w; d += (int)g) {
+        fits[d] = true;
+        clear[d] = ~prime_mask((unsigned long)d / g);
+    }
+    box_layouts_masked(solver, ctx, diff, box, fits, clear, (1U << NSMALL_PRIMES) - 1);
+}
 
-                         * two squares (both ways round), rule out any which are
+static void box_layouts_lcm(struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                            int box, unsigned long L) {
+    bool fits[32] = {false};
+    unsigned clear[32] = {0};
+    unsigned long rest = L;
+
+    if (L == 0) return;
+    /* A prime factor beyond the table can't come from digits anyway */
+    for (int k = 0; k < NSMALL_PRIMES; k++)
+        while (rest % (unsigned long)small_primes[k] == 0) rest /= (unsigned long)small_primes[k];
+    if (rest != 1) return;
+    for (int d = 1; d <= ctx->w; d++)
+        if (L % (unsigned long)d == 0) {
+            fits[d] = true;
+            clear[d] = full_power_mask((unsigned long)d, L);
+        }
+    box_layouts_masked(solver, ctx, diff, box, fits, clear, full_power_mask(L, L));
+}
 
-                         * inconsistent with the digit constraints we already
+/*
+ * Modular LCM: many LCMs can share a residue, so carry the LCM itself
+ * (at most lcm(1..w), which fits easily) and test it once filled.
+ */
+static void box_layouts_lcm_modular(struct latin_solver* solver, struct solver_ctx* ctx,
+                                    int diff, int box, unsigned long value) {
+    int w = ctx->w;
+    int* sq = ctx->boxlist + ctx->boxes[box];
+    int n = ctx->boxes[box + 1] - ctx->boxes[box];
+    unsigned long* run = ctx->lscratch; /* n + 1: LCM before square i */
+    int i, j;
+
+    i = 0;
+    run[0] = 1;
+    ctx->dscratch[0] = 0;
+    while (1) {
+        if (i < n) {
+            for (j = ctx->dscratch[i] + 1; j <= w; j++) {
+                if (!solver->cube[sq[i] * w + j - 1]) continue;
+                if (digit_clashes(ctx, sq, i, j)) continue;
+                break;
+            }
+            if (j > w) {
+                i--;
+                if (i < 0) break;
+            } else {
+                ctx->dscratch[i] = (digit)j;
+                run[i + 1] = (unsigned long)lcm_helper((long)run[i], j);
+                ctx->dscratch[++i] = 0;
+            }
+        } else {
+            if (clue_matches(run[n], value, w, true)) solver_clue_candidate(ctx, diff, box);
+            i--;
+        }
+    }
+}
 
-                         * have, and update the digit constraints with any new
+/*
+ * XOR cages. Digits are below 32, so a set of XOR values is one 32-bit
+ * word, and XORing every member by d permutes its bits: for each bit
+ * of d, swap the halves of each block of that size.
+ */
+static unsigned xor_shift(unsigned set, int d) {
+    static const unsigned lo[5] = {0x55555555U, 0x33333333U, 0x0F0F0F0FU, 0x00FF00FFU,
+                                   0x0000FFFFU};
+    for (int k = 0; k < 5; k++)
+        if (d & (1 << k)) set = ((set & lo[k]) << (1 << k)) | ((set >> (1 << k)) & lo[k]);
+    return set;
+}
 
-                         * information thus garnered.
+/*
+ * Odometer over the box's squares with a subset-XOR DP in front of it.
+ * Working back from the last square, reach holds the XORs the squares
+ * after i can make from their candidates (row/column clashes aside),
+ * and ok[i] the running XORs after square i from which one of those
+ * lands on a target. A digit is taken only if it leaves the running
+ * XOR in ok[i], so every filled layout already hits the clue.
+ */
+static void box_layouts_xor(struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                            int box, unsigned long value, int modular) {
+    int w = ctx->w;
+    int* sq = ctx->boxlist + ctx->boxes[box];
+    int n = ctx->boxes[box + 1] - ctx->boxes[box];
+    unsigned long* ok = ctx->lscratch; /* n */
+    unsigned targets = 0, reach = 1U; /* the empty tail XORs to 0 */
+    int i, j, total;
+
+    for (unsigned long x = 0; x < 32; x++)
+        if (clue_matches(x, value, w, modular)) targets |= 1U << x;
+
+    for (i = n; i-- > 0;) {
+        unsigned next = 0;
+        ok[i] = 0;
+        for (int t = 0; t < 32; t++)
+            if (targets & (1U << t)) ok[i] |= xor_shift(reach, t);
+        for (j = 1; j <= w; j++)
+            if (solver->cube[sq[i] * w + j - 1]) next |= xor_shift(reach, j);
+        reach = next;
+    }
+    if (!(reach & targets)) return;
+
+    i = 0;
+    total = 0; /* XOR identity is 0 */
+    ctx->dscratch[0] = 0;
+    while (1) {
+        if (i < n) {
+            for (j = ctx->dscratch[i] + 1; j <= w; j++) {
+                if (!(ok[i] & (1UL << (total ^ j)))) continue; /* the rest can't reach it */
+                if (!solver->cube[sq[i] * w + j - 1]) continue;
+                if (digit_clashes(ctx, sq, i, j)) continue;
+                break;
+            }
+            if (j > w) {
+                i--;
+                if (i < 0) break;
+                total ^= (int)ctx->dscratch[i]; /* Undo XOR (self-inverse) */
+            } else {
+                ctx->dscratch[i] = (digit)j;
+                total ^= j;
+                ctx->dscratch[++i] = 0;
+            }
+        } else {
+            /* ok[n - 1] is exactly the targets, so this layout hits one */
+            solver_clue_candidate(ctx, diff, box);
+            i--;
+            total ^= (int)ctx->dscratch[i]; /* Undo XOR */
+        }
+    }
+}
 
-                         */
+/*
+ * Modular ADD and MUL cages, by a DP over residues mod w. Working back
+ * from the last square, ok[i] is the set of running residues after
+ * square i from which the later squares' candidates (row/column clashes
+ * aside) can still land on the clue, so a digit is only taken if it
+ * leaves the running residue in ok[i]. The running residues are kept
+ * per square, since a product can't be undone mod w.
+ */
+static void box_layouts_modular(struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                                int box, bool mul, unsigned long value) {
+    int w = ctx->w;
+    int* sq = ctx->boxlist + ctx->boxes[box];
+    int n = ctx->boxes[box + 1] - ctx->boxes[box];
+    unsigned long* ok = ctx->lscratch;        /* n */
+    unsigned long* run = ctx->lscratch + n; /* n + 1: residue before square i */
+    unsigned long need;
+    int i, j, r;
+
+    if (value >= (unsigned long)w) return;
+    need = 1UL << value;
+    for (i = n; i-- > 0;) {
+        ok[i] = need;
+        need = 0;
+        for (r = 0; r < w; r++)
+            for (j = 1; j <= w && !(need & (1UL << r)); j++)
+                if (solver->cube[sq[i] * w + j - 1] &&
+                    (ok[i] & (1UL << (mul ? r * j % w : (r + j) % w))))
+                    need |= 1UL << r;
+    }
+    run[0] = mul ? 1 % (unsigned long)w : 0;
+    if (!(need & (1UL << run[0]))) return;
+
+    i = 0;
+    ctx->dscratch[0] = 0;
+    while (1) {
+        if (i < n) {
+            for (j = ctx->dscratch[i] + 1; j <= w; j++) {
+                unsigned long next = mul ? run[i] * j % w : (run[i] + j) % w;
+                if (!(ok[i] & (1UL << next))) continue; /* the rest can't reach it */
+                if (!solver->cube[sq[i] * w + j - 1])
+                    continue; /* this one is ruled out already */
+                if (digit_clashes(ctx, sq, i, j)) continue;
+                break;
+            }
+            if (j > w) {
+                i--;
+                if (i < 0) break;
+            } else {
+                ctx->dscratch[i] = (digit)j;
+                run[i + 1] = mul ? run[i] * j % w : (run[i] + j) % w;
+                ctx->dscratch[++i] = 0;
+            }
+        } else {
+            /* ok[n - 1] is just the clue, so this layout hits it */
+            solver_clue_candidate(ctx, diff, box);
+            i--;
+        }
+    }
+}
 
-                        assert(n == 2);
+/*
+ * Whether rest distinct digits from the set (bit d for digit d) can sum
+ * (or, for mul, multiply) to t: the rest smallest and largest bound
+ * it, and a single digit must be t itself.
+ */
+static bool distinct_reach(unsigned long set, int rest, long t, bool mul) {
+    long lo = mul ? 1 : 0, hi = lo;
+    int d, got;
+
+    if (rest == 0) return t == lo;
+    if (rest == 1) return t > 0 && t < 32 && (set & (1UL << t));
+    for (d = 1, got = 0; d < 32 && got < rest; d++)
+        if (set & (1UL << d)) {
+            lo = mul ? min(lo * d, (long)MAX_CLUE_VALUE + 1) : lo + d;
+            got++;
+        }
+    if (got < rest) return false;
+    for (d = 31, got = 0; got < rest; d--)
+        if (set & (1UL << d)) {
+            hi = mul ? min(hi * d, (long)MAX_CLUE_VALUE + 1) : hi + d;
+            got++;
+        }
+    return lo <= t && t <= hi;
+}
 
-        
+/*
+ * Killer ADD and MUL cages. Every layout uses n distinct digits, which
+ * also keeps it clear of row/column clashes, so a layout is just a
+ * digit set of the right sum or product assigned one-to-one to the
+ * squares. Rather than walk assignments, walk the sets in ascending
+ * order and, for each, find one perfect matching of squares to digits;
+ * square c can take digit d in some layout of the set iff d is matched
+ * to c or to a square c2 from which alternating edges lead back to c.
+ * That covers EASY, NORMAL and HARD without enumerating a layout.
+ */
+static bool killer_augment(const unsigned* adj, int c, int* owner, unsigned* seen) {
+    for (int d = 1; d < 32; d++) {
+        if (!(adj[c] & (1U << d)) || (*seen & (1U << d))) continue;
+        *seen |= 1U << d;
+        if (owner[d] < 0 || killer_augment(adj, owner[d], owner, seen)) {
+            owner[d] = c;
+            return true;
+        }
+    }
+    return false;
+}
 
-                        for (i = 1; i <= w; i++) {
+/* Fold digit set set into ctx->iscratch, as every layout of it would. */
+static void killer_set_layouts(struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                               int box, unsigned set) {
+    int w = ctx->w;
+    int* sq = ctx->boxlist + ctx->boxes[box];
+    int n = ctx->boxes[box + 1] - ctx->boxes[box];
+    unsigned adj[32], supp[32], reach[32], cells[32] = {0};
+    int owner[32];
+    int c, d, k;
+
+    for (d = 0; d < 32; d++) owner[d] = -1;
+    for (c = 0; c < n; c++) {
+        unsigned seen = 0;
+        adj[c] = 0;
+        for (d = 1; d <= w; d++)
+            if ((set & (1U << d)) && solver->cube[sq[c] * w + d - 1]) adj[c] |= 1U << d;
+        if (!killer_augment(adj, c, owner, &seen)) return; /* no layout of this set */
+    }
 
-                            j = (int)((op == C_SUB ? (long)((unsigned long)i + (unsigned long)value) : (long)((unsigned long)i * (unsigned long)value)));
+    /* reach[c]: squares c's unmatched edges lead to, transitively */
+    for (c = 0; c < n; c++) {
+        reach[c] = 0;
+        for (d = 1; d <= w; d++)
+            if ((adj[c] & (1U << d)) && owner[d] != c) reach[c] |= 1U << owner[d];
+    }
+    for (k = 0; k < n; k++)
+        for (c = 0; c < n; c++)
+            if (reach[c] & (1U << k)) reach[c] |= reach[k];
+    for (c = 0; c < n; c++) {
+        supp[c] = 0;
+        for (d = 1; d <= w; d++)
+            if ((adj[c] & (1U << d)) && (owner[d] == c || (reach[owner[d]] & (1U << c)))) {
+                supp[c] |= 1U << d;
+                cells[d] |= 1U << c;
+            }
+    }
 
-                            if (j > w) break;
+    if (diff == DIFF_EASY) {
+        for (c = 0; c < n; c++) ctx->iscratch[c] |= (int)set;
+    } else if (diff == DIFF_NORMAL) {
+        for (c = 0; c < n; c++) ctx->iscratch[c] |= (int)supp[c];
+    } else if (diff == DIFF_HARD) {
+        /* A digit is in a line in every layout iff all its squares are */
+        for (k = 0; k < 2 * w; k++) {
+            unsigned line = 0, need = 0;
+            for (c = 0; c < n; c++)
+                if (k < w ? sq[c] / w == k : sq[c] % w == k - w) line |= 1U << c;
+            for (d = 1; d <= w; d++)
+                if ((set & (1U << d)) && line && !(cells[d] & ~line)) need |= 1U << d;
+            ctx->iscratch[k] &= (int)need;
+        }
+    }
+}
 
-        
+static void killer_box_layouts(struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                               int box, bool mul, long value) {
+    int w = ctx->w;
+    int* sq = ctx->boxlist + ctx->boxes[box];
+    int n = ctx->boxes[box + 1] - ctx->boxes[box];
+    int pick[33];
+    long rem[33]; /* total still to make before pick i */
+    unsigned avail = 0, set = 0;
+    int i, d;
+
+    if (n > w) return; /* not enough distinct digits */
+    for (i = 0; i < n; i++)
+        for (d = 1; d <= w; d++)
+            if (solver->cube[sq[i] * w + d - 1]) avail |= 1U << d;
+
+    i = 0;
+    pick[0] = 0;
+    rem[0] = value;
+    while (1) {
+        if (i < n) {
+            long next = 0;
+            for (d = pick[i] + 1; d <= w; d++) {
+                if (!(avail & (1U << d))) continue;
+                if (mul ? rem[i] % d : rem[i] < d) continue; /* this one won't fit */
+                next = mul ? rem[i] / d : rem[i] - d;
+                if (!distinct_reach(avail & ~((2U << d) - 1), n - 1 - i, next, mul))
+                    continue; /* larger digits can't make up the rest */
+                break;
+            }
+            if (d > w) {
+                i--;
+                if (i < 0) break;
+                set &= ~(1U << pick[i]);
+            } else {
+                pick[i] = d;
+                set |= 1U << d;
+                rem[++i] = next;
+                pick[i] = d;
+            }
+        } else {
+            killer_set_layouts(solver, ctx, diff, box, set);
+            i--;
+            set &= ~(1U << pick[i]);
+        }
+    }
+}
 
-                            /* (i,j) is a valid digit pair. Try it both ways round. */
+/*
+ * Enumerate every layout of clue box 'box' that fits the current
+ * candidates (with no digit repeated along a row or column inside the
+ * box), handing each to solver_clue_candidate in ctx->dscratch.
+ */
+static void solver_box_layouts(struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                               int box) {
+    int w = ctx->w;
+    int i, j, k, total;
+    int* sq = ctx->boxlist + ctx->boxes[box];
+    int n = ctx->boxes[box + 1] - ctx->boxes[box];
+    unsigned long uclue = (unsigned long)ctx->clues[box];
+    unsigned long value = uclue & ~CMASK;
+    unsigned long op = uclue & CMASK;
+    int modular = HAS_MODE(ctx->mode_flags, MODE_MODULAR);
 
-        
 
-                            if (solver->cube[sq[0] * w + i - 1] && solver->cube[sq[1] * w + j - 1]) {
+    switch ((unsigned long)op) {
 
-                                ctx->dscratch[0] = (digit)i;
+        case C_SUB:
 
-                                ctx->dscratch[1] = (digit)j;
+        case C_DIV:
 
-                                solver_clue_candidate(ctx, diff, box);
+            /*
 
-                            }
+             * These two clue types must always apply to a box of
 
-        
+             * area 2. Also, the two digits in these boxes can never
 
-                            if (solver->cube[sq[0] * w + j - 1] && solver->cube[sq[1] * w + i - 1]) {
+             * be the same (because any domino must have its two
 
-                                ctx->dscratch[0] = (digit)j;
+             * squares in either the same row or the same column).
 
-                                ctx->dscratch[1] = (digit)i;
+             * So we simply iterate over all possibilities for the
 
-                                solver_clue_candidate(ctx, diff, box);
+             * two squares (both ways round), rule out any which are
 
-                            }
+             * inconsistent with the digit constraints we already
 
-                        }
+             * have, and update the digit constraints with any new
 
-        
+             * information thus garnered.
 
-                        break;
+             */
 
-        
+            assert(n == 2);
 
-                    case C_EXP:
 
-                        /*
 
-                         * Exponentiation: base^exp = value. Only for 2-cell boxes.
+            for (i = 1; i <= w; i++) {
 
-                         * Find all (base, exp) pairs where base^exp == clue value.
+                j = (int)((op == C_SUB ? (long)((unsigned long)i + (unsigned long)value) : (long)((unsigned long)i * (unsigned long)value)));
 
-                         * Convention: smaller digit is base, larger is exponent.
+                if (j > w) break;
 
-                         */
 
-                        assert(n == 2);
 
-        
+                /* (i,j) is a valid digit pair. Try it both ways round. */
 
-                        for (i = 1; i <= w; i++) {
 
-                            for (j = i + 1; j <= w; j++) {
 
-                                /* Check if i^j == value */
+                if (solver->cube[sq[0] * w + i - 1] && solver->cube[sq[1] * w + j - 1]) {
 
-                                unsigned long result = 1;
+                    ctx->dscratch[0] = (digit)i;
 
-                                int e;
+                    ctx->dscratch[1] = (digit)j;
 
-                                for (e = 0; e < j; e++) {
+                    solver_clue_candidate(ctx, diff, box);
 
-                                    result *= (unsigned long)i;
+                }
 
-                                    if (result > value) break; /* Early exit for overflow */
 
-                                }
 
-                                if (!clue_matches(result, value, w, modular)) continue;
+                if (solver->cube[sq[0] * w + j - 1] && solver->cube[sq[1] * w + i - 1]) {
 
-        
+                    ctx->dscratch[0] = (digit)j;
 
-                                /* (i,j) is base^exp = value. Try both cell orderings. */
+                    ctx->dscratch[1] = (digit)i;
 
-                                if (solver->cube[sq[0] * w + i - 1] && solver->cube[sq[1] * w + j - 1]) {
+                    solver_clue_candidate(ctx, diff, box);
 
-                                    ctx->dscratch[0] = (digit)i;
+                }
 
-                                    ctx->dscratch[1] = (digit)j;
+            }
 
-                                    solver_clue_candidate(ctx, diff, box);
 
-                                }
 
-        
+            break;
 
-                                if (solver->cube[sq[0] * w + j - 1] && solver->cube[sq[1] * w + i - 1]) {
 
-                                    ctx->dscratch[0] = (digit)j;
 
-                                    ctx->dscratch[1] = (digit)i;
+        case C_EXP:
 
-                                    solver_clue_candidate(ctx, diff, box);
+            /*
 
-                                }
+             * Exponentiation: base^exp = value. Only for 2-cell boxes.
 
-                            }
+             * Find all (base, exp) pairs where base^exp == clue value.
 
-                        }
+             * Convention: smaller digit is base, larger is exponent.
 
-        
+             */
 
-                        break;
+            assert(n == 2);
 
-        
 
-                    case C_ADD:
-                    case C_MUL:
 
-                        /*
-                         * Addition and multiplication cages require exhaustive
-                         * enumeration of all valid digit combinations.
-                         *
-                         * Rather than recursive function calls, we use iterative
-                         * enumeration via the scratch array. The index i tracks
-                         * which cell in the cage is currently being incremented.
-                         */
-                        if (modular) {
-                            unsigned long total_mod = (op == C_ADD ? 0 : 1);
+            for (i = 1; i <= w; i++) {
 
-                            i = 0;
-                            ctx->dscratch[i] = 0;
+                for (j = i + 1; j <= w; j++) {
 
-                            while (1) {
-                                if (i < n) {
-                                    for (j = ctx->dscratch[i] + 1; j <= w; j++) {
-                                        if (!solver->cube[sq[i] * w + j - 1])
-                                            continue; /* this one is ruled out already */
-                                        for (k = 0; k < i; k++)
-                                            if (ctx->dscratch[k] == j &&
-                                                (sq[k] % w == sq[i] % w || sq[k] / w == sq[i] / w))
-                                                break; /* clashes with another row/col */
-                                        if (k < i) continue;
-                                        break;
-                                    }
-
-                                    if (j > w) {
-                                        i--;
-                                        if (i < 0) break;
-                                        if (op == C_ADD)
-                                            total_mod -= (unsigned long)ctx->dscratch[i];
-                                        else
-                                            total_mod /= (unsigned long)ctx->dscratch[i];
-                                    } else {
-                                        ctx->dscratch[i++] = (digit)j;
-                                        if (op == C_ADD)
-                                            total_mod += (unsigned long)j;
-                                        else
-                                            total_mod *= (unsigned long)j;
-                                        ctx->dscratch[i] = 0;
-                                    }
-                                } else {
-                                    if (clue_matches(total_mod, value, w, modular))
-                                        solver_clue_candidate(ctx, diff, box);
-                                    i--;
-                                    if (op == C_ADD)
-                                        total_mod -= (unsigned long)ctx->dscratch[i];
-                                    else
-                                        total_mod /= (unsigned long)ctx->dscratch[i];
-                                }
-                            }
-                        } else {
-                            i = 0;
-                            ctx->dscratch[i] = 0;
-                            total = (int)value; /* start with the identity */
-
-                            while (1) {
-                                if (i < n) {
-                                    /*
-                                     * Find the next valid value for cell i.
-                                     */
-                                    for (j = ctx->dscratch[i] + 1; j <= w; j++) {
-                                        if (op == C_ADD ? (total < j) : (total % j != 0))
-                                            continue; /* this one won't fit */
-                                        if (!solver->cube[sq[i] * w + j - 1])
-                                            continue; /* this one is ruled out already */
-                                        for (k = 0; k < i; k++)
-                                            if (ctx->dscratch[k] == j &&
-                                                (sq[k] % w == sq[i] % w || sq[k] / w == sq[i] / w))
-                                                break; /* clashes with another row/col */
-                                        if (k < i) continue;
-
-                                        /* Found one. */
-                                        break;
-                                    }
-
-                                    if (j > w) {
-                                        /* No valid values left; drop back. */
-                                        i--;
-                                        if (i < 0) break; /* overall iteration is finished */
-                                        if (op == C_ADD)
-                                            total += ctx->dscratch[i];
-                                        else
-                                            total *= ctx->dscratch[i];
-                                    } else {
-                                        /* Got a valid value; store it and move on. */
-                                        ctx->dscratch[i++] = (digit)j;
-                                        if (op == C_ADD)
-                                            total -= j;
-                                        else
-                                            total /= j;
-                                        ctx->dscratch[i] = 0;
-                                    }
-                                } else {
-                                    if (total == (op == C_ADD ? 0 : 1))
-                                        solver_clue_candidate(ctx, diff, box);
-                                    i--;
-                                    if (op == C_ADD)
-                                        total += ctx->dscratch[i];
-                                    else
-                                        total *= ctx->dscratch[i];
-                                }
-                            }
-                        }
+                    /* Check if i^j == value */
 
-                        break;
+                    unsigned long result = 1;
 
-                    case C_MOD:
+                    int e;
 
-                        /*
+                    for (e = 0; e < j; e++) {
 
-                         * Modulo operation: a % b = clue. 2-cell cages only.
+                        result *= (unsigned long)i;
 
-                         * For each divisor d from 1 to w, find all pairs (a,d) where a % d = value.
+                        if (result > value) break; /* Early exit for overflow */
 
-                         * Since we want pairs where the larger mod smaller = value:
+                    }
 
-                         *   dividend % divisor = remainder  =>  dividend = k*divisor + remainder
+                    if (!clue_matches(result, value, w, modular)) continue;
 
-                         */
 
-                        assert(n == 2);
 
-        
+                    /* (i,j) is base^exp = value. Try both cell orderings. */
 
-                        for (i = 1; i <= w; i++) {               /* divisor */
+                    if (solver->cube[sq[0] * w + i - 1] && solver->cube[sq[1] * w + j - 1]) {
 
-                            if (value >= (unsigned long)i) continue;  /* remainder must be < divisor */
+                        ctx->dscratch[0] = (digit)i;
 
-                            for (j = 1; j <= w; j++) {           /* dividend */
+                        ctx->dscratch[1] = (digit)j;
 
-                                if (j <= i) continue;            /* dividend > divisor for meaningful mod */
+                        solver_clue_candidate(ctx, diff, box);
 
-                                if (!clue_matches((unsigned long)(j % i), value, w, modular)) continue;
+                    }
 
-        
 
-                                /* (j, i) is a valid pair: j % i = value */
 
-                                if (solver->cube[sq[0] * w + j - 1] && solver->cube[sq[1] * w + i - 1]) {
+                    if (solver->cube[sq[0] * w + j - 1] && solver->cube[sq[1] * w + i - 1]) {
 
-                                    ctx->dscratch[0] = (digit)j;
+                        ctx->dscratch[0] = (digit)j;
 
-                                    ctx->dscratch[1] = (digit)i;
+                        ctx->dscratch[1] = (digit)i;
 
-                                    solver_clue_candidate(ctx, diff, box);
+                        solver_clue_candidate(ctx, diff, box);
 
-                                }
+                    }
 
-                                if (solver->cube[sq[0] * w + i - 1] && solver->cube[sq[1] * w + j - 1]) {
+                }
 
-                                    ctx->dscratch[0] = (digit)i;
+            }
 
-                                    ctx->dscratch[1] = (digit)j;
 
-                                    solver_clue_candidate(ctx, diff, box);
 
-                                }
+            break;
 
-                            }
 
-                        }
 
-                        break;
+        case C_ADD:
+        case C_MUL:
 
-        
+            /*
+             * Addition and multiplication cages require exhaustive
+             * enumeration of all valid digit combinations.
+             *
+             * Rather than recursive function calls, we use iterative
+             * enumeration via the scratch array. The index i tracks
+             * which cell in the cage is currently being incremented.
+             */
+            if (modular) {
+                box_layouts_modular(solver, ctx, diff, box, op == C_MUL, value);
+            } else if (HAS_MODE(ctx->mode_flags, MODE_KILLER) && !ctx->collect) {
+                killer_box_layouts(solver, ctx, diff, box, op == C_MUL, (long)value);
+            } else {
+                /*
+                 * reach[r]: the largest total r more cells can make (a
+                 * sum or product of digits up to w, capped). A digit
+                 * that leaves the rest out of reach has no layouts
+                 * under it, which matters for big cages in big grids.
+                 */
+                long reach[REACH_CELLS + 1];
+                reach[0] = op == C_ADD ? 0 : 1;
+                for (k = 1; k < n && k <= REACH_CELLS; k++)
+                    reach[k] = op == C_ADD ? reach[k - 1] + w
+                                           : min(reach[k - 1] * w, (long)MAX_CLUE_VALUE + 1);
+
+                /*
+                 * Killer: the rest must also be distinct, unused digits
+                 * from their squares' candidates (avail[i] is the union
+                 * over squares i..), which rules out most partial layouts
+                 * of a big cage long before the leaves.
+                 */
+                bool killer = HAS_MODE(ctx->mode_flags, MODE_KILLER);
+                unsigned long* avail = ctx->lscratch; /* n + 1 */
+                unsigned used = 0;
+                if (killer) {
+                    avail[n] = 0;
+                    for (i = n; i-- > 0;) {
+                        avail[i] = avail[i + 1];
+                        for (j = 1; j <= w; j++)
+                            if (solver->cube[sq[i] * w + j - 1]) avail[i] |= 1UL << j;
+                    }
+                }
 
-                    case C_GCD:
+                i = 0;
+                ctx->dscratch[i] = 0;
+                total = (int)value; /* start with the identity */
 
+                while (1) {
+                    if (i < n) {
+                        int rest = n - 1 - i;
                         /*
-
-                         * GCD cages: GCD of all digits = clue value.
-
-                         * Uses iterative enumeration similar to ADD/MUL.
-
-                         * All digits must be divisible by the clue (GCD result).
-
+                         * Find the next valid value for cell i.
                          */
-
-                        i = 0;
-
-                        ctx->dscratch[i] = 0;
-
-                        while (1) {
-
-                            if (i < n) {
-
-                                /* Find next digit that is divisible by the target GCD */
-
-                                for (j = ctx->dscratch[i] + 1; j <= w; j++) {
-
-                                    if ((long)((unsigned long)j % (unsigned long)value) != 0) continue; /* Must be multiple of GCD */
-
-                                    if (!solver->cube[sq[i] * w + j - 1]) continue;
-
-                                    /* Check Latin square constraint */
-
-                                    for (k = 0; k < i; k++)
-
-                                        if (ctx->dscratch[k] == j &&
-
-                                            (sq[k] % w == sq[i] % w || sq[k] / w == sq[i] / w))
-
-                                            break;
-
-                                    if (k < i) continue;
-
-                                    break;
-
-                                }
-
-        
-
-                                if (j > w) {
-
-                                    i--;
-
-                                    if (i < 0) break;
-
-                                } else {
-
-                                    ctx->dscratch[i++] = (digit)j;
-
-                                    ctx->dscratch[i] = 0;
-
-                                }
-
-                            } else {
-
-                                /* Check if GCD of collected digits equals value */
-
-                                if (clue_matches((unsigned long)gcd_array(ctx->dscratch, n), value, w, modular))
-                                    solver_clue_candidate(ctx, diff, box);
-
-                                i--;
-
-                            }
-
+                        for (j = ctx->dscratch[i] + 1; j <= w; j++) {
+                            if (op == C_ADD ? (total < j) : (total % j != 0))
+                                continue; /* this one won't fit */
+                            if (rest <= REACH_CELLS &&
+                                (op == C_ADD ? total - j < rest || total - j > reach[rest]
+                                             : total / j > reach[rest]))
+                                continue; /* the rest can't make up the total */
+                            if (!solver->cube[sq[i] * w + j - 1])
+                                continue; /* this one is ruled out already */
+                            if (digit_clashes(ctx, sq, i, j)) continue;
+                            if (killer && !distinct_reach(avail[i + 1] & ~(used | 1UL << j), rest,
+                                                          op == C_ADD ? total - j : total / j,
+                                                          op == C_MUL))
+                                continue; /* no unused digits make up the total */
+
+                            /* Found one. */
+                            break;
                         }
 
-                        break;
-
-        
-
-                    case C_LCM:
-
-                        /*
-
-                         * LCM cages: LCM of all digits = clue value.
-
-                         * All digits must be divisors of the clue value.
-
-                         */
-
-                        i = 0;
-
-                        ctx->dscratch[i] = 0;
-
-                        while (1) {
-
-                            if (i < n) {
-
-                                /* Find next digit that divides the target LCM */
-
-                                for (j = ctx->dscratch[i] + 1; j <= w; j++) {
-
-                                    if ((long)((unsigned long)value % (unsigned long)j) != 0) continue; /* Must divide LCM */
-
-                                    if (!solver->cube[sq[i] * w + j - 1]) continue;
-
-                                    /* Check Latin square constraint */
-
-                                    for (k = 0; k < i; k++)
-
-                                        if (ctx->dscratch[k] == j &&
-
-                                            (sq[k] % w == sq[i] % w || sq[k] / w == sq[i] / w))
-
-                                            break;
-
-                                    if (k < i) continue;
-
-                                    break;
-
-                                }
-
-        
-
-                                if (j > w) {
-
-                                    i--;
-
-                                    if (i < 0) break;
-
-                                } else {
-
-                                    ctx->dscratch[i++] = (digit)j;
-
-                                    ctx->dscratch[i] = 0;
-
-                                }
-
-                            } else {
-
-                                /* Check if LCM of collected digits equals value */
-
-                                if (clue_matches((unsigned long)lcm_array(ctx->dscratch, n), value, w, modular))
-                                    solver_clue_candidate(ctx, diff, box);
-
-                                i--;
-
-                            }
-
+                        if (j > w) {
+                            /* No valid values left; drop back. */
+                            i--;
+                            if (i < 0) break; /* overall iteration is finished */
+                            used &= ~(1U << ctx->dscratch[i]);
+                            if (op == C_ADD)
+                                total += ctx->dscratch[i];
+                            else
+                                total *= ctx->dscratch[i];
+                        } else {
+                            /* Got a valid value; store it and move on. */
+                            ctx->dscratch[i++] = (digit)j;
+                            used |= 1U << j;
+                            if (op == C_ADD)
+                                total -= j;
+                            else
+                                total /= j;
+                            ctx->dscratch[i] = 0;
                         }
+                    } else {
+                        if (total == (op == C_ADD ? 0 : 1))
+                            solver_clue_candidate(ctx, diff, box);
+                        i--;
+                        used &= ~(1U << ctx->dscratch[i]);
+                        if (op == C_ADD)
+                            total += ctx->dscratch[i];
+                        else
+                            total *= ctx->dscratch[i];
+                    }
+                }
+            }
 
-                        break;
-
-        
-
-                    case C_XOR:
-
-                        /*
+            break;
 
-                         * XOR cages: XOR of all digits = clue value.
+        case C_MOD:
 
-                         * Bitwise exclusive-or is associative and commutative.
+            /*
 
-                         * XOR has HIGH AMBIGUITY: many digit combinations produce same result,
+             * Modulo operation: a % b = clue. 2-cell cages only.
 
-                         * making it excellent for increasing puzzle difficulty.
+             * For each divisor d from 1 to w, find all pairs (a,d) where a % d = value.
 
-                         *
+             * Since we want pairs where the larger mod smaller = value:
 
-                         * Properties:
+             *   dividend % divisor = remainder  =>  dividend = k*divisor + remainder
 
-                         *   - XOR(a) = a
+             */
 
-                         *   - XOR(a,b) = a ^ b
+            assert(n == 2);
 
-                         *   - XOR(a,a) = 0  (self-inverse)
 
-                         *   - XOR(a,0) = a  (identity)
 
-                         */
+            for (i = 1; i <= w; i++) {               /* divisor */
 
-                        i = 0;
+                if (value >= (unsigned long)i) continue;  /* remainder must be < divisor */
 
-                        ctx->dscratch[i] = 0;
+                for (j = 1; j <= w; j++) {           /* dividend */
 
-                        total = 0; /* XOR identity is 0 */
+                    if (j <= i) continue;            /* dividend > divisor for meaningful mod */
 
-                        while (1) {
+                    if (!clue_matches((unsigned long)(j % i), value, w, modular)) continue;
 
-                            if (i < n) {
 
-                                /* Find next valid digit */
 
-                                for (j = ctx->dscratch[i] + 1; j <= w; j++) {
+                    /* (j, i) is a valid pair: j % i = value */
 
-                                    if (!solver->cube[sq[i] * w + j - 1]) continue;
+                    if (solver->cube[sq[0] * w + j - 1] && solver->cube[sq[1] * w + i - 1]) {
 
-                                    /* Check Latin square constraint */
+                        ctx->dscratch[0] = (digit)j;
 
-                                    for (k = 0; k < i; k++)
+                        ctx->dscratch[1] = (digit)i;
 
-                                        if (ctx->dscratch[k] == j &&
+                        solver_clue_candidate(ctx, diff, box);
 
-                                            (sq[k] % w == sq[i] % w || sq[k] / w == sq[i] / w))
+                    }
 
-                                            break;
+                    if (solver->cube[sq[0] * w + i - 1] && solver->cube[sq[1] * w + j - 1]) {
 
-                                    if (k < i) continue;
+                        ctx->dscratch[0] = (digit)i;
 
-                                    break;
+                        ctx->dscratch[1] = (digit)j;
 
-                                }
+                        solver_clue_candidate(ctx, diff, box);
 
-        
+                    }
 
-                                if (j > w) {
+                }
 
-                                    i--;
+            }
 
-                                    if (i < 0) break;
+            break;
 
-                                    total ^= (int)ctx->dscratch[i]; /* Undo XOR (self-inverse) */
 
-                                } else {
 
-                                    ctx->dscratch[i++] = (digit)j;
+        case C_GCD:
+            /* Modular: a GCD is 1..w, so only one value has the residue */
+            box_layouts_gcd(solver, ctx, diff, box, modular && !value ? (unsigned long)w : value);
+            break;
 
-                                    total ^= j; /* Apply XOR */
+        case C_LCM:
+            if (modular)
+                box_layouts_lcm_modular(solver, ctx, diff, box, value);
+            else
+                box_layouts_lcm(solver, ctx, diff, box, value);
+            break;
 
-                                    ctx->dscratch[i] = 0;
+        case C_XOR:
+            box_layouts_xor(solver, ctx, diff, box, value, modular);
+            break;
 
-                                }
+    }
+}
 
-                            } else {
+/*
+ * A box's deductions at a level depend only on its own squares of the
+ * cube, so a box whose squares are as its last scan at this level left
+ * them needs no new layout search. Below HARD that scan already removed
+ * everything it could, so there is nothing to do; at HARD the saved
+ * requirements are applied again, since squares outside the box may be
+ * in another cube (a new solve, or a recursion branch).
+ */
+static int memo_level(int diff) {
+    return diff >= DIFF_HARD ? 2 : diff - DIFF_EASY;
+}
 
-                                /* Check if XOR of collected digits equals value */
+static bool box_memo_hit(const struct latin_solver* solver, const struct solver_ctx* ctx, int diff,
+                         int box) {
+    int w = ctx->w, lv = memo_level(diff);
+    const unsigned char* snap = ctx->memo_cube + (size_t)lv * w * w * w;
 
-                                if (clue_matches((unsigned long)total, value, w, modular))
-                                    solver_clue_candidate(ctx, diff, box);
+    if (ctx->collect || !ctx->memo_seen[lv * ctx->nboxes + box]) return false;
+    for (int i = ctx->boxes[box]; i < ctx->boxes[box + 1]; i++) {
+        int pos = ctx->boxlist[i] * w;
+        if (memcmp(snap + pos, solver->cube + pos, (size_t)w)) return false;
+    }
+    return true;
+}
 
-                                i--;
+static void box_memo_store(const struct latin_solver* solver, struct solver_ctx* ctx, int diff,
+                           int box) {
+    int w = ctx->w, lv = memo_level(diff);
+    unsigned char* snap = ctx->memo_cube + (size_t)lv * w * w * w;
 
-                                total ^= (int)ctx->dscratch[i]; /* Undo XOR */
+    if (ctx->collect) return;
+    for (int i = ctx->boxes[box]; i < ctx->boxes[box + 1]; i++) {
+        int pos = ctx->boxlist[i] * w;
+        memcpy(snap + pos, solver->cube + pos, (size_t)w);
+    }
+    ctx->memo_seen[lv * ctx->nboxes + box] = 1;
+}
 
-                            }
+static int solver_common(struct latin_solver* solver, void* vctx, int diff) {
+    struct solver_ctx* ctx = (struct solver_ctx*)vctx;
+    int w = ctx->w;
+    int box, i, j, k;
+    int ret = 0;
 
-                        }
+    /*
+     * Iterate over each clue box and deduce what we can.
+     */
+    for (box = 0; box < ctx->nboxes; box++) {
+        int* sq = ctx->boxlist + ctx->boxes[box];
+        int n = ctx->boxes[box + 1] - ctx->boxes[box];
+        int* req = ctx->memo_req + (size_t)box * 2 * w;
 
-                        break;
+        if (box_memo_hit(solver, ctx, diff, box)) {
+            if (diff < DIFF_HARD) continue;
+            memcpy(ctx->iscratch, req, 2 * (size_t)w * sizeof(int));
+        } else {
+            /*
+             * Initialise ctx->iscratch for this clue box. At different
+             * difficulty levels we must initialise a different amount
+             * of it to different things; see the comments in
+             * solver_clue_candidate explaining what each version does.
+             */
+            if (diff == DIFF_HARD) {
+                for (i = 0; i < 2 * w; i++) ctx->iscratch[i] = (1 << (w + 1)) - (1 << 1);
+            } else {
+                for (i = 0; i < n; i++) ctx->iscratch[i] = 0;
+            }
 
-                }
+            solver_box_layouts(solver, ctx, diff, box);
+            if (diff == DIFF_HARD) memcpy(req, ctx->iscratch, 2 * (size_t)w * sizeof(int));
+        }
 
         /*
          * Do deductions based on the information we've now
@@ -776,6 +1078,7 @@ static int solver_common(struct latin_solver* solver, void* vctx, int diff) {
 #endif
                         solver->cube[sq[i] * w + j - 1] = 0;
                         ret = 1;
+                        ctx->lastbox = box;
                     }
                 }
         } else {
@@ -820,6 +1123,7 @@ static int solver_common(struct latin_solver* solver, void* vctx, int diff) {
 #endif
                                 solver->cube[pos * w + j - 1] = 0;
                                 ret = 1;
+                                ctx->lastbox = box;
                             }
                         }
                     }
@@ -831,10 +1135,15 @@ static int solver_common(struct latin_solver* solver, void* vctx, int diff) {
              * not to generate solver diagnostics that make the
              * problem look harder than it is. (We have to do this
              * for the Hard deductions but not the Easy/Normal ones,
-             * because only the Hard deductions are cross-box.)
+             * because only the Hard deductions are cross-box.) A
+             * batched solve would only come straight back here, so it
+             * carries on through the remaining boxes.
              */
-            if (ret) return ret;
+            box_memo_store(solver, ctx, diff, box);
+            if (ret && !solver->batch) return ret;
+            continue;
         }
+        box_memo_store(solver, ctx, diff, box);
     }
 
     return ret;
@@ -908,48 +1217,236 @@ static int solver_incomprehensible(struct latin_solver* solver, void* vctx) {
 #define SOLVER(upper, title, func, lower) func,
 static usersolver_t const keen_solvers[] = {DIFFLIST(SOLVER)};
 
-int keen_solver(int w, int* dsf, clue_t* clues, digit* soln, int maxdiff, int mode_flags) {
-    int a = w * w;
-    struct solver_ctx ctx;
+/* ----------------------------------------------------------------------
+ * Branching strategies for recursion.
+ *
+ * latin_solver_recurse() on its own guesses at the first square with the
+ * fewest candidates, digits in ascending order. A cage whose clue leaves
+ * only a handful of layouts is often a far tighter choice, so these
+ * strategies count the surviving layouts of each cage (with the same
+ * enumeration the clue deductions use) and branch on them.
+ */
+
+/* Count (and with store set, record) the layouts of a box that fit the cube. */
+static int box_layouts(struct latin_solver* solver, struct solver_ctx* ctx, int box,
+                       struct layout_collector* lc, int store) {
+    lc->count = 0;
+    lc->store = store;
+    ctx->collect = lc;
+    solver_box_layouts(solver, ctx, DIFF_NORMAL, box);
+    ctx->collect = nullptr;
+    return lc->count;
+}
+
+static int box_is_open(struct latin_solver* solver, struct solver_ctx* ctx, int box) {
+    int w = ctx->w;
+    for (int k = ctx->boxes[box]; k < ctx->boxes[box + 1]; k++) {
+        int sq = ctx->boxlist[k]; /* cube order: x * w + y */
+        if (!solver->grid[(sq % w) * w + sq / w]) return 1;
+    }
+    return 0;
+}
+
+static int keen_brancher(struct latin_solver* solver, void* vctx, struct latin_branch* branch) {
+    struct solver_ctx* ctx = (struct solver_ctx*)vctx;
+    int w = ctx->w, a = w * w;
+    int strategy = ctx->branching & ~KEEN_BRANCH_VALUE_ORDER;
+    struct layout_collector lc = {0, 0, nullptr, 0};
+    int* nlayouts = ctx->iscratch; /* per box; iscratch holds at least a + 1 ints */
+    int best = -1, bestcount = w + 1, bestlayouts = 0;
+
+    /* Layout counts for every box that still has an empty square. */
+    if (strategy != KEEN_BRANCH_MRV)
+        for (int box = 0; box < ctx->nboxes; box++)
+            nlayouts[box] = box_is_open(solver, ctx, box) ? box_layouts(solver, ctx, box, &lc, 0)
+                                                          : 0;
+
+    if (strategy == KEEN_BRANCH_CAGE) {
+        int bestbox = -1;
+        for (int box = 0; box < ctx->nboxes; box++)
+            if (nlayouts[box] > 0 && (bestbox < 0 || nlayouts[box] < nlayouts[bestbox]))
+                bestbox = box;
+
+        /*
+         * Branch on that cage's layouts, unless even the tightest cage
+         * leaves more alternatives than a single square could.
+         */
+        if (bestbox >= 0 && nlayouts[bestbox] <= w) {
+            int n = ctx->boxes[bestbox + 1] - ctx->boxes[bestbox];
+            int* sq = ctx->boxlist + ctx->boxes[bestbox];
+
+            box_layouts(solver, ctx, bestbox, &lc, 1);
+            branch->nalts = lc.count;
+            branch->ncells = n;
+            branch->cells = snewn((size_t)n, int);
+            for (int k = 0; k < n; k++) branch->cells[k] = (sq[k] % w) * w + sq[k] / w;
+            branch->values = lc.layouts; /* handed over to the recursion */
+            return branch->nalts;
+        }
+    }
+
+    /* The most constrained square, ties going to the tighter cage. */
+    for (int i = 0; i < a; i++) {
+        int x = i % w, y = i / w, count = 0;
+        if (solver->grid[i]) continue;
+        for (int n = 1; n <= w; n++)
+            if (cube(x, y, n)) count++;
+        if (count < bestcount ||
+            (count == bestcount && strategy != KEEN_BRANCH_MRV &&
+             nlayouts[ctx->whichbox[x * w + y]] < bestlayouts)) {
+            best = i;
+            bestcount = count;
+            bestlayouts = strategy != KEEN_BRANCH_MRV ? nlayouts[ctx->whichbox[x * w + y]] : 0;
+        }
+    }
+    if (best < 0 || (strategy == KEEN_BRANCH_MRV && !(ctx->branching & KEEN_BRANCH_VALUE_ORDER)))
+        return 0; /* complete, or plain MRV: leave it to latin.c */
+
+    int x = best % w, y = best / w;
+    branch->ncells = 1;
+    branch->cells = snew(int);
+    branch->cells[0] = best;
+    branch->values = snewn((size_t)w, digit);
+    branch->nalts = 0;
+    for (int n = 1; n <= w; n++)
+        if (cube(x, y, n)) branch->values[branch->nalts++] = (digit)n;
+
+    if (ctx->branching & KEEN_BRANCH_VALUE_ORDER) {
+        /* Most frequent digit of the square across its cage's layouts first. */
+        int box = ctx->whichbox[x * w + y], pos = 0;
+        int n = ctx->boxes[box + 1] - ctx->boxes[box];
+        int* freq = snewn((size_t)w + 1, int);
+
+        memset(freq, 0, ((size_t)w + 1) * sizeof(int));
+
+        while (ctx->boxlist[ctx->boxes[box] + pos] != x * w + y) pos++;
+        box_layouts(solver, ctx, box, &lc, 1);
+        for (int l = 0; l < lc.count; l++) freq[lc.layouts[l * n + pos]]++;
+        sfree(lc.layouts);
+
+        /* Stable insertion sort, so equal counts stay ascending */
+        for (int i = 1; i < branch->nalts; i++) {
+            digit d = branch->values[i];
+            int j = i;
+            for (; j > 0 && freq[branch->values[j - 1]] < freq[d]; j--)
+                branch->values[j] = branch->values[j - 1];
+            branch->values[j] = d;
+        }
+        sfree(freq);
+    }
+    return branch->nalts;
+}
+
+/* latin_solver() with the context's branching strategy hooked in. */
+static int solver_run(struct solver_ctx* ctx, digit* soln, int maxdiff) {
+    struct latin_solver solver;
     int ret;
+
+    latin_solver_alloc(&solver, soln, ctx->w);
+    if (ctx->branching != KEEN_BRANCH_MRV) solver.brancher = keen_brancher;
+    solver.use_nogoods = ctx->nogoods;
+    solver.batch = ctx->batch;
+    solver.stats = ctx->stats;
+    ret = latin_solver_main(&solver, maxdiff, DIFF_EASY, DIFF_NORMAL, DIFF_HARD, DIFF_EXTREME,
+                            DIFF_INCOMPREHENSIBLE, keen_solvers, ctx, nullptr, nullptr);
+    latin_solver_free(&solver);
+    return ret;
+}
+
+/*
+ * Transform the dsf-formatted clue list into one over which we can
+ * iterate more easily. The arrays must already be large enough for a
+ * grid of width w (see solver_ctx_init).
+ *
+ * Also transpose the x- and y-coordinates at this point, because the
+ * 'cube' array in the general Latin square solver puts x first (oops).
+ */
+static void solver_ctx_fill(struct solver_ctx* ctx, int w, int* dsf, clue_t* clues, digit* soln,
+                            int maxdiff, int mode_flags) {
+    int a = w * w;
     int i, j, n, m;
 
-    ctx.w = w;
-    ctx.soln = soln;
-    ctx.diff = maxdiff;
-    ctx.mode_flags = mode_flags;
+    ctx->w = w;
+    ctx->soln = soln;
+    ctx->diff = maxdiff;
+    ctx->mode_flags = mode_flags;
+    ctx->lastbox = -1;
+    ctx->branching = KEEN_BRANCH_MRV;
+    ctx->nogoods = false;
+    ctx->batch = false;
+    ctx->stats = nullptr;
+    ctx->collect = nullptr;
 
-    /*
-     * Transform the dsf-formatted clue list into one over which we
-     * can iterate more easily.
-     *
-     * Also transpose the x- and y-coordinates at this point,
-     * because the 'cube' array in the general Latin square solver
-     * puts x first (oops).
-     */
-    for (ctx.nboxes = i = 0; i < a; i++)
-        if (dsf_canonify(dsf, i) == i) ctx.nboxes++;
-    ctx.boxlist = snewn((size_t)a, int);
-    ctx.boxes = snewn((size_t)(ctx.nboxes + 1), int);
-    ctx.clues = snewn((size_t)ctx.nboxes, clue_t);
-    ctx.whichbox = snewn((size_t)a, int);
     for (n = m = i = 0; i < a; i++)
         if (dsf_canonify(dsf, i) == i) {
-            ctx.clues[n] = clues[i];
-            ctx.boxes[n] = m;
+            ctx->clues[n] = clues[i];
+            ctx->boxes[n] = m;
             for (j = 0; j < a; j++)
                 if (dsf_canonify(dsf, j) == i) {
-                    ctx.boxlist[m++] = (j % w) * w + (j / w); /* transpose */
-                    ctx.whichbox[ctx.boxlist[m - 1]] = n;
+                    ctx->boxlist[m++] = (j % w) * w + (j / w); /* transpose */
+                    ctx->whichbox[ctx->boxlist[m - 1]] = n;
                 }
             n++;
         }
-    assert(n == ctx.nboxes);
+
     assert(m == a);
-    ctx.boxes[n] = m;
+    ctx->nboxes = n;
+    ctx->boxes[n] = m;
+    memset(ctx->memo_seen, 0, 3 * (size_t)n);
+}
 
-    ctx.dscratch = snewn((size_t)(a + 1), digit);
-    ctx.iscratch = snewn((size_t)max(a + 1, 4 * w), int);
+/* Allocate a context for nboxes cages on a w x w grid, plus the
+ * scratch space solver_common needs. */
+static void solver_ctx_alloc(struct solver_ctx* ctx, int w, int nboxes) {
+    int a = w * w;
+
+    ctx->boxlist = snewn((size_t)a, int);
+    ctx->boxes = snewn((size_t)(nboxes + 1), int);
+    ctx->clues = snewn((size_t)nboxes, clue_t);
+    ctx->whichbox = snewn((size_t)a, int);
+    ctx->dscratch = snewn((size_t)(a + 1), digit);
+    ctx->iscratch = snewn((size_t)max(a + 1, 4 * w), int);
+    ctx->lscratch = snewn((size_t)(2 * (a + 1)), unsigned long);
+    ctx->memo_cube = snewn(3 * (size_t)a * (size_t)w, unsigned char);
+    ctx->memo_seen = snewn(3 * (size_t)nboxes, unsigned char);
+    ctx->memo_req = snewn((size_t)nboxes * 2 * (size_t)w, int);
+}
+
+static void solver_ctx_init(struct solver_ctx* ctx, int w, int* dsf, clue_t* clues, digit* soln,
+                            int maxdiff, int mode_flags) {
+    int a = w * w, nboxes = 0;
+
+    for (int i = 0; i < a; i++)
+        if (dsf_canonify(dsf, i) == i) nboxes++;
+
+    solver_ctx_alloc(ctx, w, nboxes);
+    solver_ctx_fill(ctx, w, dsf, clues, soln, maxdiff, mode_flags);
+}
+
+static void solver_ctx_free(struct solver_ctx* ctx) {
+    sfree(ctx->memo_cube);
+    sfree(ctx->memo_seen);
+    sfree(ctx->memo_req);
+    sfree(ctx->dscratch);
+    sfree(ctx->iscratch);
+    sfree(ctx->lscratch);
+    sfree(ctx->whichbox);
+    sfree(ctx->boxlist);
+    sfree(ctx->boxes);
+    sfree(ctx->clues);
+}
+
+int keen_solver(int w, int* dsf, clue_t* clues, digit* soln, int maxdiff, int mode_flags) {
+    return keen_solver_branching(w, dsf, clues, soln, maxdiff, mode_flags, KEEN_BRANCH_MRV);
+}
+
+int keen_solver_branching(int w, int* dsf, clue_t* clues, digit* soln, int maxdiff,
+                          int mode_flags, int branching) {
+    struct solver_ctx ctx;
+    int ret;
+
+    solver_ctx_init(&ctx, w, dsf, clues, soln, maxdiff, mode_flags);
+    ctx.branching = branching;
 
     /*
      * latin_solver difficulty mapping for 7-level system:
@@ -962,15 +1459,397 @@ int keen_solver(int w, int* dsf, clue_t* clues, digit* soln, int maxdiff, int mo
      * UNREASONABLE and LUDICROUS are intermediate levels between EXTREME
      * and INCOMPREHENSIBLE, requiring progressively more trial-and-error.
      */
-    ret = latin_solver(soln, w, maxdiff, DIFF_EASY, DIFF_NORMAL, DIFF_HARD, DIFF_EXTREME,
-                       DIFF_INCOMPREHENSIBLE, keen_solvers, &ctx, nullptr, nullptr);
+    ret = solver_run(&ctx, soln, maxdiff);
+
+    solver_ctx_free(&ctx);
+    return ret;
+}
+
+/* ----------------------------------------------------------------------
+ * Reusable grading context.
+ *
+ * The cage tables are sized for the largest grid loaded so far, so a
+ * worker grading a stream of puzzles allocates only when the grid grows.
+ */
+
+struct keen_grader {
+    struct solver_ctx ctx;
+    int maxw;      /* grid width the arrays are sized for (0 = none yet) */
+    int branching; /* KEEN_BRANCH_* */
+    int nogoods;
+    int batch;
+    struct latin_search_stats stats;
+};
+
+keen_grader* keen_grader_new(void) {
+    keen_grader* g = snew(keen_grader);
+    memset(g, 0, sizeof(*g));
+    return g;
+}
+
+void keen_grader_free(keen_grader* g) {
+    if (!g) return;
+    if (g->maxw) solver_ctx_free(&g->ctx);
+    sfree(g);
+}
+
+void keen_grader_load(keen_grader* g, int w, int* dsf, clue_t* clues, int mode_flags) {
+    if (w > g->maxw) {
+        if (g->maxw) solver_ctx_free(&g->ctx);
+        solver_ctx_alloc(&g->ctx, w, w * w); /* every square its own cage at most */
+        g->maxw = w;
+    }
+    solver_ctx_fill(&g->ctx, w, dsf, clues, nullptr, DIFF_EASY, mode_flags);
+    g->ctx.branching = g->branching;
+    g->ctx.nogoods = g->nogoods;
+    g->ctx.batch = g->batch;
+    g->ctx.stats = &g->stats;
+}
+
+int keen_grader_solve(keen_grader* g, digit* soln, int maxdiff) {
+    struct solver_ctx* ctx = &g->ctx;
+
+    memset(soln, 0, (size_t)ctx->w * (size_t)ctx->w * sizeof(digit));
+    ctx->soln = soln;
+    ctx->diff = maxdiff;
+    ctx->lastbox = -1;
+    return solver_run(ctx, soln, maxdiff);
+}
+
+void keen_grader_set_branching(keen_grader* g, int branching) {
+    g->branching = branching;
+}
+
+void keen_grader_set_nogoods(keen_grader* g, int enable) {
+    g->nogoods = enable;
+}
+
+void keen_grader_set_batching(keen_grader* g, int enable) {
+    g->batch = enable;
+}
+
+const struct latin_search_stats* keen_grader_stats(const keen_grader* g) {
+    return &g->stats;
+}
+
+/* ----------------------------------------------------------------------
+ * Deduction traces.
+ *
+ * An observer on the deduction loop diffs the cube against a snapshot
+ * after every productive step and appends what changed: one step for a
+ * placement, or one step per square that lost candidates. Steps taken
+ * inside recursion are not recorded (subsolvers don't inherit the
+ * observer), so a trace of a puzzle that needs guessing stops where the
+ * ladder got stuck.
+ */
+
+struct trace_recorder {
+    struct solver_ctx* ctx;
+    keen_trace* trace;
+    unsigned char* prev;
+    digit* prevgrid;
+};
+
+static keen_trace_step* trace_append(keen_trace* trace) {
+    if (trace->nsteps >= trace->size) {
+        trace->size = trace->size * 3 / 2 + 32;
+        trace->steps = sresize(trace->steps, trace->size, keen_trace_step);
+    }
+    return &trace->steps[trace->nsteps++];
+}
 
-    sfree(ctx.dscratch);
-    sfree(ctx.iscratch);
-    sfree(ctx.whichbox);
-    sfree(ctx.boxlist);
-    sfree(ctx.boxes);
-    sfree(ctx.clues);
+/* Root cell (row * w + col) of a box, undoing the boxlist transposition. */
+static int box_root(const struct solver_ctx* ctx, int box) {
+    int sq = ctx->boxlist[ctx->boxes[box]];
+    return (sq % ctx->w) * ctx->w + sq / ctx->w;
+}
 
+static int trace_observer(struct latin_solver* solver, void* octx, int diff, int technique) {
+    struct trace_recorder* rec = (struct trace_recorder*)octx;
+    struct solver_ctx* ctx = rec->ctx;
+    int o = solver->o;
+    int x, y, n, k, count;
+
+    for (y = 0; y < o; y++)
+        for (x = 0; x < o; x++) {
+            int cell = y * o + x;
+            unsigned elim = 0;
+
+            if (technique == LATIN_TECH_SIMPLE) {
+                /*
+                 * The only change that matters is the one placement;
+                 * everything else it crossed out follows from it.
+                 */
+                n = solver->grid[cell];
+                if (!n || rec->prevgrid[cell]) continue;
+
+                keen_trace_step* st = trace_append(rec->trace);
+                st->cell = (int16_t)cell;
+                st->value = (uint8_t)n;
+                st->technique = (uint8_t)technique;
+                st->diff = (uint8_t)diff;
+                st->elim = 0;
+
+                /* Same priority as latin_solver_diff_simple. */
+                for (count = 0, k = 0; k < o; k++)
+                    if (rec->prev[cubepos(k, y, n)]) count++;
+                if (count == 1) {
+                    st->support_kind = KEEN_SUPPORT_ROW;
+                    st->support = (int16_t)y;
+                } else {
+                    for (count = 0, k = 0; k < o; k++)
+                        if (rec->prev[cubepos(x, k, n)]) count++;
+                    st->support_kind = count == 1 ? KEEN_SUPPORT_COL : KEEN_SUPPORT_CELL;
+                    st->support = (int16_t)(count == 1 ? x : cell);
+                }
+                continue;
+            }
+
+            for (n = 1; n <= o; n++)
+                if (rec->prev[cubepos(x, y, n)] && !cube(x, y, n)) elim |= 1U << n;
+            if (!elim) continue;
+
+            keen_trace_step* st = trace_append(rec->trace);
+            st->cell = (int16_t)cell;
+            st->value = 0;
+            st->technique = (uint8_t)technique;
+            st->diff = (uint8_t)diff;
+            st->elim = elim;
+            if (technique == LATIN_TECH_USER) {
+                /*
+                 * Below DIFF_HARD the clue deductions only touch squares
+                 * of the box being examined; the HARD ones cross boxes
+                 * but stop after the first box that helps.
+                 */
+                int box = diff >= DIFF_HARD ? ctx->lastbox : ctx->whichbox[x * o + y];
+                st->support_kind = KEEN_SUPPORT_CAGE;
+                st->support = (int16_t)box_root(ctx, box);
+            } else {
+                st->support_kind = KEEN_SUPPORT_NONE;
+                st->support = -1;
+            }
+        }
+
+    memcpy(rec->prev, solver->cube, (size_t)o * (size_t)o * (size_t)o);
+    memcpy(rec->prevgrid, solver->grid, (size_t)o * (size_t)o);
+    return 0;
+}
+
+int keen_solver_trace(int w, int* dsf, clue_t* clues, digit* soln, int maxdiff, int mode_flags,
+                      keen_trace* trace) {
+    struct solver_ctx ctx;
+    struct latin_solver solver;
+    struct trace_recorder rec;
+    int a = w * w;
+    int ret;
+
+    solver_ctx_init(&ctx, w, dsf, clues, soln, maxdiff, mode_flags);
+    latin_solver_alloc(&solver, soln, w);
+
+    trace->nsteps = 0;
+    rec.ctx = &ctx;
+    rec.trace = trace;
+    rec.prev = snewn((size_t)a * (size_t)w, unsigned char);
+    rec.prevgrid = snewn((size_t)a, digit);
+    memcpy(rec.prev, solver.cube, (size_t)a * (size_t)w);
+    memcpy(rec.prevgrid, soln, (size_t)a);
+    solver.observer = trace_observer;
+    solver.observer_ctx = &rec;
+
+    ret = latin_solver_main(&solver, maxdiff, DIFF_EASY, DIFF_NORMAL, DIFF_HARD, DIFF_EXTREME,
+                            DIFF_INCOMPREHENSIBLE, keen_solvers, &ctx, nullptr, nullptr);
+
+    sfree(rec.prevgrid);
+    sfree(rec.prev);
+    latin_solver_free(&solver);
+    solver_ctx_free(&ctx);
     return ret;
 }
+
+void keen_trace_free(keen_trace* trace) {
+    sfree(trace->steps);
+    trace->steps = nullptr;
+    trace->nsteps = trace->size = 0;
+}
+
+/* ----------------------------------------------------------------------
+ * Persistent solver sessions.
+ *
+ * A session keeps the candidate cube and the clue context alive between
+ * calls, so that a caller tracking a grid as it is edited (the hint
+ * engine) can add digits incrementally and step the deduction ladder one
+ * placement at a time, instead of re-solving the whole puzzle per query.
+ */
+
+struct keen_session {
+    struct solver_ctx ctx;
+    struct latin_solver solver;
+    digit* grid;          /* givens plus everything deduced so far */
+    unsigned char* prev;  /* cube as it was before the current step */
+    digit* prevgrid;      /* likewise for the grid */
+    int contradiction;    /* givens clash, or the ladder hit an impossibility */
+
+    /* Bookkeeping for keen_session_next(), reset after each placement. */
+    keen_deduction* found;
+    int maxdiff_used;
+    int techniques_used;
+};
+
+static void session_snapshot(keen_session* s) {
+    int o = s->ctx.w;
+    memcpy(s->prev, s->solver.cube, (size_t)o * (size_t)o * (size_t)o);
+    memcpy(s->prevgrid, s->grid, (size_t)o * (size_t)o);
+}
+
+/*
+ * Observer run after each productive step while stepping a session.
+ * Eliminations only accumulate the difficulty used; the first step that
+ * fills a square is reported back and stops the ladder.
+ */
+static int session_observer(struct latin_solver* solver, void* octx, int diff, int technique) {
+    keen_session* s = (keen_session*)octx;
+    int o = solver->o;
+    int x, y, n, k, count;
+
+    s->maxdiff_used = max(s->maxdiff_used, diff);
+    s->techniques_used |= 1 << technique;
+
+    if (technique == LATIN_TECH_SIMPLE) {
+        for (y = 0; y < o; y++)
+            for (x = 0; x < o; x++) {
+                n = solver->grid[y * o + x];
+                if (!n || s->prevgrid[y * o + x]) continue;
+
+                keen_deduction* d = s->found;
+                d->cell = y * o + x;
+                d->value = n;
+                d->diff = s->maxdiff_used;
+                d->techniques = s->techniques_used;
+
+                /*
+                 * Replay latin_solver_diff_simple's priority to say which
+                 * elimination fired: row-wise positional, then
+                 * column-wise, then numeric.
+                 */
+                for (count = 0, k = 0; k < o; k++)
+                    if (s->prev[cubepos(k, y, n)]) count++;
+                if (count == 1) {
+                    d->support = KEEN_SUPPORT_ROW;
+                } else {
+                    for (count = 0, k = 0; k < o; k++)
+                        if (s->prev[cubepos(x, k, n)]) count++;
+                    d->support = count == 1 ? KEEN_SUPPORT_COL : KEEN_SUPPORT_CELL;
+                }
+                return 1;
+            }
+    }
+
+    session_snapshot(s);
+    return 0;
+}
+
+keen_session* keen_session_new(int w, int* dsf, clue_t* clues, int mode_flags) {
+    keen_session* s = snew(keen_session);
+    int a = w * w;
+
+    s->grid = snewn((size_t)a, digit);
+    memset(s->grid, 0, (size_t)a);
+    s->prev = snewn((size_t)a * (size_t)w, unsigned char);
+    s->prevgrid = snewn((size_t)a, digit);
+
+    /*
+     * The session runs the EASY deductions too, so that hints are
+     * attributed to the weakest technique that produces them.
+     */
+    solver_ctx_init(&s->ctx, w, dsf, clues, s->grid, DIFF_EASY, mode_flags);
+    latin_solver_alloc(&s->solver, s->grid, w);
+    s->contradiction = 0;
+    s->found = nullptr;
+
+    return s;
+}
+
+void keen_session_free(keen_session* s) {
+    if (!s) return;
+    latin_solver_free(&s->solver);
+    solver_ctx_free(&s->ctx);
+    sfree(s->prevgrid);
+    sfree(s->prev);
+    sfree(s->grid);
+    sfree(s);
+}
+
+int keen_session_load(keen_session* s, const digit* grid) {
+    int w = s->ctx.w, a = w * w;
+    struct latin_solver* solver = &s->solver;
+    int i;
+
+    memset(solver->cube, true, (size_t)a * (size_t)w);
+    memset(solver->row, false, (size_t)a);
+    memset(solver->col, false, (size_t)a);
+    memset(s->grid, 0, (size_t)a);
+    s->contradiction = 0;
+
+    for (i = 0; i < a; i++)
+        if (grid[i] && !keen_session_place(s, i, grid[i])) s->contradiction = 1;
+
+    return !s->contradiction;
+}
+
+int keen_session_place(keen_session* s, int cell, int value) {
+    struct latin_solver* solver = &s->solver;
+    int w = s->ctx.w;
+    int x = cell % w, y = cell / w;
+
+    if (value < 1 || value > w) return 0;
+    if (s->grid[cell] == value) return 1;
+    if (s->grid[cell] || !cube(x, y, value)) return 0;
+
+    latin_solver_place(solver, x, y, value);
+    return 1;
+}
+
+int keen_session_next(keen_session* s, int maxdiff, keen_deduction* out) {
+    struct latin_solver* solver = &s->solver;
+    int ret;
+
+    if (s->contradiction) return -1;
+    if (maxdiff > DIFF_EXTREME) maxdiff = DIFF_EXTREME; /* never guess */
+
+    memset(out, 0, sizeof(*out));
+    s->found = out;
+    s->maxdiff_used = DIFF_EASY;
+    s->techniques_used = 0;
+    session_snapshot(s);
+
+    solver->observer = session_observer;
+    solver->observer_ctx = s;
+    ret = latin_solver_main(solver, maxdiff, DIFF_EASY, DIFF_NORMAL, DIFF_HARD, DIFF_EXTREME,
+                            DIFF_INCOMPREHENSIBLE, keen_solvers, &s->ctx, nullptr, nullptr);
+    solver->observer = nullptr;
+    s->found = nullptr;
+
+    if (ret == diff_impossible) {
+        s->contradiction = 1;
+        return -1;
+    }
+    /* Stopped by the observer: a new square was filled in. */
+    return ret == diff_unfinished && out->value ? 1 : 0;
+}
+
+int keen_session_cage_pass(keen_session* s, int diff) {
+    if (s->contradiction) return -1;
+    return solver_common(&s->solver, &s->ctx, diff);
+}
+
+unsigned keen_session_candidates(const keen_session* s, int cell) {
+    const struct latin_solver* solver = &s->solver;
+    int w = s->ctx.w;
+    int x = cell % w, y = cell / w;
+    unsigned mask = 0;
+    int n;
+
+    for (n = 1; n <= w; n++)
+        if (cube(x, y, n)) mask |= 1U << n;
+    return mask;
+}
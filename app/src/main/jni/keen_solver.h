@@ -5,4 +5,122 @@
 
 int keen_solver(int w, int* dsf, clue_t* clues, digit* soln, int maxdiff, int mode_flags);
 
+/*
+ * How recursion (DIFF_INCOMPREHENSIBLE) picks its guesses. Any strategy
+ * finds the same solutions and the same uniqueness verdict; they differ
+ * only in the size of the search tree, and in which solution is left in
+ * soln when there are several.
+ */
+#define KEEN_BRANCH_MRV 0      /* square with fewest candidates (keen_solver's default) */
+#define KEEN_BRANCH_MRV_CAGE 1 /* ...ties going to the cage with fewest layouts */
+#define KEEN_BRANCH_CAGE 2     /* every layout of the cage with fewest layouts */
+#define KEEN_BRANCH_VALUE_ORDER 0x10 /* flag: try a square's digits by how many
+                                        of its cage's layouts use them */
+
+int keen_solver_branching(int w, int* dsf, clue_t* clues, digit* soln, int maxdiff,
+                          int mode_flags, int branching);
+
+/*
+ * Solver context that is built once per puzzle and reused across solves,
+ * and whose buffers are reused across puzzles: load a puzzle, then solve
+ * it at as many levels as needed. keen_grader_solve() clears soln and
+ * returns what keen_solver() would. A grader is not thread-safe; give
+ * each thread its own.
+ */
+typedef struct keen_grader keen_grader;
+
+keen_grader* keen_grader_new(void);
+void keen_grader_free(keen_grader* g);
+void keen_grader_load(keen_grader* g, int w, int* dsf, clue_t* clues, int mode_flags);
+int keen_grader_solve(keen_grader* g, digit* soln, int maxdiff);
+void keen_grader_set_branching(keen_grader* g, int branching); /* KEEN_BRANCH_* */
+/* Cache impossible states during recursion (off by default; it never
+ * changes a verdict, only the work done). */
+void keen_grader_set_nogoods(keen_grader* g, int enable);
+/* Batched propagation (off by default; see struct latin_solver): same
+ * verdicts and grids as the one-step-per-restart ladder. */
+void keen_grader_set_batching(keen_grader* g, int enable);
+/* Recursion counters, accumulated over every solve the grader has run. */
+const struct latin_search_stats* keen_grader_stats(const keen_grader* g);
+
+/* What a deduction rests on: the latin elimination that filled a square
+ * in, or what justified an elimination step. */
+#define KEEN_SUPPORT_ROW 0  /* only place for the digit in its row */
+#define KEEN_SUPPORT_COL 1  /* only place for the digit in its column */
+#define KEEN_SUPPORT_CELL 2 /* only digit left in the square */
+#define KEEN_SUPPORT_CAGE 3 /* a clue deduction (trace elimination steps) */
+#define KEEN_SUPPORT_NONE 4 /* latin set elimination or forcing chain */
+
+/*
+ * Deduction trace: the ordered chain of steps the solver took, recorded
+ * in 12 bytes per step. A placement step has value != 0; an elimination
+ * step has value == 0 and the removed digits in elim (bit n for digit n).
+ */
+typedef struct {
+    int16_t cell;         /* row * w + col */
+    uint8_t value;        /* digit placed, or 0 for an elimination */
+    uint8_t technique;    /* LATIN_TECH_* */
+    uint8_t diff;         /* DIFF_* level the step was made at */
+    uint8_t support_kind; /* KEEN_SUPPORT_* */
+    int16_t support;      /* row, column, cell or cage root; -1 if none */
+    uint32_t elim;        /* digits eliminated from the cell */
+} keen_trace_step;
+
+typedef struct {
+    keen_trace_step* steps;
+    int nsteps, size;
+} keen_trace;
+
+/*
+ * keen_solver() that also records its deductions into *trace (which must
+ * be zero-initialised or previously used; it is overwritten). Steps made
+ * inside recursion are not recorded.
+ */
+int keen_solver_trace(int w, int* dsf, clue_t* clues, digit* soln, int maxdiff, int mode_flags,
+                      keen_trace* trace);
+void keen_trace_free(keen_trace* trace);
+
+/*
+ * Persistent solver session: the candidate cube and clue context for one
+ * puzzle, kept alive across calls so a grid being edited can be tracked
+ * incrementally and the deduction ladder stepped one placement at a time.
+ */
+typedef struct keen_session keen_session;
+
+typedef struct {
+    int cell;       /* row * w + col */
+    int value;      /* digit placed there */
+    int diff;       /* hardest DIFF_* level used since the previous placement */
+    int techniques; /* bitmask of (1 << LATIN_TECH_*) used since then */
+    int support;    /* KEEN_SUPPORT_* */
+} keen_deduction;
+
+keen_session* keen_session_new(int w, int* dsf, clue_t* clues, int mode_flags);
+void keen_session_free(keen_session* s);
+
+/* Reset the session to the givens in grid (0 = empty). Returns 0 if the
+ * givens already contradict each other. */
+int keen_session_load(keen_session* s, const digit* grid);
+
+/* Fill one more square. Returns 0 if value is not a candidate there. */
+int keen_session_place(keen_session* s, int cell, int value);
+
+/*
+ * Run the deduction ladder (never recursion) up to maxdiff until it fills
+ * in one more square, and describe that placement in *out. Returns 1 on
+ * success, 0 if no further square can be deduced, -1 on contradiction.
+ * Eliminations made along the way are kept for the next call.
+ */
+int keen_session_next(keen_session* s, int maxdiff, keen_deduction* out);
+
+/*
+ * One pass of the clue deductions at level diff (DIFF_EASY..DIFF_HARD)
+ * over every cage, without any latin reasoning. Returns 1 if candidates
+ * were eliminated, 0 if not, -1 if the session is contradictory.
+ */
+int keen_session_cage_pass(keen_session* s, int diff);
+
+/* Candidate bitmask (bit n set for digit n) of a square. */
+unsigned keen_session_candidates(const keen_session* s, int cell);
+
 #endif
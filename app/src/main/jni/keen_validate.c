@@ -5,20 +5,27 @@
  * SPDX-FileCopyrightText: Copyright (C) 2024-2025 KeenKenning Contributors
  *
  * Implements efficient validation for real-time error highlighting.
- * Row/column checks use bitmask counting for O(n) per row/column.
- * Cage checks evaluate arithmetic operations on filled cells.
+ * Row/column checks build per-digit masks for the whole grid with SIMD
+ * ORs (the dup_masks kernel, dispatched by keen_cpu.c).
+ * Cage checks evaluate arithmetic operations on filled cells; partly
+ * filled cages are checked for whether any completion can still work.
  */
 
 #include "keen_validate.h"
 
 #include <string.h>
 
+#include "keen_cpu.h"
 #include "keen_modes.h"
 #include "latin.h"   /* For digit type */
 #include "puzzles.h" /* For smalloc, sfree */
 
-/* Maximum cage size - must match kenken.c */
-#define MAXBLK 16
+/*
+ * Largest supported grid side. Scratch buffers are sized for a whole
+ * grid of it, so cages of any size fit.
+ */
+#define MAX_W 16
+#define MAX_CELLS (MAX_W * MAX_W)
 
 /* Operation codes - must match kenken.c */
 
@@ -80,77 +87,95 @@ static int clue_matches(const validate_ctx* ctx, uint64_t result, uint64_t targe
 }
 
 /*
- * Check a single row for duplicates.
- * Returns bitmask of cell indices within the row that have duplicates.
+ * Row/column duplicate detection for the whole grid at once.
+ *
+ * Each square becomes a one-hot digit mask (bit d-1 for digit d, 0 when
+ * empty) in a 16x16 lane matrix, stored both as-is and transposed. One
+ * vertical pass over a matrix ORs the masks down every lane while
+ * collecting the digits seen at least twice; over the plain matrix that
+ * gives each column's duplicated digits, over the transposed one each
+ * row's. A square is then in error iff its own bit is in the duplicate
+ * mask of its row or column, so no square needs a branch.
  */
-static int check_row_duplicates(const validate_ctx* ctx, int row, int* errors) {
-    int w = ctx->w;
-    int seen[17] = {0}; /* seen[digit] = first occurrence index + 1, or 0 if unseen */
-    int count = 0;
-
-    for (int col = 0; col < w; col++) {
-        int cell = row * w + col;
-        digit d = ctx->grid[cell];
-        if (d == 0) continue; /* Empty cell */
-
-        if (seen[d]) {
-            /* Duplicate found - mark both cells */
-            int first_cell = row * w + (seen[d] - 1);
-            errors[first_cell] |= VALID_ERR_ROW;
-            errors[cell] |= VALID_ERR_ROW;
-            count++;
-        } else {
-            seen[d] = col + 1; /* Store column + 1 (so 0 means unseen) */
-        }
-    }
-    return count;
-}
+#define DUP_LANES 16
 
 /*
- * Check a single column for duplicates.
+ * Set VALID_ERR_ROW/VALID_ERR_COL on every square whose digit repeats in
+ * its row/column. Supports w <= 16.
  */
-static int check_col_duplicates(const validate_ctx* ctx, int col, int* errors) {
+static void check_line_duplicates(const validate_ctx* ctx, int* errors) {
     int w = ctx->w;
-    int seen[17] = {0};
-    int count = 0;
-
-    for (int row = 0; row < w; row++) {
-        int cell = row * w + col;
-        digit d = ctx->grid[cell];
-        if (d == 0) continue;
-
-        if (seen[d]) {
-            int first_cell = (seen[d] - 1) * w + col;
-            errors[first_cell] |= VALID_ERR_COL;
-            errors[cell] |= VALID_ERR_COL;
-            count++;
-        } else {
-            seen[d] = row + 1;
+    uint16_t bits[DUP_LANES * DUP_LANES], bits_t[DUP_LANES * DUP_LANES];
+    uint16_t col_twice[DUP_LANES], row_twice[DUP_LANES];
+
+    memset(bits, 0, sizeof(bits));
+    memset(bits_t, 0, sizeof(bits_t));
+    for (int row = 0; row < w; row++)
+        for (int col = 0; col < w; col++) {
+            uint16_t b = (uint16_t)((1U << ctx->grid[row * w + col]) >> 1);
+            bits[row * DUP_LANES + col] = b;
+            bits_t[col * DUP_LANES + row] = b;
         }
-    }
-    return count;
-}
 
-/*
- * Collect all cells belonging to a cage and their values.
- * Returns number of filled cells (-1 if cage is incomplete).
- */
-static int collect_cage(const validate_ctx* ctx, int root, int* cells, digit* values,
-                        int* total_cells) {
-    int w = ctx->w;
-    int n = w * w;
-    int filled = 0;
-    *total_cells = 0;
+    const keen_kernels* k = keen_kernels_get();
+    k->dup_masks(bits, w, col_twice);
+    k->dup_masks(bits_t, w, row_twice);
 
-    for (int i = 0; i < n; i++) {
-        if (dsf_canonify(ctx->dsf, i) == root) {
-            cells[*total_cells] = i;
-            values[*total_cells] = ctx->grid[i];
-            if (ctx->grid[i] != 0) filled++;
-            (*total_cells)++;
+    for (int row = 0; row < w; row++)
+        for (int col = 0; col < w; col++) {
+            uint16_t b = bits[row * DUP_LANES + col];
+            errors[row * w + col] |= VALID_ERR_ROW * ((b & row_twice[row]) != 0) |
+                                     VALID_ERR_COL * ((b & col_twice[col]) != 0);
         }
+}
+
+cage_index* kenken_cage_index_new(int w, int* dsf) {
+    int a = w * w;
+    cage_index* idx = snew(cage_index);
+    int* cage_of_root = snewn((size_t)a, int);
+    int k;
+
+    idx->w = w;
+    idx->ncages = 0;
+    idx->maxsize = 0;
+    idx->cells = snewn((size_t)a, int);
+    idx->cage_of = snewn((size_t)a, int);
+    idx->start = snewn((size_t)a + 1, int);
+    idx->root = snewn((size_t)a, int);
+
+    /* Number the cages in order of their roots, counting members */
+    for (int i = 0; i < a; i++) cage_of_root[i] = -1;
+    for (int i = 0; i < a; i++) {
+        int root = dsf_canonify(dsf, i);
+        if (cage_of_root[root] < 0) {
+            cage_of_root[root] = idx->ncages;
+            idx->root[idx->ncages] = root;
+            idx->start[++idx->ncages] = 0;
+        }
+        idx->cage_of[i] = cage_of_root[root];
+        idx->start[idx->cage_of[i] + 1]++;
+    }
+
+    /* Prefix sums, then scatter the members in square order */
+    idx->start[0] = 0;
+    for (k = 0; k < idx->ncages; k++) {
+        idx->maxsize = max(idx->maxsize, idx->start[k + 1]);
+        idx->start[k + 1] += idx->start[k];
+        cage_of_root[k] = idx->start[k]; /* reused as the fill cursor */
     }
-    return filled;
+    for (int i = 0; i < a; i++) idx->cells[cage_of_root[idx->cage_of[i]]++] = i;
+
+    sfree(cage_of_root);
+    return idx;
+}
+
+void kenken_cage_index_free(cage_index* idx) {
+    if (!idx) return;
+    sfree(idx->cells);
+    sfree(idx->cage_of);
+    sfree(idx->start);
+    sfree(idx->root);
+    sfree(idx);
 }
 
 /*
@@ -271,54 +296,195 @@ static int check_cage_constraint(const validate_ctx* ctx, int root, digit* value
     }
 }
 
+/*
+ * Digits placed in each row and column, as bitmasks (bit d for digit d).
+ */
+static void line_masks(const validate_ctx* ctx, unsigned* rowused, unsigned* colused) {
+    int w = ctx->w;
+
+    memset(rowused, 0, (size_t)w * sizeof(unsigned));
+    memset(colused, 0, (size_t)w * sizeof(unsigned));
+    for (int i = 0; i < w * w; i++) {
+        if (ctx->grid[i] == 0) continue;
+        rowused[i / w] |= 1U << ctx->grid[i];
+        colused[i % w] |= 1U << ctx->grid[i];
+    }
+}
+
+/*
+ * Check whether a partly filled cage can still be completed to meet its
+ * clue, each empty cell taking any digit not already in its row or
+ * column. Only necessary conditions are tested (digit-range bounds,
+ * divisibility, reachable XOR values), so a cage is never flagged while
+ * some completion exists. Returns 1 if feasible, 0 if not.
+ */
+static int check_cage_feasible(const validate_ctx* ctx, int root, const int* cells, digit* values,
+                               int ncells, const unsigned* rowused, const unsigned* colused) {
+    int w = ctx->w;
+    clue_t uclue = ctx->clues[root];
+    uint64_t target = uclue & ~CMASK;
+    uint64_t op = uclue & CMASK;
+    int modular = HAS_MODE(ctx->mode_flags, MODE_MODULAR);
+    unsigned full = (2U << w) - 2, cand[MAX_CELLS], seen = 0;
+    int empty[MAX_CELLS], nempty = 0, i;
+
+    for (i = 0; i < ncells; i++) {
+        if (values[i] != 0) {
+            /* Killer mode: a repeated digit can never be completed */
+            if (HAS_MODE(ctx->mode_flags, MODE_KILLER) && (seen & (1U << values[i]))) return 0;
+            seen |= 1U << values[i];
+            continue;
+        }
+        cand[nempty] = full & ~(rowused[cells[i] / w] | colused[cells[i] % w]);
+        if (cand[nempty] == 0) return 1; /* Row/column dead end, not the cage's fault */
+        empty[nempty++] = i;
+    }
+    if (nempty == 0 || nempty == ncells) return 1;
+
+    /* One cell left: try each of its digits against the clue itself. */
+    if (nempty == 1) {
+        int feasible = 0;
+        for (unsigned c = cand[0]; c && !feasible; c &= c - 1) {
+            values[empty[0]] = (digit)__builtin_ctz(c);
+            feasible = check_cage_constraint(ctx, root, values, ncells);
+        }
+        values[empty[0]] = 0;
+        return feasible;
+    }
+
+    if (modular) return 1; /* Any residue is almost always reachable */
+
+    switch (op) {
+        case C_ADD: {
+            uint64_t lo = 0, hi = 0;
+            for (i = 0; i < ncells; i++) lo += values[i], hi += values[i];
+            for (i = 0; i < nempty; i++) {
+                lo += (uint64_t)__builtin_ctz(cand[i]);
+                hi += (uint64_t)(31 - __builtin_clz(cand[i]));
+            }
+            return lo <= target && target <= hi;
+        }
+
+        case C_MUL: {
+            uint64_t prod = 1, lo = 1, hi = 1;
+            for (i = 0; i < ncells; i++)
+                if (values[i]) prod *= values[i];
+            if (target % prod != 0) return 0;
+            target /= prod;
+            for (i = 0; i < nempty; i++) {
+                lo *= (uint64_t)__builtin_ctz(cand[i]);
+                hi *= (uint64_t)(31 - __builtin_clz(cand[i]));
+                if (lo > target) return 0;
+                if (hi > target) hi = target; /* Saturate: only hi < target matters */
+            }
+            return hi >= target;
+        }
+
+        case C_GCD: {
+            /* Every digit must be a multiple of the clue */
+            for (i = 0; i < ncells; i++)
+                if (values[i] && (target == 0 || values[i] % target != 0)) return 0;
+            for (i = 0; i < nempty; i++) {
+                unsigned ok = 0;
+                for (uint64_t d = target; d > 0 && d <= (uint64_t)w; d += target) ok |= 1U << d;
+                if (!(cand[i] & ok)) return 0;
+            }
+            return 1;
+        }
+
+        case C_LCM: {
+            /* Every digit must divide the clue */
+            for (i = 0; i < ncells; i++)
+                if (values[i] && target % values[i] != 0) return 0;
+            for (i = 0; i < nempty; i++) {
+                unsigned ok = 0;
+                for (int d = 1; d <= w; d++)
+                    if (target % (uint64_t)d == 0) ok |= 1U << d;
+                if (!(cand[i] & ok)) return 0;
+            }
+            return 1;
+        }
+
+        case C_XOR: {
+            /* Reachable XOR values as a 32-bit set (digits are below 32) */
+            uint32_t reach = 1;
+            for (i = 0; i < ncells; i++)
+                if (values[i]) reach = 1U << (__builtin_ctz(reach) ^ values[i]);
+            for (i = 0; i < nempty; i++) {
+                uint32_t next = 0;
+                for (uint32_t r = reach; r; r &= r - 1)
+                    for (unsigned c = cand[i]; c; c &= c - 1)
+                        next |= 1U << (__builtin_ctz(r) ^ __builtin_ctz(c));
+                reach = next;
+            }
+            return target < 32 && (reach & (1U << target));
+        }
+
+        default:
+            return 1; /* Two-cell ops are only decidable with one cell left */
+    }
+}
+
+/*
+ * Check cage k: VALID_ERR_CAGE if it is full and wrong,
+ * VALID_ERR_CAGE_INFEASIBLE if it is partly filled and can no longer be
+ * completed, otherwise VALID_OK.
+ */
+static int check_cage(const validate_ctx* ctx, const cage_index* idx, int k,
+                      const unsigned* rowused, const unsigned* colused) {
+    const int* cells = idx->cells + idx->start[k];
+    int ncells = idx->start[k + 1] - idx->start[k];
+    int root = idx->root[k];
+    digit values[MAX_CELLS];
+    int filled = 0;
+
+    for (int j = 0; j < ncells; j++) {
+        values[j] = ctx->grid[cells[j]];
+        filled += values[j] != 0;
+    }
+
+    if (filled == ncells)
+        return check_cage_constraint(ctx, root, values, ncells) ? VALID_OK : VALID_ERR_CAGE;
+    if (filled > 0 && !check_cage_feasible(ctx, root, cells, values, ncells, rowused, colused))
+        return VALID_ERR_CAGE_INFEASIBLE;
+    return VALID_OK;
+}
+
 /*
  * Validate entire grid.
  */
 int kenken_validate_grid(const validate_ctx* ctx, int* errors) {
     int w = ctx->w;
     int n = w * w;
-    int row, col, i;
+    int i;
 
     /* Clear error array */
     memset(errors, 0, (size_t)n * sizeof(int));
 
-    /* Check rows */
-    for (row = 0; row < w; row++) {
-        check_row_duplicates(ctx, row, errors);
-    }
+    /* Check rows and columns */
+    check_line_duplicates(ctx, errors);
 
-    /* Check columns */
-    for (col = 0; col < w; col++) {
-        check_col_duplicates(ctx, col, errors);
-    }
+    /* Check cages, walking each one's members through the index */
+    const cage_index* idx = ctx->cages;
+    cage_index* own = nullptr;
+    unsigned rowused[MAX_W], colused[MAX_W];
 
-    /* Check cages - only fully filled ones */
-    int* checked = (int*)smalloc((size_t)n * sizeof(int));
-    memset(checked, 0, (size_t)n * sizeof(int));
+    if (!idx || idx->w != w) idx = own = kenken_cage_index_new(w, ctx->dsf);
+    line_masks(ctx, rowused, colused);
 
-    digit values[MAXBLK + 1];
-    int cells[MAXBLK + 1];
+    for (int k = 0; k < idx->ncages; k++) {
+        int flag = check_cage(ctx, idx, k, rowused, colused);
+        if (flag == VALID_OK) continue;
 
-    for (i = 0; i < n; i++) {
-        int root = dsf_canonify(ctx->dsf, i);
-        if (checked[root]) continue;
-        checked[root] = 1;
-
-        int total_cells;
-        int filled = collect_cage(ctx, root, cells, values, &total_cells);
-
-        /* Only validate if cage is completely filled */
-        if (filled == total_cells && total_cells > 0) {
-            if (!check_cage_constraint(ctx, root, values, total_cells)) {
-                /* Mark all cells in this cage with cage error */
-                for (int j = 0; j < total_cells; j++) {
-                    errors[cells[j]] |= VALID_ERR_CAGE;
-                }
-            }
+        /* A wrong full cage marks all its cells; an infeasible one only
+         * the digits the player entered, as the empty cells are not at fault */
+        for (int j = idx->start[k]; j < idx->start[k + 1]; j++) {
+            int cell = idx->cells[j];
+            if (flag == VALID_ERR_CAGE || ctx->grid[cell] != 0) errors[cell] |= flag;
         }
     }
 
-    sfree(checked);
+    kenken_cage_index_free(own);
 
     /* Count actual cells with errors */
     int error_count = 0;
@@ -358,18 +524,14 @@ int kenken_validate_cell(const validate_ctx* ctx, int cell) {
     }
 
     /* Check cage constraint */
-    int root = dsf_canonify(ctx->dsf, cell);
-    int total_cells;
-    digit values[MAXBLK + 1];
-    int cells[MAXBLK + 1];
-
-    int filled = collect_cage(ctx, root, cells, values, &total_cells);
-
-    if (filled == total_cells && total_cells > 0) {
-        if (!check_cage_constraint(ctx, root, values, total_cells)) {
-            result |= VALID_ERR_CAGE;
-        }
-    }
+    const cage_index* idx = ctx->cages;
+    cage_index* own = nullptr;
+    unsigned rowused[MAX_W], colused[MAX_W];
+
+    if (!idx || idx->w != w) idx = own = kenken_cage_index_new(w, ctx->dsf);
+    line_masks(ctx, rowused, colused);
+    result |= check_cage(ctx, idx, idx->cage_of[cell], rowused, colused);
+    kenken_cage_index_free(own);
 
     return result;
 }
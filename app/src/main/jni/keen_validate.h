@@ -9,6 +9,7 @@
  *   - Row uniqueness (Latin square constraint)
  *   - Column uniqueness (Latin square constraint)
  *   - Cage constraint satisfaction (arithmetic operations)
+ *   - Cage feasibility (a partly filled cage can still reach its clue)
  */
 
 #ifndef KENKEN_VALIDATE_H
@@ -24,6 +25,29 @@
 #define VALID_ERR_ROW 0x01  /* Duplicate in row */
 #define VALID_ERR_COL 0x02  /* Duplicate in column */
 #define VALID_ERR_CAGE 0x04 /* Cage constraint violated */
+#define VALID_ERR_CAGE_INFEASIBLE 0x08 /* Partly filled cage can no longer meet its clue */
+
+/*
+ * Cage index in CSR form, built once per puzzle: the squares of cage k
+ * are cells[start[k]] .. cells[start[k + 1] - 1] and its clue is at
+ * clues[root[k]].
+ */
+typedef struct {
+    int w;        /* Grid width the index was built for */
+    int ncages;
+    int maxsize;  /* Size of the largest cage */
+    int* start;   /* ncages + 1 offsets into cells */
+    int* cells;   /* Member squares, grouped by cage */
+    int* root;    /* DSF root (clue index) of each cage */
+    int* cage_of; /* Cage number of each square */
+} cage_index;
+
+/*
+ * Build the index for a w*w puzzle; free with kenken_cage_index_free.
+ * Validation ignores an index whose w does not match the context's.
+ */
+cage_index* kenken_cage_index_new(int w, int* dsf);
+void kenken_cage_index_free(cage_index* idx);
 
 /*
  * Validation context passed from JNI layer.
@@ -35,6 +59,7 @@ typedef struct {
     int* dsf;       /* Disjoint set forest for cage membership */
     clue_t* clues;    /* Cage clues with operation encoded in upper bits */
     int mode_flags; /* Mode flags for special rules (e.g., MODE_KILLER) */
+    const cage_index* cages; /* Cage index for this w, or nullptr to build one per call */
 } validate_ctx;
 
 /*
@@ -32,11 +32,11 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "maxflow.h"
 #include "puzzles.h"
-#include "tree234.h"
 
 #ifdef STANDALONE_LATIN_TEST
 #define STANDALONE_SOLVER
@@ -163,8 +163,30 @@ int latin_solver_elim(struct latin_solver* solver, int start, int step
     return 0;
 }
 
+/*
+ * Set elimination keeps, for matrices of up to SET_TABLE_MAX rows, a
+ * table of how many rows fit inside each column subset, so each
+ * candidate set costs a lookup rather than a pass over the matrix.
+ */
+#define SET_TABLE_MAX 16
+#define SET_BYTE_SIGNS 0x8080808080808080ULL
+
+/* Forcing chains keep a bitmask of squares per row and column up to this order */
+#define CHAIN_MASK_MAX 32
+
+/* Add eight signed bytes at once, without carries between them */
+static inline uint64_t set_bytes_add(uint64_t a, uint64_t b) {
+    return ((a & ~SET_BYTE_SIGNS) + (b & ~SET_BYTE_SIGNS)) ^ ((a ^ b) & SET_BYTE_SIGNS);
+}
+
 struct latin_solver_scratch {
     unsigned char *grid, *rowidx, *colidx, *set;
+    uint64_t* fit; /* [1 << min(o, SET_TABLE_MAX)] bytes */
+    unsigned char *slice, *settled; /* [o*o], [3*o][o*o] */
+    unsigned char* settled_ok;      /* [3*o] */
+    uint32_t *chain_row, *chain_col;   /* [o][o+1]: candidate bitmasks, see forcing */
+    uint32_t *chain_vrow, *chain_vcol; /* [o]: visited squares by row and column */
+    unsigned char* chain_pair;         /* [o*o]: sum of a bivalue square's numbers */
     int *neighbours, *bfsqueue;
 #ifdef STANDALONE_SOLVER
     int* bfsprev;
@@ -231,9 +253,78 @@ int latin_solver_set(struct latin_solver* solver, struct latin_solver_scratch* s
      * columns) whose width and height add up to n.
      */
 
+    /*
+     * If the matrix is small enough, tabulate for every subset T of
+     * the columns how many rows have all their 1s inside T, less the
+     * size of T; the sets worth looking at are exactly those where
+     * this is non-negative. Column j is bit n-1-j, so that the binary
+     * increment below is just counting up, and a row has a zero in
+     * every position of `set' iff it fits inside the complement.
+     */
+    uint64_t* fitw = n >= 3 && n <= SET_TABLE_MAX ? scratch->fit : nullptr;
+    signed char* fit = (signed char*)fitw;
+    uint32_t full = n < 32 ? (1U << n) - 1 : ~0U, cur = 0;
+    uint32_t rowmask[SET_TABLE_MAX];
+    if (fit) {
+        uint32_t words = (full + 1) / 8;
+        memset(fit, 0, (size_t)1 << n);
+        for (i = 0; i < n; i++) {
+            uint32_t m = 0;
+            for (j = 0; j < n; j++)
+                if (grid[i * o + j]) m |= 1U << (n - 1 - j);
+            rowmask[i] = m;
+            fit[m]++;
+            fit[1U << i]--;
+        }
+        /* Sum over subsets: bytewise within a word, then word by word */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        for (uint32_t t = 0; t < words; t++) {
+            uint64_t v = fitw[t];
+            v = set_bytes_add(v, (v << 8) & 0xFF00FF00FF00FF00ULL);
+            v = set_bytes_add(v, (v << 16) & 0xFFFF0000FFFF0000ULL);
+            fitw[t] = set_bytes_add(v, (v << 32) & 0xFFFFFFFF00000000ULL);
+        }
+#else
+        for (uint32_t bit = 1; bit < 8; bit <<= 1)
+            for (uint32_t base = 0; base <= full; base += 2 * bit)
+                for (uint32_t t = base + bit; t < base + 2 * bit; t++) fit[t] += fit[t - bit];
+#endif
+        for (uint32_t bit = 1; bit < words; bit <<= 1)
+            for (uint32_t base = 0; base < words; base += 2 * bit)
+                for (uint32_t t = base + bit; t < base + 2 * bit; t++)
+                    fitw[t] = set_bytes_add(fitw[t], fitw[t - bit]);
+    }
+
     memset(set, 0, (size_t)n);
     count = 0;
     while (1) {
+        /*
+         * With the table, skip straight to the next candidate set
+         * that is either contradictory or would eliminate something
+         * (some row straddles its complement), and only then spell
+         * it out in `set'.
+         */
+        if (fit) {
+            int c = 0;
+            for (; cur <= full; cur++) {
+                uint32_t u = full & ~cur;
+                if (!(~fitw[u >> 3] & SET_BYTE_SIGNS)) {
+                    cur |= 7; /* nothing in this word */
+                    continue;
+                }
+                if (fit[u] < 0) continue;
+                c = __builtin_popcount(cur);
+                if (c <= 1 || c >= n - 1) continue;
+                if (fit[u] > 0) break;
+                for (i = 0; i < n; i++)
+                    if ((rowmask[i] & u) && (rowmask[i] & cur)) break;
+                if (i < n) break;
+            }
+            if (cur > full) break; /* done */
+            for (j = 0; j < n; j++) set[j] = (cur >> (n - 1 - j)) & 1;
+            count = c;
+        }
+
         /*
          * We have a candidate set. If its size is <=1 or >=n-1
          * then we move on immediately.
@@ -245,15 +336,18 @@ int latin_solver_set(struct latin_solver* solver, struct latin_solver_scratch* s
              * the positions listed in `set'.
              */
             int rows = 0;
-            for (i = 0; i < n; i++) {
-                int ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i * o + j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok) rows++;
-            }
+            if (fit)
+                rows = fit[full & ~cur] + n - count;
+            else
+                for (i = 0; i < n; i++) {
+                    int ok = true;
+                    for (j = 0; j < n; j++)
+                        if (set[j] && grid[i * o + j]) {
+                            ok = false;
+                            break;
+                        }
+                    if (ok) rows++;
+                }
 
             /*
              * We expect never to be able to get _more_ than
@@ -341,6 +435,7 @@ int latin_solver_set(struct latin_solver* solver, struct latin_solver_scratch* s
          * Binary increment: change the rightmost 0 to a 1, and
          * change all 1s to the right of it to 0s.
          */
+        cur++;
         i = n;
         while (i > 0 && set[i - 1]) set[--i] = 0, count--;
         if (i > 0) {
@@ -390,7 +485,7 @@ int latin_solver_set(struct latin_solver* solver, struct latin_solver_scratch* s
  * To find forcing chains, we're going to start a bfs at each
  * suitable square, once for each of its two possible numbers.
  */
-int latin_solver_forcing(struct latin_solver* solver, struct latin_solver_scratch* scratch) {
+int latin_solver_forcing_scan(struct latin_solver* solver, struct latin_solver_scratch* scratch) {
     int o = solver->o;
 #ifdef STANDALONE_SOLVER
     char** names = solver->names;
@@ -534,6 +629,116 @@ int latin_solver_forcing(struct latin_solver* solver, struct latin_solver_scratc
     return 0;
 }
 
+/*
+ * The same search, in the same order, for o <= CHAIN_MASK_MAX: the
+ * candidates are gathered once into per-row and per-column bitmasks
+ * for each number, along with which squares are bivalue, so a bfs
+ * step takes the unvisited neighbours holding currn straight from a
+ * mask instead of rescanning the cube for every square it looks at.
+ * Rebuilding the masks on each call is a single pass over the cube,
+ * no dearer than finding out which candidates changed since the last.
+ */
+int latin_solver_forcing(struct latin_solver* solver, struct latin_solver_scratch* scratch) {
+    int o = solver->o;
+#ifdef STANDALONE_SOLVER
+    char** names = solver->names;
+    int* bfsprev = scratch->bfsprev;
+#endif
+    if (o > CHAIN_MASK_MAX) return latin_solver_forcing_scan(solver, scratch);
+
+    uint32_t *rowc = scratch->chain_row, *colc = scratch->chain_col;
+    uint32_t *vrow = scratch->chain_vrow, *vcol = scratch->chain_vcol;
+    unsigned char* pair = scratch->chain_pair;
+    unsigned char* number = scratch->grid;
+    int* bfsqueue = scratch->bfsqueue;
+    int x, y, n;
+
+    memset(rowc, 0, (size_t)o * (size_t)(o + 1) * sizeof(uint32_t));
+    memset(colc, 0, (size_t)o * (size_t)(o + 1) * sizeof(uint32_t));
+    for (y = 0; y < o; y++)
+        for (x = 0; x < o; x++) {
+            int count = 0, t = 0;
+            for (n = 1; n <= o; n++)
+                if (cube(x, y, n)) {
+                    rowc[y * (o + 1) + n] |= 1U << x;
+                    colc[x * (o + 1) + n] |= 1U << y;
+                    count++, t += n;
+                }
+            pair[y * o + x] = (unsigned char)(count == 2 ? t : 0);
+        }
+
+    for (y = 0; y < o; y++)
+        for (x = 0; x < o; x++) {
+            int t = pair[y * o + x];
+            if (!t) continue;
+
+            for (n = 1; n <= o; n++)
+                if (cube(x, y, n)) {
+                    int orign = n, head = 0, tail = 0;
+
+                    memset(vrow, 0, (size_t)o * sizeof(uint32_t));
+                    memset(vcol, 0, (size_t)o * sizeof(uint32_t));
+                    bfsqueue[tail++] = y * o + x;
+                    vrow[y] |= 1U << x, vcol[x] |= 1U << y;
+#ifdef STANDALONE_SOLVER
+                    bfsprev[y * o + x] = -1;
+#endif
+                    number[y * o + x] = (unsigned char)(t - n);
+
+                    while (head < tail) {
+                        int xx = bfsqueue[head] % o, yy = bfsqueue[head] / o;
+                        int currn = number[bfsqueue[head++]];
+
+                        /* The column through xx,yy first, then the row */
+                        for (int side = 0; side < 2; side++) {
+                            uint32_t m = side == 0 ? colc[xx * (o + 1) + currn] & ~vcol[xx]
+                                                   : rowc[yy * (o + 1) + currn] & ~vrow[yy];
+                            while (m) {
+                                int k = __builtin_ctz(m), xt = side ? k : xx, yt = side ? yy : k;
+                                m &= m - 1;
+
+                                int tt = pair[yt * o + xt];
+                                if (tt) {
+                                    bfsqueue[tail++] = yt * o + xt;
+                                    vrow[yt] |= 1U << xt, vcol[xt] |= 1U << yt;
+#ifdef STANDALONE_SOLVER
+                                    bfsprev[yt * o + xt] = yy * o + xx;
+#endif
+                                    number[yt * o + xt] = (unsigned char)(tt - currn);
+                                }
+
+                                if (currn == orign && (xt == x || yt == y)) {
+#ifdef STANDALONE_SOLVER
+                                    if (solver_show_working) {
+                                        char* sep = "";
+                                        int xl = xx, yl = yy;
+                                        printf("%*sforcing chain, %s at ends of ",
+                                               solver_recurse_depth * 4, "", names[orign - 1]);
+                                        while (1) {
+                                            printf("%s(%d,%d)", sep, xl + 1, yl + 1);
+                                            xl = bfsprev[yl * o + xl];
+                                            if (xl < 0) break;
+                                            yl = xl / o;
+                                            xl %= o;
+                                            sep = "-";
+                                        }
+                                        printf("\n%*s  ruling out %s at (%d,%d)\n",
+                                               solver_recurse_depth * 4, "", names[orign - 1],
+                                               xt + 1, yt + 1);
+                                    }
+#endif
+                                    cube(xt, yt, orign) = false;
+                                    return 1;
+                                }
+                            }
+                        }
+                    }
+                }
+        }
+
+    return 0;
+}
+
 struct latin_solver_scratch* latin_solver_new_scratch(struct latin_solver* solver) {
     struct latin_solver_scratch* scratch = snew(struct latin_solver_scratch);
     int o = solver->o;
@@ -541,6 +746,22 @@ struct latin_solver_scratch* latin_solver_new_scratch(struct latin_solver* solve
     scratch->rowidx = snewn((size_t)o, unsigned char);
     scratch->colidx = snewn((size_t)o, unsigned char);
     scratch->set = snewn((size_t)o, unsigned char);
+    scratch->fit = snewn(((size_t)1 << min(o, SET_TABLE_MAX)) / 8 + 1, uint64_t);
+    scratch->slice = snewn((size_t)o * (size_t)o, unsigned char);
+    scratch->settled = snewn((size_t)3 * (size_t)o * (size_t)o * (size_t)o, unsigned char);
+    scratch->settled_ok = snewn((size_t)3 * (size_t)o, unsigned char);
+    memset(scratch->settled_ok, false, (size_t)3 * (size_t)o);
+    if (o <= CHAIN_MASK_MAX) {
+        scratch->chain_row = snewn((size_t)o * (size_t)(o + 1), uint32_t);
+        scratch->chain_col = snewn((size_t)o * (size_t)(o + 1), uint32_t);
+        scratch->chain_vrow = snewn((size_t)o, uint32_t);
+        scratch->chain_vcol = snewn((size_t)o, uint32_t);
+        scratch->chain_pair = snewn((size_t)o * (size_t)o, unsigned char);
+    } else {
+        scratch->chain_row = scratch->chain_col = nullptr;
+        scratch->chain_vrow = scratch->chain_vcol = nullptr;
+        scratch->chain_pair = nullptr;
+    }
     scratch->neighbours = snewn((size_t)3 * (size_t)o, int);
     scratch->bfsqueue = snewn((size_t)o * (size_t)o, int);
 #ifdef STANDALONE_SOLVER
@@ -555,6 +776,15 @@ void latin_solver_free_scratch(struct latin_solver_scratch* scratch) {
 #endif
     sfree(scratch->bfsqueue);
     sfree(scratch->neighbours);
+    sfree(scratch->chain_pair);
+    sfree(scratch->chain_vcol);
+    sfree(scratch->chain_vrow);
+    sfree(scratch->chain_col);
+    sfree(scratch->chain_row);
+    sfree(scratch->settled_ok);
+    sfree(scratch->settled);
+    sfree(scratch->slice);
+    sfree(scratch->fit);
     sfree(scratch->set);
     sfree(scratch->colidx);
     sfree(scratch->rowidx);
@@ -579,6 +809,14 @@ void latin_solver_alloc(struct latin_solver* solver, digit* grid, int o) {
         for (y = 0; y < o; y++)
             if (grid[y * o + x]) latin_solver_place(solver, x, y, grid[y * o + x]);
 
+    solver->observer = nullptr;
+    solver->observer_ctx = nullptr;
+    solver->brancher = nullptr;
+    solver->use_nogoods = false;
+    solver->nogoods = nullptr;
+    solver->stats = nullptr;
+    solver->batch = false;
+
 #ifdef STANDALONE_SOLVER
     solver->names = nullptr;
 #endif
@@ -646,6 +884,30 @@ int latin_solver_diff_simple(struct latin_solver* solver) {
     return 0;
 }
 
+/*
+ * Set elimination on a line depends only on that line's slice of the
+ * cube, so a line which yielded nothing last time is skipped until its
+ * slice changes. Line k is row k, column k-o or number k-2o+1.
+ */
+static bool set_line_settled(struct latin_solver* solver, struct latin_solver_scratch* scratch,
+                             int line, int start, int step1, int step2) {
+    int i, j, o = solver->o;
+    unsigned char* slice = scratch->slice;
+
+    for (i = 0; i < o; i++)
+        for (j = 0; j < o; j++) slice[i * o + j] = solver->cube[start + i * step1 + j * step2];
+    return scratch->settled_ok[line] &&
+           !memcmp(slice, scratch->settled + (size_t)line * o * o, (size_t)o * o);
+}
+
+static void set_line_settle(struct latin_solver* solver, struct latin_solver_scratch* scratch,
+                            int line) {
+    int o = solver->o;
+
+    memcpy(scratch->settled + (size_t)line * o * o, scratch->slice, (size_t)o * o);
+    scratch->settled_ok[line] = true;
+}
+
 int latin_solver_diff_set(struct latin_solver* solver, struct latin_solver_scratch* scratch,
                           int extreme) {
     int x, y, n, ret, o = solver->o;
@@ -658,6 +920,7 @@ int latin_solver_diff_set(struct latin_solver* solver, struct latin_solver_scrat
          * Row-wise set elimination.
          */
         for (y = 0; y < o; y++) {
+            if (set_line_settled(solver, scratch, y, cubepos(0, y, 1), o * o, 1)) continue;
             ret = latin_solver_set(solver, scratch, cubepos(0, y, 1), o * o, 1
 #ifdef STANDALONE_SOLVER
                                    ,
@@ -665,11 +928,13 @@ int latin_solver_diff_set(struct latin_solver* solver, struct latin_solver_scrat
 #endif
             );
             if (ret != 0) return ret;
+            set_line_settle(solver, scratch, y);
         }
         /*
          * Column-wise set elimination.
          */
         for (x = 0; x < o; x++) {
+            if (set_line_settled(solver, scratch, o + x, cubepos(x, 0, 1), o, 1)) continue;
             ret = latin_solver_set(solver, scratch, cubepos(x, 0, 1), o, 1
 #ifdef STANDALONE_SOLVER
                                    ,
@@ -677,6 +942,7 @@ int latin_solver_diff_set(struct latin_solver* solver, struct latin_solver_scrat
 #endif
             );
             if (ret != 0) return ret;
+            set_line_settle(solver, scratch, o + x);
         }
     } else {
         /*
@@ -684,6 +950,8 @@ int latin_solver_diff_set(struct latin_solver* solver, struct latin_solver_scrat
          * (much tricker for a human to do!)
          */
         for (n = 1; n <= o; n++) {
+            if (set_line_settled(solver, scratch, 2 * o + n - 1, cubepos(0, 0, n), o * o, o))
+                continue;
             ret = latin_solver_set(solver, scratch, cubepos(0, 0, n), o * o, o
 #ifdef STANDALONE_SOLVER
                                    ,
@@ -691,11 +959,128 @@ int latin_solver_diff_set(struct latin_solver* solver, struct latin_solver_scrat
 #endif
             );
             if (ret != 0) return ret;
+            set_line_settle(solver, scratch, 2 * o + n - 1);
         }
     }
     return 0;
 }
 
+/*
+ * Nogood table.
+ *
+ * A bounded, always-replace hash table of search states proven to have
+ * no solution. A state is the candidate cube plus the set of filled
+ * squares, which between them determine everything the deductions and
+ * the recursion below will do; its key is the XOR of a fixed random
+ * word per set cube bit and per filled square. Only the 64-bit key is
+ * stored, so two states would have to collide on all 64 bits for a
+ * solvable one to be cut.
+ */
+
+#define NOGOOD_BITS 12 /* 4096 entries, 64 KiB */
+
+struct latin_nogoods {
+    int o;
+    uint64_t* zobrist; /* o^3 cube bits, then o^2 filled squares */
+    uint64_t* keys;    /* 0 = empty */
+    long* subtree;     /* nodes it took to prove each entry */
+    long nodes;        /* recursion nodes expanded so far */
+};
+
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+static struct latin_nogoods* latin_nogoods_new(int o) {
+    struct latin_nogoods* ng = snew(struct latin_nogoods);
+    size_t nz = (size_t)o * (size_t)o * (size_t)(o + 1);
+    uint64_t seed = (uint64_t)o;
+
+    ng->o = o;
+    ng->zobrist = snewn(nz, uint64_t);
+    for (size_t i = 0; i < nz; i++) ng->zobrist[i] = splitmix64(&seed);
+    ng->keys = snewn((size_t)1 << NOGOOD_BITS, uint64_t);
+    ng->subtree = snewn((size_t)1 << NOGOOD_BITS, long);
+    memset(ng->keys, 0, sizeof(uint64_t) << NOGOOD_BITS);
+    ng->nodes = 0;
+    return ng;
+}
+
+static void latin_nogoods_free(struct latin_nogoods* ng) {
+    sfree(ng->subtree);
+    sfree(ng->keys);
+    sfree(ng->zobrist);
+    sfree(ng);
+}
+
+static uint64_t latin_nogoods_key(const struct latin_nogoods* ng,
+                                  const struct latin_solver* solver) {
+    int o = ng->o, o2 = o * o, o3 = o2 * o;
+    uint64_t key = 0;
+
+    for (int i = 0; i < o3; i++)
+        if (solver->cube[i]) key ^= ng->zobrist[i];
+    for (int i = 0; i < o2; i++)
+        if (solver->grid[i]) key ^= ng->zobrist[o3 + i];
+    return key ? key : 1;
+}
+
+static int latin_solver_branch(struct latin_solver* solver, int diff_simple, int diff_set_0,
+                               int diff_set_1, int diff_forcing, int diff_recursive,
+                               usersolver_t const* usersolvers, void* ctx, ctxnew_t ctxnew,
+                               ctxfree_t ctxfree);
+
+/*
+ * Recurse from the current state (see latin_solver_branch for the return
+ * values), consulting and then feeding the nogood table.
+ */
+static int latin_solver_recurse(struct latin_solver* solver, int diff_simple, int diff_set_0,
+                                int diff_set_1, int diff_forcing, int diff_recursive,
+                                usersolver_t const* usersolvers, void* ctx, ctxnew_t ctxnew,
+                                ctxfree_t ctxfree) {
+    struct latin_nogoods* ng = solver->nogoods;
+    struct latin_search_stats* stats = solver->stats;
+    int own = false, ret;
+    uint64_t key = 0;
+    size_t slot = 0;
+    long before = 0;
+
+    if (!ng && solver->use_nogoods) {
+        ng = solver->nogoods = latin_nogoods_new(solver->o);
+        own = true;
+    }
+    if (ng) {
+        key = latin_nogoods_key(ng, solver);
+        slot = (size_t)(key >> (64 - NOGOOD_BITS));
+        if (ng->keys[slot] == key) {
+            if (stats) {
+                stats->nogood_hits++;
+                stats->pruned += ng->subtree[slot];
+            }
+            return -1;
+        }
+        before = ng->nodes++;
+    }
+    if (stats) stats->nodes++;
+
+    ret = latin_solver_branch(solver, diff_simple, diff_set_0, diff_set_1, diff_forcing,
+                              diff_recursive, usersolvers, ctx, ctxnew, ctxfree);
+
+    if (ng && ret < 0) {
+        ng->keys[slot] = key;
+        ng->subtree[slot] = ng->nodes - before;
+        if (stats) stats->nogood_stores++;
+    }
+    if (own) {
+        latin_nogoods_free(ng);
+        solver->nogoods = nullptr;
+    }
+    return ret;
+}
+
 /*
  * Returns:
  * 0 for 'didn't do anything' implying it was already solved.
@@ -706,72 +1091,79 @@ int latin_solver_diff_set(struct latin_solver* solver, struct latin_solver_scrat
  *
  * and this function may well assert if given an impossible board.
  */
-static int latin_solver_recurse(struct latin_solver* solver, int diff_simple, int diff_set_0,
-                                int diff_set_1, int diff_forcing, int diff_recursive,
-                                usersolver_t const* usersolvers, void* ctx, ctxnew_t ctxnew,
-                                ctxfree_t ctxfree) {
-    int best, bestcount;
+static int latin_solver_branch(struct latin_solver* solver, int diff_simple, int diff_set_0,
+                               int diff_set_1, int diff_forcing, int diff_recursive,
+                               usersolver_t const* usersolvers, void* ctx, ctxnew_t ctxnew,
+                               ctxfree_t ctxfree) {
+    struct latin_branch branch;
     int o = solver->o, x, y, n;
 #ifdef STANDALONE_SOLVER
     char** names = solver->names;
 #endif
 
-    best = -1;
-    bestcount = o + 1;
+    if (!solver->brancher || !solver->brancher(solver, ctx, &branch)) {
+        int best = -1, bestcount = o + 1;
 
-    for (y = 0; y < o; y++)
-        for (x = 0; x < o; x++)
-            if (!solver->grid[y * o + x]) {
-                int count;
+        for (y = 0; y < o; y++)
+            for (x = 0; x < o; x++)
+                if (!solver->grid[y * o + x]) {
+                    int count;
 
-                /*
-                 * An unfilled square. Count the number of
-                 * possible digits in it.
-                 */
-                count = 0;
-                for (n = 1; n <= o; n++)
-                    if (cube(x, y, n)) count++;
+                    /*
+                     * An unfilled square. Count the number of
+                     * possible digits in it.
+                     */
+                    count = 0;
+                    for (n = 1; n <= o; n++)
+                        if (cube(x, y, n)) count++;
 
-                /*
-                 * We should have found any impossibilities
-                 * already, so this can safely be an assert.
-                 */
-                assert(count > 1);
+                    /*
+                     * We should have found any impossibilities
+                     * already, so this can safely be an assert.
+                     */
+                    assert(count > 1);
 
-                if (count < bestcount) {
-                    bestcount = count;
-                    best = y * o + x;
+                    if (count < bestcount) {
+                        bestcount = count;
+                        best = y * o + x;
+                    }
                 }
-            }
 
-    if (best == -1) /* we were complete already. */
-        return 0;
-    else {
-        int i, j;
-        digit *list, *ingrid, *outgrid;
+        if (best == -1) /* we were complete already. */
+            return 0;
+
+        /* Branch on the possible digits of that square. */
+        branch.ncells = 1;
+        branch.cells = snew(int);
+        branch.cells[0] = best;
+        branch.values = snewn((size_t)o, digit);
+        for (branch.nalts = 0, n = 1; n <= o; n++)
+            if (cube(best % o, best / o, n)) branch.values[branch.nalts++] = (digit)n;
+    }
+
+    {
+        int i, k;
+        digit *ingrid, *outgrid;
         int diff = diff_impossible; /* no solution found yet */
 
         /*
          * Attempt recursion.
          */
-        y = best / o;
-        x = best % o;
-
-        list = snewn((size_t)o, digit);
         ingrid = snewn((size_t)o * (size_t)o, digit);
         outgrid = snewn((size_t)o * (size_t)o, digit);
         memcpy(ingrid, solver->grid, (size_t)o * (size_t)o);
 
-        /* Make a list of the possible digits. */
-        for (j = 0, n = 1; n <= o; n++)
-            if (cube(x, y, n)) list[j++] = (digit)n;
-
 #ifdef STANDALONE_SOLVER
         if (solver_show_working) {
             char* sep = "";
-            printf("%*srecursing on (%d,%d) [", solver_recurse_depth * 4, "", x + 1, y + 1);
-            for (i = 0; i < j; i++) {
-                printf("%s%s", sep, names[list[i] - 1]);
+            printf("%*srecursing on", solver_recurse_depth * 4, "");
+            for (k = 0; k < branch.ncells; k++)
+                printf(" (%d,%d)", branch.cells[k] % o + 1, branch.cells[k] / o + 1);
+            printf(" [");
+            for (i = 0; i < branch.nalts; i++) {
+                printf("%s", sep);
+                for (k = 0; k < branch.ncells; k++)
+                    printf("%s", names[branch.values[i * branch.ncells + k] - 1]);
                 sep = " or ";
             }
             printf("]\n");
@@ -782,18 +1174,18 @@ static int latin_solver_recurse(struct latin_solver* solver, int diff_simple, in
          * And step along the list, recursing back into the
          * main solver at every stage.
          */
-        for (i = 0; i < j; i++) {
+        for (i = 0; i < branch.nalts; i++) {
             int ret;
             void* newctx;
             struct latin_solver subsolver;
+            const digit* alt = branch.values + (size_t)i * (size_t)branch.ncells;
 
             memcpy(outgrid, ingrid, (size_t)o * (size_t)o);
-            outgrid[y * o + x] = list[i];
+            for (k = 0; k < branch.ncells; k++) outgrid[branch.cells[k]] = alt[k];
 
 #ifdef STANDALONE_SOLVER
             if (solver_show_working)
-                printf("%*sguessing %s at (%d,%d)\n", solver_recurse_depth * 4, "",
-                       names[list[i] - 1], x + 1, y + 1);
+                printf("%*sguessing alternative %d\n", solver_recurse_depth * 4, "", i + 1);
             solver_recurse_depth++;
 #endif
 
@@ -803,6 +1195,11 @@ static int latin_solver_recurse(struct latin_solver* solver, int diff_simple, in
                 newctx = ctx;
             }
             latin_solver_alloc(&subsolver, outgrid, o);
+            subsolver.brancher = solver->brancher;
+            subsolver.use_nogoods = solver->use_nogoods;
+            subsolver.nogoods = solver->nogoods;
+            subsolver.stats = solver->stats;
+            subsolver.batch = solver->batch;
 #ifdef STANDALONE_SOLVER
             subsolver.names = solver->names;
 #endif
@@ -814,10 +1211,8 @@ static int latin_solver_recurse(struct latin_solver* solver, int diff_simple, in
 
 #ifdef STANDALONE_SOLVER
             solver_recurse_depth--;
-            if (solver_show_working) {
-                printf("%*sretracting %s at (%d,%d)\n", solver_recurse_depth * 4, "",
-                       names[list[i] - 1], x + 1, y + 1);
-            }
+            if (solver_show_working)
+                printf("%*sretracting alternative %d\n", solver_recurse_depth * 4, "", i + 1);
 #endif
             /* we recurse as deep as we can, so we should never find
              * find ourselves giving up on a puzzle without declaring it
@@ -852,7 +1247,8 @@ static int latin_solver_recurse(struct latin_solver* solver, int diff_simple, in
 
         sfree(outgrid);
         sfree(ingrid);
-        sfree(list);
+        sfree(branch.values);
+        sfree(branch.cells);
 
         if (diff == diff_impossible)
             return -1;
@@ -882,26 +1278,52 @@ static int latin_solver_top(struct latin_solver* solver, int maxdiff, int diff_s
      */
     while (1) {
         int i;
+        bool drained;
 
     cont:
+        drained = false;
 
         latin_solver_debug(solver->cube, solver->o);
 
         for (i = 0; i <= maxdiff; i++) {
+            int tech = LATIN_TECH_USER;
+
             if (usersolvers[i])
                 ret = usersolvers[i](solver, ctx);
             else
                 ret = 0;
-            if (ret == 0 && i == diff_simple) ret = latin_solver_diff_simple(solver);
-            if (ret == 0 && i == diff_set_0) ret = latin_solver_diff_set(solver, scratch, 0);
-            if (ret == 0 && i == diff_set_1) ret = latin_solver_diff_set(solver, scratch, 1);
-            if (ret == 0 && i == diff_forcing) ret = latin_solver_forcing(solver, scratch);
+            if (ret == 0 && i == diff_simple) {
+                tech = LATIN_TECH_SIMPLE;
+                ret = latin_solver_diff_simple(solver);
+            }
+            if (ret == 0 && i == diff_set_0) {
+                tech = LATIN_TECH_SET;
+                ret = latin_solver_diff_set(solver, scratch, 0);
+            }
+            if (ret == 0 && i == diff_set_1) {
+                tech = LATIN_TECH_SET_EXTREME;
+                ret = latin_solver_diff_set(solver, scratch, 1);
+            }
+            if (ret == 0 && i == diff_forcing) {
+                tech = LATIN_TECH_FORCING;
+                ret = latin_solver_forcing(solver, scratch);
+            }
 
             if (ret < 0) {
                 diff = diff_impossible;
                 goto got_result;
             } else if (ret > 0) {
                 diff = max(diff, i);
+                if (solver->observer &&
+                    solver->observer(solver, solver->observer_ctx, i, tech)) {
+                    diff = diff_unfinished;
+                    goto got_result;
+                }
+                if (!solver->batch) goto cont;
+                /* Re-run this level until it runs dry */
+                drained = true;
+                i--;
+            } else if (drained) {
                 goto cont;
             }
         }
@@ -1227,60 +1649,70 @@ digit* latin_generate_rect(int w, int h, random_state* rs) {
  * Checking.
  */
 
-typedef struct lcparams {
-    digit elt;
-    int count;
-} lcparams;
-
-static int latin_check_cmp(void* v1, void* v2) {
-    lcparams* lc1 = (lcparams*)v1;
-    lcparams* lc2 = (lcparams*)v2;
+#define ELT(sq, x, y) (sq[((y) * order) + (x)])
 
-    if (lc1->elt < lc2->elt) return -1;
-    if (lc1->elt > lc2->elt) return 1;
-    return 0;
-}
+/*
+ * Up to order 16 every line keeps a word with bit d set for each digit
+ * d it holds, built without branches; a line is whole iff its word has
+ * exactly bits 1..order set, since order digits can only cover order
+ * bits by all being distinct. Digits out of range land on bit 0.
+ */
+#define CHECK_WORD_MAX 16
 
-#define ELT(sq, x, y) (sq[((y) * order) + (x)])
+static int latin_check_words(const digit* sq, int order, unsigned char* bad_rows,
+                             unsigned char* bad_cols) {
+    uint32_t cols[CHECK_WORD_MAX] = {0}, full = ((1U << order) - 1) << 1;
+    int x, y, broken = 0;
 
-/* returns non-zero if sq is not a latin square. */
-int latin_check(digit* sq, int order) {
-    tree234* dict = newtree234(latin_check_cmp);
-    int c, r;
-    int ret = 0;
-    lcparams *lcp, lc;
-
-    /* Use a tree234 as a simple hash table, go through the square
-     * adding elements as we go or incrementing their counts. */
-    for (c = 0; c < order; c++) {
-        for (r = 0; r < order; r++) {
-            lc.elt = ELT(sq, c, r);
-            lc.count = 0;
-            lcp = find234(dict, &lc, nullptr);
-            if (!lcp) {
-                lcp = snew(lcparams);
-                lcp->elt = ELT(sq, c, r);
-                lcp->count = 1;
-                (void)add234(dict, lcp); /* Must succeed - lcp is newly allocated */
-            } else {
-                lcp->count++;
-            }
+    for (y = 0; y < order; y++) {
+        uint32_t row = 0;
+        for (x = 0; x < order; x++) {
+            digit d = ELT(sq, x, y);
+            uint32_t bit = 1U << (d <= CHECK_WORD_MAX ? d : 0);
+            row |= bit;
+            cols[x] |= bit;
         }
+        if (bad_rows) bad_rows[y] = row != full;
+        broken += row != full;
     }
+    for (x = 0; x < order; x++) {
+        if (bad_cols) bad_cols[x] = cols[x] != full;
+        broken += cols[x] != full;
+    }
+    return broken;
+}
 
-    /* There should be precisely 'order' letters in the alphabet,
-     * each occurring 'order' times (making the OxO tree) */
-    if (count234(dict) != order)
-        ret = 1;
-    else {
-        for (c = 0; (lcp = index234(dict, c)) != nullptr; c++) {
-            if (lcp->count != order) ret = 1;
+/* Any order: a seen-digit mask per line, over all 256 digit values. */
+static int latin_check_masks(const digit* sq, int order, unsigned char* bad_rows,
+                             unsigned char* bad_cols) {
+    int i, k, broken = 0;
+
+    /* Line i is row i, or column i - order */
+    for (i = 0; i < 2 * order; i++) {
+        uint64_t seen[4] = {0, 0, 0, 0};
+        int bad = false;
+        for (k = 0; k < order; k++) {
+            digit d = i < order ? ELT(sq, k, i) : ELT(sq, i - order, k);
+            uint64_t bit = (uint64_t)1 << (d & 63);
+            if (d < 1 || d > order || (seen[d >> 6] & bit)) bad = true;
+            seen[d >> 6] |= bit;
         }
+        unsigned char* flags = i < order ? bad_rows : bad_cols;
+        if (flags) flags[i < order ? i : i - order] = bad;
+        broken += bad;
     }
-    for (c = 0; (lcp = index234(dict, c)) != nullptr; c++) sfree(lcp);
-    freetree234(dict);
+    return broken;
+}
 
-    return ret;
+int latin_check_lines(const digit* sq, int order, unsigned char* bad_rows,
+                      unsigned char* bad_cols) {
+    if (order <= CHECK_WORD_MAX) return latin_check_words(sq, order, bad_rows, bad_cols);
+    return latin_check_masks(sq, order, bad_rows, bad_cols);
+}
+
+/* returns non-zero if sq is not a latin square. */
+int latin_check(digit* sq, int order) {
+    return latin_check_lines(sq, order, nullptr, nullptr) != 0;
 }
 
 /* --------------------------------------------------------
@@ -36,6 +36,22 @@
 
 typedef unsigned char digit;
 
+struct latin_branch;
+struct latin_nogoods; /* private to latin.c */
+
+/*
+ * Counters for recursive search, accumulated over every solve given the
+ * same latin_search_stats. 'pruned' is the number of nodes the cached
+ * subtrees took to search when they were first proven impossible, i.e.
+ * the work each hit saved.
+ */
+struct latin_search_stats {
+    long nodes;         /* recursion nodes expanded */
+    long nogood_hits;   /* states found in the nogood table */
+    long nogood_stores; /* impossible states recorded */
+    long pruned;        /* nodes those hits skipped */
+};
+
 /* --- Solver structures, definitions --- */
 
 #ifdef STANDALONE_SOLVER
@@ -51,6 +67,47 @@ struct latin_solver {
     unsigned char* row; /* o^2: row[y*cr+n-1] true if n is in row y */
     unsigned char* col; /* o^2: col[x*cr+n-1] true if n is in col x */
 
+    /*
+     * Optional observer of the deduction loop (see latin_observer_t
+     * below). latin_solver_alloc clears it; recursion subsolvers never
+     * inherit it.
+     */
+    int (*observer)(struct latin_solver* solver, void* octx, int diff, int technique);
+    void* observer_ctx;
+
+    /*
+     * Optional branching strategy for recursion (see latin_brancher_t
+     * below), called with the usersolver context. latin_solver_alloc
+     * clears it; recursion subsolvers inherit it.
+     */
+    int (*brancher)(struct latin_solver* solver, void* ctx, struct latin_branch* branch);
+
+    /*
+     * Nogood table for recursion: states (candidate cube plus filled
+     * squares) already proven to have no solution, keyed by a Zobrist
+     * hash, so a subtree that reaches one again is cut at once. One
+     * bounded table is made per top-level recursive solve when
+     * use_nogoods is set (latin_solver_alloc clears it) and shared with
+     * every subsolver, as is the optional stats pointer (which counts
+     * nodes whether or not the table is in use).
+     */
+    int use_nogoods;
+    struct latin_nogoods* nogoods;
+    struct latin_search_stats* stats;
+
+    /*
+     * Batched propagation: a level that makes progress is re-run until
+     * it has nothing left before the ladder restarts from the easiest
+     * level, rather than restarting after every step (and usersolvers
+     * may drain a whole pass rather than stopping at their first
+     * deduction). Every level only eliminates candidates, so each run of
+     * levels still reaches the same fixpoint before a harder one is
+     * tried: the grid and difficulty come out the same and only the
+     * order of steps changes, which is why observers want it off.
+     * latin_solver_alloc clears it; recursion subsolvers inherit it.
+     */
+    int batch;
+
 #ifdef STANDALONE_SOLVER
     char** names; /* o: names[n-1] gives name of 'digit' n */
 #endif
@@ -87,6 +144,10 @@ int latin_solver_set(struct latin_solver* solver, struct latin_solver_scratch* s
 /* Forcing chains */
 int latin_solver_forcing(struct latin_solver* solver, struct latin_solver_scratch* scratch);
 
+/* The cube-rescanning search latin_solver_forcing falls back to above
+ * 32; the same deduction in the same order. Exposed for tests. */
+int latin_solver_forcing_scan(struct latin_solver* solver, struct latin_solver_scratch* scratch);
+
 /* --- Solver allocation --- */
 
 /* Fills in (and allocates members for) a latin_solver struct.
@@ -111,6 +172,40 @@ int latin_solver_diff_set(struct latin_solver* solver, struct latin_solver_scrat
                           int extreme);
 
 typedef int (*usersolver_t)(struct latin_solver* solver, void* ctx);
+
+/* Which technique made progress, as reported to a latin_observer_t. */
+enum {
+    LATIN_TECH_USER,          /* the puzzle's own usersolver */
+    LATIN_TECH_SIMPLE,        /* positional/numeric elimination (places a digit) */
+    LATIN_TECH_SET,           /* row/column set elimination */
+    LATIN_TECH_SET_EXTREME,   /* single-number row-vs-column set elimination */
+    LATIN_TECH_FORCING        /* forcing chains */
+};
+
+/* Called after every productive deduction step of the main solver loop,
+ * with the difficulty level 'diff' at which the step was made. Returning
+ * non-zero stops the loop immediately and the solver reports
+ * diff_unfinished, leaving the cube exactly as the step left it. */
+typedef int (*latin_observer_t)(struct latin_solver* solver, void* octx, int diff, int technique);
+
+/*
+ * A branching decision for recursion: nalts alternatives, each placing
+ * digits in the same ncells squares, which must be mutually exclusive
+ * and between them cover every solution (or the solution count comes
+ * out wrong). Alternative a puts values[a * ncells + k] in square
+ * cells[k] (y * o + x); alternatives are tried in order.
+ */
+struct latin_branch {
+    int nalts, ncells;
+    int* cells;     /* ncells, allocated by the brancher */
+    digit* values;  /* nalts * ncells, allocated by the brancher */
+};
+
+/* Fills in *branch and returns nalts, or returns 0 (allocating nothing)
+ * to fall back to the default: the first square with the fewest
+ * candidates, digits in ascending order. */
+typedef int (*latin_brancher_t)(struct latin_solver* solver, void* ctx,
+                                struct latin_branch* branch);
 typedef void* (*ctxnew_t)(void* ctx);
 typedef void (*ctxfree_t)(void* ctx);
 
@@ -140,6 +235,14 @@ digit* latin_generate_rect(int w, int h, random_state* rs);
 
 int latin_check(digit* sq, int order); /* !0 => not a latin square */
 
+/*
+ * Returns how many rows plus columns of sq fail to hold each of
+ * 1..order exactly once; if bad_rows / bad_cols aren't null, sets
+ * bad_rows[y] / bad_cols[x] to whether each line is one of them.
+ */
+int latin_check_lines(const digit* sq, int order, unsigned char* bad_rows,
+                      unsigned char* bad_cols);
+
 void latin_debug(digit* sq, int order);
 
 #endif
@@ -6,8 +6,8 @@
  *
  * This file is part of Keen Classik for Android.
  *
- * Provides AVX2, SSE2, and ARM NEON optimized implementations of the
- * max-flow algorithm for improved puzzle generation performance.
+ * The per-search visited reset uses the fill_i32 kernel, dispatched at
+ * runtime to AVX2, SSE2 or NEON by keen_cpu.c.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -23,24 +23,15 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
-#if defined(__x86_64__) || defined(__i386__)
-#include <immintrin.h>
-#endif
-#ifdef __ARM_NEON
-#include <arm_neon.h>
-#endif
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "keen_cpu.h"
 #include "maxflow.h"
 #include "puzzles.h"
 
-/*
- * Fully Optimized maxflow.c with AVX2 Fast Path.
- */
-
 int maxflow_scratch_size(int nv) {
     return (int)(((size_t)nv * 4) * sizeof(int));
 }
@@ -108,6 +99,7 @@ int maxflow_with_scratch(void* scratch, int nv, int source, int sink, int ne, co
     int* firstbackedge = todo + 3 * nv;
     int i, j, head, tail, from, to;
     int totalflow = 0;
+    void (*fill_i32)(int*, int, int) = keen_kernels_get()->fill_i32;
 
     (void)cut;
 
@@ -124,47 +116,22 @@ int maxflow_with_scratch(void* scratch, int nv, int source, int sink, int ne, co
     memset(flow, 0, (size_t)ne * sizeof(int));
 
     while (1) {
-#if defined(__AVX2__)
-        __m256i neg_one = _mm256_set1_epi32(-1);
-        for (i = 0; i < nv; i += 8) {
-            if (i + 8 <= nv)
-                _mm256_storeu_si256((__m256i*)(prev + i), neg_one);
-            else
-                for (int k = i; k < nv; k++) prev[k] = -1;
-        }
-#elif defined(__SSE2__) || defined(__x86_64__) || defined(__i386__)
-        __m128i neg_one_sse = _mm_set1_epi32(-1);
-        for (i = 0; i < nv; i += 4) {
-            if (i + 4 <= nv)
-                _mm_storeu_si128((__m128i*)(prev + i), neg_one_sse);
-            else
-                for (int k = i; k < nv; k++) prev[k] = -1;
-        }
-#elif defined(__ARM_NEON)
-        int32x4_t neg_one_neon = vdupq_n_s32(-1);
-        for (i = 0; i < nv; i += 4) {
-            if (i + 4 <= nv)
-                vst1q_s32(prev + i, neg_one_neon);
-            else
-                for (int k = i; k < nv; k++) prev[k] = -1;
-        }
-#else
-        for (i = 0; i < nv; i++) prev[i] = -1;
-#endif
+        fill_i32(prev, nv, -1);
 
-        uint32_t visited_mask = (1 << source);
+        /* A vertex is visited once it has a prev (the source gets a dummy
+         * one); a bitmask would cap nv at the word size */
+        prev[source] = -2;
         head = tail = 0;
         todo[tail++] = source;
 
-        while (head < tail && !(visited_mask & (1 << sink))) {
+        while (head < tail && prev[sink] == -1) {
             from = todo[head++];
             for (i = firstedge[from]; i < ne && edges[2 * i] == from; i++) {
                 to = edges[2 * i + 1];
-                if (!(visited_mask & (1 << to))) {
+                if (prev[to] == -1) {
                     if (capacity[i] < 0 || flow[i] < capacity[i]) {
                         prev[to] = 2 * i;
                         todo[tail++] = to;
-                        visited_mask |= (1 << to);
                     }
                 }
             }
@@ -172,17 +139,16 @@ int maxflow_with_scratch(void* scratch, int nv, int source, int sink, int ne, co
                 j = backedges[i];
                 if (edges[2 * j + 1] != from) break;
                 to = edges[2 * j];
-                if (!(visited_mask & (1 << to))) {
+                if (prev[to] == -1) {
                     if (flow[j] > 0) {
                         prev[to] = 2 * j + 1;
                         todo[tail++] = to;
-                        visited_mask |= (1 << to);
                     }
                 }
             }
         }
 
-        if (visited_mask & (1 << sink)) {
+        if (prev[sink] != -1) {
             int path_max = -1;
             to = sink;
             while (to != source) {
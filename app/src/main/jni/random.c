@@ -41,14 +41,14 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "keen_cpu.h"
 #include "puzzles.h"
 
 /* ----------------------------------------------------------------------
- * Core SHA algorithm: processes 16-word blocks into a message digest.
+ * Core SHA algorithm: the block compression is a dispatched kernel
+ * (keen_cpu.c); this sets up the initial digest.
  */
 
-#define rol(x, y) (((x) << (y)) | (((uint32)x) >> (32 - y)))
-
 static void SHA_Core_Init(uint32 h[5]) {
     h[0] = 0x67452301;
     h[1] = 0xefcdab89;
@@ -57,64 +57,6 @@ static void SHA_Core_Init(uint32 h[5]) {
     h[4] = 0xc3d2e1f0;
 }
 
-static void SHATransform(uint32* digest, uint32* block) {
-    uint32 w[80] = {0};
-    uint32 a, b, c, d, e;
-    int t;
-
-    for (t = 0; t < 16; t++) w[t] = block[t];
-
-    for (t = 16; t < 80; t++) {
-        uint32 tmp = w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16];
-        w[t] = rol(tmp, 1);
-    }
-
-    a = digest[0];
-    b = digest[1];
-    c = digest[2];
-    d = digest[3];
-    e = digest[4];
-
-    for (t = 0; t < 20; t++) {
-        uint32 tmp = rol(a, 5) + ((b & c) | (d & ~b)) + e + w[t] + 0x5a827999;
-        e = d;
-        d = c;
-        c = rol(b, 30);
-        b = a;
-        a = tmp;
-    }
-    for (t = 20; t < 40; t++) {
-        uint32 tmp = rol(a, 5) + (b ^ c ^ d) + e + w[t] + 0x6ed9eba1;
-        e = d;
-        d = c;
-        c = rol(b, 30);
-        b = a;
-        a = tmp;
-    }
-    for (t = 40; t < 60; t++) {
-        uint32 tmp = rol(a, 5) + ((b & c) | (b & d) | (c & d)) + e + w[t] + 0x8f1bbcdc;
-        e = d;
-        d = c;
-        c = rol(b, 30);
-        b = a;
-        a = tmp;
-    }
-    for (t = 60; t < 80; t++) {
-        uint32 tmp = rol(a, 5) + (b ^ c ^ d) + e + w[t] + 0xca62c1d6;
-        e = d;
-        d = c;
-        c = rol(b, 30);
-        b = a;
-        a = tmp;
-    }
-
-    digest[0] += a;
-    digest[1] += b;
-    digest[2] += c;
-    digest[3] += d;
-    digest[4] += e;
-}
-
 /* ----------------------------------------------------------------------
  * Outer SHA algorithm: take an arbitrary length byte string,
  * convert it into 16-word blocks with the prescribed padding at
@@ -129,9 +71,7 @@ void SHA_Init(SHA_State* s) {
 
 void SHA_Bytes(SHA_State* s, const void* p, int len) {
     unsigned char* q = (unsigned char*)p;
-    uint32 wordblock[16];
     uint32 lenw = (uint32)len;
-    int i;
 
     /*
      * Update the length field.
@@ -153,13 +93,8 @@ void SHA_Bytes(SHA_State* s, const void* p, int len) {
             memcpy(s->block + s->blkused, q, (size_t)(64 - s->blkused));
             q += 64 - s->blkused;
             len -= 64 - s->blkused;
-            /* Now process the block. Gather bytes big-endian into words */
-            for (i = 0; i < 16; i++) {
-                wordblock[i] =
-                    (((uint32)s->block[i * 4 + 0]) << 24) | (((uint32)s->block[i * 4 + 1]) << 16) |
-                    (((uint32)s->block[i * 4 + 2]) << 8) | (((uint32)s->block[i * 4 + 3]) << 0);
-            }
-            SHATransform(s->h, wordblock);
+            /* Now process the block */
+            keen_kernels_get()->sha1_block(s->h, s->block);
             s->blkused = 0;
         }
         memcpy(s->block, q, (size_t)len);
@@ -268,9 +268,32 @@ class KeenModelStateTest {
     }
 
     @Test
-    fun `undoOneStep does nothing when stack empty`() {
-        // Should not crash
+    fun `undo keeps notes up to 16`() {
+        val cell = model.getCell(0, 0)
+
+        model.addToCellGuesses(0, 0, 15)
+        model.addToCellGuesses(0, 0, 16)
+        model.addCurToUndo(0, 0)
+        model.setCellFinalGuess(0, 0, 1)
+
         model.undoOneStep()
+        assertEquals(-1, cell.finalGuessValue)
+        assertTrue(cell.guesses[14])
+        assertTrue(cell.guesses[15])
+    }
+
+    @Test
+    fun `undoOneStep reports the restored cell`() {
+        model.addCurToUndo(1, 2)
+        model.setCellFinalGuess(1, 2, 3)
+
+        assertEquals(1 * model.size + 2, model.undoOneStep())
+    }
+
+    @Test
+    fun `undoOneStep does nothing when stack empty`() {
+        // Should not crash, and reports no cell
+        assertEquals(-1, model.undoOneStep())
 
         // State should be unchanged
         assertEquals(-1, model.getCell(0, 0).finalGuessValue)
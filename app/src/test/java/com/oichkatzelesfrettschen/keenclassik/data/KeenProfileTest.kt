@@ -22,13 +22,25 @@ class KeenProfileTest {
     }
 
     @Test
-    fun `classik grid sizes stop at 9`() {
+    fun `classik grid sizes run from 3 to 16`() {
         FlavorConfigProvider.set(object : FlavorConfig {
             override val fullModeSet: Boolean = true
             override val minGridSize: Int = 3
             override val maxGridSize: Int = 16
         })
         val sizes = GridSize.allSizes(KeenProfile.CLASSIK_MODERN).map { it.size }
+        assertEquals((3..16).toList(), sizes)
+        assertEquals(sizes, GridSize.allSizes(KeenProfile.CLASSIK_LEGACY).map { it.size })
+    }
+
+    @Test
+    fun `flavor limit caps classik grid sizes`() {
+        FlavorConfigProvider.set(object : FlavorConfig {
+            override val fullModeSet: Boolean = false
+            override val minGridSize: Int = 3
+            override val maxGridSize: Int = 9
+        })
+        val sizes = GridSize.allSizes(KeenProfile.CLASSIK_MODERN).map { it.size }
         assertTrue(9 in sizes)
         assertFalse(10 in sizes)
     }
@@ -70,8 +82,9 @@ class KeenProfileTest {
             override val minGridSize: Int = 3
             override val maxGridSize: Int = 16
         })
-        val expected = listOf(0, 1, 2, 3)
         GridSize.allSizes(KeenProfile.CLASSIK_MODERN).forEach { size ->
+            // Easy stops at 12x12, where the native generator stops offering it
+            val expected = if (size.size <= Difficulty.EASY_MAX_GRID_SIZE) listOf(0, 1, 2, 3) else listOf(1, 2, 3)
             assertEquals(expected, Difficulty.forGridSize(size.size, KeenProfile.CLASSIK_MODERN).map { it.level })
             assertEquals(expected, Difficulty.forGridSize(size.size, KeenProfile.CLASSIK_LEGACY).map { it.level })
         }
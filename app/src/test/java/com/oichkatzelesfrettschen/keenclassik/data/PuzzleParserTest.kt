@@ -85,6 +85,27 @@ class PuzzleParserTest {
         assertTrue("Expected Success, got $result", result is ParseResult.Success)
     }
 
+    @Test
+    fun `parse 11x11 puzzle with 3-digit indices and letter digits`() {
+        // 121 cells need 3-digit indices; one row-wide ADD zone per row
+        val size = 11
+        val zoneIndices = (0 until size * size).joinToString("") {
+            "%03d".format(it / size * size)
+        }
+        val zoneDefs = "a00066,".repeat(size)
+        val digits = "123456789AB"
+        val solution = (0 until size * size).joinToString("") {
+            digits[(it / size + it % size) % size].toString()
+        }
+        val result = PuzzleParser.parse("$zoneIndices;$zoneDefs$solution", size)
+        assertTrue("Expected Success, got $result", result is ParseResult.Success)
+
+        val puzzle = (result as ParseResult.Success).puzzle
+        assertEquals(size, puzzle.zones.size)
+        assertEquals(11, puzzle.cells[10].solutionDigit)
+        assertEquals(10, puzzle.cells[9].solutionDigit)
+    }
+
     @Test
     fun `zone count mismatch returns failure`() {
         // Only 8 zone indices for a 3x3 (should be 9)
@@ -49,7 +49,8 @@ class GameViewModelTest {
                     clues: LongArray,
                     modeFlags: Int
                 ): IntArray? = IntArray(size * size)
-            }
+            },
+            hintEngineFactory = { _, _, _, _ -> null }
         )
         
         try {
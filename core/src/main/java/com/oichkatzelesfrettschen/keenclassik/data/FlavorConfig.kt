@@ -18,7 +18,7 @@ object FlavorConfigProvider {
     private var config: FlavorConfig = object : FlavorConfig {
         override val fullModeSet: Boolean = false
         override val minGridSize: Int = 3
-        override val maxGridSize: Int = 9
+        override val maxGridSize: Int = 16
     }
 
     @JvmStatic
@@ -76,7 +76,7 @@ enum class GameMode(
 }
 
 /**
- * Grid size options for Classik (3x3 to 9x9).
+ * Grid size options for Classik (3x3 to 16x16).
  */
 enum class GridSize(
     val size: Int,
@@ -88,7 +88,14 @@ enum class GridSize(
     SIZE_6(6, "6×6"),
     SIZE_7(7, "7×7"),
     SIZE_8(8, "8×8"),
-    SIZE_9(9, "9×9");
+    SIZE_9(9, "9×9"),
+    SIZE_10(10, "10×10"),
+    SIZE_11(11, "11×11"),
+    SIZE_12(12, "12×12"),
+    SIZE_13(13, "13×13"),
+    SIZE_14(14, "14×14"),
+    SIZE_15(15, "15×15"),
+    SIZE_16(16, "16×16");
 
     companion object {
         /** Filter sizes by flavor and profile limits */
@@ -127,13 +134,19 @@ enum class Difficulty(val level: Int, val displayName: String) {
         fun fromInt(level: Int): Difficulty = entries.find { it.level == level } ?: NORMAL
         val DEFAULT = NORMAL
 
+        /** Largest grid Easy can grade (KEEN_EASY_MAX_SIZE in keen_modes.h). */
+        const val EASY_MAX_GRID_SIZE = 12
+
         /**
          * Get difficulties available for a given grid size and profile.
-         * Profiles control the ladder: Classik=0..3.
+         * Profiles control the ladder: Classik=0..3. Easy stops at
+         * [EASY_MAX_GRID_SIZE], since its deductions can't finish larger grids.
          */
         fun forGridSize(gridSize: Int, profile: KeenProfile = KeenProfile.DEFAULT): List<Difficulty> {
             val maxLevel = profile.maxDifficulty.level
-            return entries.filter { it.level <= maxLevel }
+            return entries.filter {
+                it.level <= maxLevel && (it != EASY || gridSize <= EASY_MAX_GRID_SIZE)
+            }
         }
     }
 }
@@ -19,7 +19,7 @@ enum class KeenProfile(
         displayName = "Classik (Modern)",
         nativeId = 0,
         minGridSize = 3,
-        maxGridSize = 9,
+        maxGridSize = 16,
         maxDifficulty = Difficulty.EXTREME,
         standardOnly = false  // Allows STANDARD and MULTIPLICATION_ONLY
     ),
@@ -27,7 +27,7 @@ enum class KeenProfile(
         displayName = "Classik (Legacy)",
         nativeId = 1,
         minGridSize = 3,
-        maxGridSize = 9,
+        maxGridSize = 16,
         maxDifficulty = Difficulty.EXTREME,
         standardOnly = false  // Allows STANDARD and MULTIPLICATION_ONLY
     );
@@ -61,7 +61,7 @@ case "$MODE" in
     OPTFLAGS="-O3 -g3 -fno-omit-frame-pointer"
     ;;
   release)
-    OPTFLAGS="-O3 -march=native -flto -ffast-math -funroll-loops"
+    OPTFLAGS="-O3 -flto -ffast-math -funroll-loops"
     ;;
   perf)
     OPTFLAGS="-O3 -g -flto -fno-omit-frame-pointer"
@@ -121,6 +121,7 @@ CFLAGS="$OPTFLAGS $CFLAGS_BASE $SAN_FLAGS $PGO_FLAGS"
 
 SOURCES=(
   "$ROOT_DIR/app/src/main/jni/latin.c"
+  "$ROOT_DIR/app/src/main/jni/keen_cpu.c"
   "$ROOT_DIR/app/src/main/jni/random.c"
   "$ROOT_DIR/app/src/main/jni/malloc.c"
   "$ROOT_DIR/app/src/main/jni/maxflow_optimized.c"
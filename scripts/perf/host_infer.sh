@@ -12,7 +12,7 @@ MAKE_TARGET="${MAKE_TARGET:-tools}"
 C_STD="${C_STD:-c2x}"
 CXX_STD="${CXX_STD:-c++20}"
 CC="${CC:-clang}"
-CFLAGS_INFER="${CFLAGS_INFER:--O3 -std=$C_STD -march=native -fno-lto -ffast-math -funroll-loops -fvectorize -fslp-vectorize -fno-math-errno -I$ROOT_DIR/app/src/main/jni -DSTANDALONE_LATIN_TEST -Wall -Wextra -Werror}"
+CFLAGS_INFER="${CFLAGS_INFER:--O3 -std=$C_STD -fno-lto -ffast-math -funroll-loops -fvectorize -fslp-vectorize -fno-math-errno -I$ROOT_DIR/app/src/main/jni -DSTANDALONE_LATIN_TEST -Wall -Wextra -Werror}"
 
 if ! command -v infer >/dev/null 2>&1; then
   echo "infer not found in PATH. See ~/Documents/Code-Analysis-Tooling/README.md" >&2
@@ -0,0 +1,665 @@
+/*
+ * keen_corpus_verify.c: Multi-threaded verifier for puzzle packs
+ *
+ * Checks every puzzle of a corpus against the invariants a shipped pack
+ * must hold: a unique solution (matching the stored one, if any), the
+ * graded difficulty (solvable at its level but not the one below, the
+ * same test the generator applies), clue values within MAX_CLUE_VALUE,
+ * and Classik cage sizes. Puzzles are fanned out over a work-stealing
+ * pool, one solver context per worker, and failures are reported one
+ * per line in input order:
+ *
+ *   FAIL line=<n> params=<params> code=<code> detail=<n>
+ *
+ * (record=<n> for a pack), where detail is the solver's return value,
+ * the cage size or the offending square, depending on the code; then a
+ * summary line. The exit status is 0 only if every puzzle
+ * passed.
+ *
+ * Input formats:
+ *
+ *   Text   One puzzle per line, "<params>:<desc>[:<aux>]", where params
+ *          is "<w>d<diffchar>[m][f<mode_flags>]" as in a game ID ("6dh",
+ *          "5dnf64"). Blank lines and lines starting with '#' are skipped.
+ *
+ *   Pack   The magic "KPAK", a little-endian uint32 record count, then
+ *          per record: uint8 w, uint8 diff, uint16 mode_flags, uint16
+ *          desc length, uint16 aux length (0 if none), desc, aux.
+ *
+ * Usage:
+ *   keen_corpus_verify [-j threads] [-b branching] [-n] [-o pack.out] <corpus>
+ *   keen_corpus_verify --generate <w> <diff> <count> [seed [predictor [adapt-file]]]
+ *
+ * -b selects the solver's KEEN_BRANCH_* recursion strategy (a number);
+ * -n turns on nogood caching in recursion (see the Recursion summary line);
+ * -o writes the records read (text or pack) back out as a pack;
+ * --generate prints a text corpus from one generator context for smoke
+ * tests, ending in '#' lines of generator telemetry; predictor is a
+ * KEEN_PREDICT_* mode (2, shadow, measures what rejecting would lose);
+ * with an adapt file the generator adapts its partition and clue-typing
+ * settings (keen_adapt.h), starting from and saving back to that file.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "keen.h"
+#include "keen_generate.h"
+#include "keen_internal.h"
+#include "keen_solver.h"
+#include "puzzles.h"
+
+#define MIN_GRID_SIZE 3
+#define MAX_GRID_SIZE 16
+#define MAX_CELLS (MAX_GRID_SIZE * MAX_GRID_SIZE)
+#define CLASSIK_MAX_CAGE_SIZE 6
+#define PACK_MAGIC "KPAK"
+
+static const char DIFF_CHARS[] = "enhxuli";
+
+/* Failure codes, in the order the checks run */
+enum {
+    VERIFY_OK,
+    VERIFY_PARSE,      /* desc or params malformed */
+    VERIFY_CLUE_CAP,   /* clue value above MAX_CLUE_VALUE */
+    VERIFY_CAGE_SIZE,  /* cage larger than the Classik limit */
+    VERIFY_MUL_CAGE,   /* multiplication cage whose product could overflow the cap */
+    VERIFY_UNSOLVABLE, /* no solution at all */
+    VERIFY_AMBIGUOUS,  /* more than one solution */
+    VERIFY_TOO_EASY,   /* solvable below its graded level */
+    VERIFY_TOO_HARD,   /* not solvable at its graded level */
+    VERIFY_SOLUTION,   /* unique solution differs from the stored aux */
+    VERIFY_NCODES
+};
+
+static const char* const VERIFY_NAMES[VERIFY_NCODES] = {
+    "ok",        "parse",      "clue-cap", "cage-size", "mul-cage",
+    "unsolvable", "ambiguous", "too-easy", "too-hard",  "solution",
+};
+
+typedef struct {
+    int w, diff, mode_flags;
+    char* desc;
+    char* aux; /* "S..." solution, or nullptr */
+    int line;  /* source line (text input) or record number (pack) */
+} corpus_record;
+
+typedef struct {
+    corpus_record* recs;
+    int n, size;
+} corpus;
+
+typedef struct {
+    unsigned char code;
+    short detail; /* solver return, largest cage, or offending square */
+} verify_result;
+
+/* Per-worker state, on its own cache line so stealing doesn't false-share. */
+typedef struct {
+    _Alignas(64) atomic_int next; /* next record of this worker's range */
+    int end;
+    int done, stolen;
+    keen_grader* grader;
+    int dsf[MAX_CELLS];
+    clue_t clues[MAX_CELLS];
+    digit soln[MAX_CELLS];
+} verify_worker;
+
+typedef struct {
+    const corpus* c;
+    verify_result* results;
+    verify_worker* workers;
+    int nworkers;
+    int branching; /* KEEN_BRANCH_* */
+    int nogoods;
+} verify_pool;
+
+typedef struct {
+    verify_pool* pool;
+    int id;
+} worker_arg;
+
+static double get_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* ----------------------------------------------------------------------
+ * Corpus input and output.
+ */
+
+static void corpus_add(corpus* c, int w, int diff, int mode_flags, const char* desc, size_t dlen,
+                       const char* aux, size_t alen, int line) {
+    if (c->n >= c->size) {
+        c->size = c->size * 3 / 2 + 1024;
+        c->recs = sresize(c->recs, c->size, corpus_record);
+    }
+    corpus_record* r = &c->recs[c->n++];
+    r->w = w;
+    r->diff = diff;
+    r->mode_flags = mode_flags;
+    r->desc = snewn(dlen + 1, char);
+    memcpy(r->desc, desc, dlen);
+    r->desc[dlen] = '\0';
+    r->aux = nullptr;
+    if (aux && alen) {
+        r->aux = snewn(alen + 1, char);
+        memcpy(r->aux, aux, alen);
+        r->aux[alen] = '\0';
+    }
+    r->line = line;
+}
+
+/* Parse "<w>d<diffchar>[m][f<flags>]"; returns 0 if malformed. */
+static int parse_params(const char* p, const char* end, int* w, int* diff, int* mode_flags) {
+    char* q;
+    const char* dc;
+
+    *w = (int)strtol(p, &q, 10);
+    if (q == p || q >= end || *q != 'd' || q + 1 >= end) return 0;
+    dc = strchr(DIFF_CHARS, q[1]);
+    if (!dc || !q[1]) return 0;
+    *diff = (int)(dc - DIFF_CHARS);
+    *mode_flags = 0;
+    p = q + 2;
+    if (p < end && *p == 'm') p++; /* multiplication-only: no solver-visible effect */
+    if (p < end && *p == 'f') {
+        *mode_flags = (int)strtol(p + 1, &q, 10);
+        p = q;
+    }
+    return p == end;
+}
+
+static int read_text(FILE* fp, corpus* c) {
+    char* buf = nullptr;
+    size_t cap = 0;
+    ssize_t len;
+    int line = 0;
+
+    while ((len = getline(&buf, &cap, fp)) >= 0) {
+        line++;
+        while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r')) buf[--len] = '\0';
+        if (len == 0 || buf[0] == '#') continue;
+
+        char* colon = strchr(buf, ':');
+        char* aux = colon ? strchr(colon + 1, ':') : nullptr;
+        int w, diff, flags;
+        if (!colon || !parse_params(buf, colon, &w, &diff, &flags)) {
+            /* Keep it so the failure is reported against its line */
+            corpus_add(c, 0, 0, 0, buf, (size_t)len, nullptr, 0, line);
+            continue;
+        }
+        char* desc = colon + 1;
+        size_t dlen = aux ? (size_t)(aux - desc) : strlen(desc);
+        corpus_add(c, w, diff, flags, desc, dlen, aux ? aux + 1 : nullptr,
+                   aux ? strlen(aux + 1) : 0, line);
+    }
+    free(buf);
+    return 1;
+}
+
+static unsigned get_le(const unsigned char* p, int bytes) {
+    unsigned v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void put_le(unsigned char* p, unsigned v, int bytes) {
+    for (int i = 0; i < bytes; i++, v >>= 8) p[i] = (unsigned char)v;
+}
+
+static int read_pack(FILE* fp, corpus* c) {
+    unsigned char hdr[8], rec[8];
+    char* buf = nullptr;
+    size_t cap = 0;
+    int ok = 1;
+
+    if (fread(hdr, 1, 8, fp) != 8 || memcmp(hdr, PACK_MAGIC, 4)) return 0;
+    unsigned count = get_le(hdr + 4, 4);
+
+    for (unsigned i = 0; ok && i < count; i++) {
+        if (fread(rec, 1, 8, fp) != 8) {
+            ok = 0;
+            break;
+        }
+        size_t dlen = get_le(rec + 4, 2), alen = get_le(rec + 6, 2);
+        if (dlen + alen > cap) {
+            cap = dlen + alen;
+            buf = sresize(buf, cap, char);
+        }
+        ok = fread(buf, 1, dlen + alen, fp) == dlen + alen;
+        if (ok)
+            corpus_add(c, rec[0], rec[1], (int)get_le(rec + 2, 2), buf, dlen, buf + dlen, alen,
+                       (int)i + 1);
+    }
+    sfree(buf);
+    return ok;
+}
+
+static int write_pack(const char* path, const corpus* c) {
+    FILE* fp = fopen(path, "wb");
+    unsigned char hdr[8];
+
+    if (!fp) return 0;
+    memcpy(hdr, PACK_MAGIC, 4);
+    put_le(hdr + 4, (unsigned)c->n, 4);
+    fwrite(hdr, 1, 8, fp);
+    for (int i = 0; i < c->n; i++) {
+        const corpus_record* r = &c->recs[i];
+        size_t dlen = strlen(r->desc), alen = r->aux ? strlen(r->aux) : 0;
+        unsigned char rec[8];
+        rec[0] = (unsigned char)r->w;
+        rec[1] = (unsigned char)r->diff;
+        put_le(rec + 2, (unsigned)r->mode_flags, 2);
+        put_le(rec + 4, (unsigned)dlen, 2);
+        put_le(rec + 6, (unsigned)alen, 2);
+        fwrite(rec, 1, 8, fp);
+        fwrite(r->desc, 1, dlen, fp);
+        if (alen) fwrite(r->aux, 1, alen, fp);
+    }
+    return fclose(fp) == 0;
+}
+
+static void corpus_free(corpus* c) {
+    for (int i = 0; i < c->n; i++) {
+        sfree(c->recs[i].desc);
+        sfree(c->recs[i].aux);
+    }
+    sfree(c->recs);
+}
+
+/* ----------------------------------------------------------------------
+ * Checking one puzzle.
+ */
+
+static clue_t op_from_letter(char c) {
+    switch (c) {
+        case 'a': return C_ADD;
+        case 's': return C_SUB;
+        case 'm': return C_MUL;
+        case 'd': return C_DIV;
+        case 'e': return C_EXP;
+        case 'o': return C_MOD;
+        case 'g': return C_GCD;
+        case 'l': return C_LCM;
+        case 'x': return C_XOR;
+        default: return CMASK; /* not an op */
+    }
+}
+
+static int max_mul_cells_for_size(int w) {
+    int cells = 0;
+    unsigned long val = 1;
+
+    while (val <= MAX_CLUE_VALUE / (unsigned long)w) {
+        val *= (unsigned long)w;
+        cells++;
+    }
+    return cells;
+}
+
+/*
+ * Decode "root,root,...;<op><value>,..." into the worker's dsf and clue
+ * arrays. Each root must be a square that is its own root; clue values
+ * may have any number of digits.
+ */
+static int decode_desc(verify_worker* wk, const corpus_record* r, verify_result* res) {
+    int w = r->w, a = w * w;
+    const char* p = r->desc;
+    char* q;
+
+    dsf_init(wk->dsf, a);
+    for (int i = 0; i < a; i++) {
+        long root = strtol(p, &q, 10);
+        if (q == p || root < 0 || root > i) return 0;
+        if (root != i) dsf_merge(wk->dsf, (int)root, i);
+        p = q;
+        if (*p == ',') p++;
+    }
+    if (*p++ != ';') return 0;
+
+    for (int i = 0; i < a; i++) {
+        wk->clues[i] = 0;
+        if (dsf_canonify(wk->dsf, i) != i) continue;
+        clue_t op = op_from_letter(*p++);
+        long val = strtol(p, &q, 10);
+        if (op == CMASK || q == p || val < 0) return 0;
+        if (val > (long)MAX_CLUE_VALUE) {
+            res->code = VERIFY_CLUE_CAP;
+            res->detail = (short)i;
+            return 1;
+        }
+        wk->clues[i] = op | (clue_t)val;
+        p = q;
+        if (*p == ',') p++;
+    }
+    return *p == '\0';
+}
+
+static void check_cages(verify_worker* wk, const corpus_record* r, verify_result* res) {
+    int w = r->w, a = w * w, max_mul = max_mul_cells_for_size(w);
+
+    for (int i = 0; i < a; i++) {
+        if (dsf_canonify(wk->dsf, i) != i) continue;
+        int size = dsf_size(wk->dsf, i);
+        if (size > CLASSIK_MAX_CAGE_SIZE && !HAS_MODE(r->mode_flags, MODE_KILLER)) {
+            res->code = VERIFY_CAGE_SIZE;
+            res->detail = (short)size;
+            return;
+        }
+        if ((wk->clues[i] & CMASK) == C_MUL && size > max_mul) {
+            res->code = VERIFY_MUL_CAGE;
+            res->detail = (short)size;
+            return;
+        }
+    }
+}
+
+static int aux_digit(char c) {
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'Z' ? c - 'A' + 10 : -1;
+}
+
+static void verify_one(verify_worker* wk, const corpus_record* r, verify_result* res) {
+    int a = r->w * r->w, ret;
+
+    res->code = VERIFY_OK;
+    res->detail = 0;
+    if (r->w < MIN_GRID_SIZE || r->w > MAX_GRID_SIZE || r->diff >= DIFFCOUNT ||
+        !decode_desc(wk, r, res)) {
+        res->code = VERIFY_PARSE;
+        return;
+    }
+    if (res->code != VERIFY_OK) return;
+    check_cages(wk, r, res);
+    if (res->code != VERIFY_OK) return;
+
+    /*
+     * Graded difficulty, exactly as the generator accepts a puzzle: no
+     * solution at the level below, a complete one at the puzzle's own.
+     * A complete deductive solve is also a proof of uniqueness, so the
+     * recursive solver is only needed to classify a failure.
+     */
+    keen_grader_load(wk->grader, r->w, wk->dsf, wk->clues, r->mode_flags);
+    if (r->diff > 0) {
+        ret = keen_grader_solve(wk->grader, wk->soln, r->diff - 1);
+        if (ret <= r->diff - 1) {
+            res->code = VERIFY_TOO_EASY;
+            res->detail = (short)ret;
+            return;
+        }
+    }
+    ret = keen_grader_solve(wk->grader, wk->soln, r->diff);
+    if (ret != r->diff) {
+        int full = keen_grader_solve(wk->grader, wk->soln, DIFF_INCOMPREHENSIBLE);
+        res->code = full == diff_impossible   ? VERIFY_UNSOLVABLE
+                    : full == diff_ambiguous  ? VERIFY_AMBIGUOUS
+                    : ret < r->diff           ? VERIFY_TOO_EASY
+                                              : VERIFY_TOO_HARD;
+        res->detail = (short)ret;
+        return;
+    }
+
+    if (r->aux) {
+        if (r->aux[0] != 'S' || (int)strlen(r->aux) != a + 1) {
+            res->code = VERIFY_PARSE;
+            return;
+        }
+        for (int i = 0; i < a; i++)
+            if (aux_digit(r->aux[i + 1]) != wk->soln[i]) {
+                res->code = VERIFY_SOLUTION;
+                res->detail = (short)i;
+                return;
+            }
+    }
+}
+
+/* ----------------------------------------------------------------------
+ * Work-stealing pool.
+ *
+ * The corpus is split into one contiguous range per worker. A worker
+ * claims records from the front of its own range with an atomic
+ * increment; once that runs dry it claims them the same way from the
+ * range with the most left, so a few slow puzzles (deep recursion) never
+ * leave the other cores idle. Results land in a per-record array, which
+ * keeps the report in input order whatever the scheduling.
+ */
+
+static int claim(verify_worker* wk) {
+    int i = atomic_fetch_add_explicit(&wk->next, 1, memory_order_relaxed);
+    return i < wk->end ? i : -1;
+}
+
+static void* worker_main(void* varg) {
+    worker_arg* arg = varg;
+    verify_pool* pool = arg->pool;
+    verify_worker* self = &pool->workers[arg->id];
+    for (;;) {
+        int i = claim(self);
+        if (i < 0) {
+            verify_worker* victim = nullptr;
+            int most = 0;
+            for (int k = 0; k < pool->nworkers; k++) {
+                verify_worker* wk = &pool->workers[k];
+                int left = wk->end - atomic_load_explicit(&wk->next, memory_order_relaxed);
+                if (left > most) {
+                    most = left;
+                    victim = wk;
+                }
+            }
+            if (!victim) break;
+            if ((i = claim(victim)) < 0) continue;
+            self->stolen++;
+        }
+        verify_one(self, &pool->c->recs[i], &pool->results[i]);
+        self->done++;
+    }
+
+    return nullptr;
+}
+
+static void run_pool(verify_pool* pool) {
+    int n = pool->c->n, nw = pool->nworkers;
+    pthread_t* threads = snewn(nw, pthread_t);
+    worker_arg* args = snewn(nw, worker_arg);
+
+    for (int k = 0; k < nw; k++) {
+        verify_worker* wk = &pool->workers[k];
+        atomic_init(&wk->next, (int)((long)n * k / nw));
+        wk->end = (int)((long)n * (k + 1) / nw);
+        wk->done = wk->stolen = 0;
+        wk->grader = keen_grader_new();
+        keen_grader_set_branching(wk->grader, pool->branching);
+        keen_grader_set_nogoods(wk->grader, pool->nogoods);
+        args[k].pool = pool;
+        args[k].id = k;
+    }
+    for (int k = 1; k < nw; k++) pthread_create(&threads[k], nullptr, worker_main, &args[k]);
+    worker_main(&args[0]);
+    for (int k = 1; k < nw; k++) pthread_join(threads[k], nullptr);
+
+    sfree(args);
+    sfree(threads);
+}
+
+/* ----------------------------------------------------------------------
+ * Entry points.
+ */
+
+static int generate(int w, int diff, int count, const char* seed, int predict,
+                    const char* adapt_path) {
+    game_params params = {
+        .w = w, .diff = diff, .multiplication_only = 0, .mode_flags = 0, .profile = 0};
+    int ret = 0;
+
+    if (w < MIN_GRID_SIZE || w > MAX_GRID_SIZE || diff < 0 || diff >= DIFFCOUNT) return 1;
+
+    random_state* rs = random_new(seed, (int)strlen(seed));
+    keen_gen* g = keen_gen_new();
+    keen_adapt* ad = nullptr;
+    keen_gen_set_predictor(g, predict);
+    if (adapt_path) {
+        ad = keen_adapt_new();
+        keen_adapt_load(ad, adapt_path); /* a missing file starts afresh */
+        keen_gen_set_adapt(g, ad);
+    }
+    printf("# %d puzzles, %dd%c, seed \"%s\"\n", count, w, DIFF_CHARS[diff], seed);
+    for (int i = 0; i < count; i++) {
+        char* aux = nullptr;
+        char* desc = keen_gen_run(g, &params, rs, &aux);
+        if (!desc) {
+            ret = 1;
+            break;
+        }
+        printf("%dd%c:%s:%s\n", w, DIFF_CHARS[diff], desc, aux ? aux : "");
+        sfree(desc);
+        sfree(aux);
+    }
+
+    const keen_gen_stats* st = keen_gen_get_stats(g);
+    printf("# Generated %ld of %ld: %ld attempts, %ld graded\n", st->accepted, st->runs,
+           st->attempts, st->graded);
+    printf("# Predictor: %ld scored, %ld rejected (%.1f%% of attempts)", st->scored, st->rejected,
+           st->attempts ? 100.0 * st->rejected / st->attempts : 0.0);
+    if (predict == KEEN_PREDICT_SHADOW)
+        printf(", %ld would be, losing %ld accepted puzzles (%.1f%% precise)", st->shadow_rejects,
+               st->shadow_lost,
+               st->shadow_rejects ? 100.0 * (st->shadow_rejects - st->shadow_lost) /
+                                        st->shadow_rejects
+                                  : 100.0);
+    printf("\n");
+    if (ad) {
+        long tries, hits;
+        keen_adapt_totals(ad, w, diff, params.profile, &tries, &hits);
+        printf("# Adapt: %ld attempts, %ld hits recorded for %dd%c (%.3f%% hit rate)\n", tries,
+               hits, w, DIFF_CHARS[diff], tries ? 100.0 * hits / tries : 0.0);
+        if (!keen_adapt_save(ad, adapt_path)) {
+            fprintf(stderr, "%s: cannot write\n", adapt_path);
+            ret = 1;
+        }
+    }
+
+    keen_gen_free(g);
+    keen_adapt_free(ad);
+    random_free(rs);
+    return ret;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: keen_corpus_verify [-j threads] [-b branching] [-n] [-o pack.out] <corpus>\n"
+            "       keen_corpus_verify --generate <w> <diff> <count>"
+            " [seed [predictor [adapt-file]]]\n");
+}
+
+int main(int argc, char** argv) {
+    int nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN), branching = KEEN_BRANCH_MRV, nogoods = 0;
+    const char *path = nullptr, *pack_out = nullptr;
+
+    if (argc >= 5 && !strcmp(argv[1], "--generate"))
+        return generate(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]),
+                        argc > 5 ? argv[5] : "corpus",
+                        argc > 6 ? atoi(argv[6]) : KEEN_PREDICT_OFF,
+                        argc > 7 ? argv[7] : nullptr);
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            nworkers = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            branching = (int)strtol(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "-n")) {
+            nogoods = 1;
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            pack_out = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1]) {
+            usage();
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        usage();
+        return 2;
+    }
+    if (nworkers < 1) nworkers = 1;
+
+    FILE* fp = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+    if (!fp) {
+        perror(path);
+        return 2;
+    }
+    corpus c = {nullptr, 0, 0};
+    char magic[4] = {0};
+    int is_pack = fp != stdin && fread(magic, 1, 4, fp) == 4 && !memcmp(magic, PACK_MAGIC, 4);
+    if (fp != stdin) rewind(fp);
+    int ok = is_pack ? read_pack(fp, &c) : read_text(fp, &c);
+    if (fp != stdin) fclose(fp);
+    if (!ok) {
+        fprintf(stderr, "%s: truncated or corrupt pack\n", path);
+        corpus_free(&c);
+        return 2;
+    }
+    if (pack_out && !write_pack(pack_out, &c)) {
+        perror(pack_out);
+        corpus_free(&c);
+        return 2;
+    }
+
+    if (nworkers > c.n) nworkers = c.n > 0 ? c.n : 1;
+    verify_pool pool = {&c, snewn(c.n > 0 ? c.n : 1, verify_result), nullptr, nworkers,
+                        branching, nogoods};
+    pool.workers = aligned_alloc(64, sizeof(verify_worker) * (size_t)nworkers);
+    if (!pool.workers) fatal("out of memory");
+
+    double start = get_time_ms();
+    run_pool(&pool);
+    double elapsed = get_time_ms() - start;
+
+    int counts[VERIFY_NCODES] = {0};
+    for (int i = 0; i < c.n; i++) {
+        const verify_result* res = &pool.results[i];
+        const corpus_record* r = &c.recs[i];
+        counts[res->code]++;
+        if (res->code == VERIFY_OK) continue;
+        printf("FAIL %s=%d params=%dd%c", is_pack ? "record" : "line", r->line, r->w,
+               r->diff < DIFFCOUNT ? DIFF_CHARS[r->diff] : '?');
+        if (r->mode_flags) printf("f%d", r->mode_flags);
+        printf(" code=%s detail=%d\n", VERIFY_NAMES[res->code], res->detail);
+    }
+
+    int stolen = 0;
+    struct latin_search_stats search = {0, 0, 0, 0};
+    for (int k = 0; k < nworkers; k++) {
+        const struct latin_search_stats* st = keen_grader_stats(pool.workers[k].grader);
+        stolen += pool.workers[k].stolen;
+        search.nodes += st->nodes;
+        search.nogood_hits += st->nogood_hits;
+        search.nogood_stores += st->nogood_stores;
+        search.pruned += st->pruned;
+        keen_grader_free(pool.workers[k].grader);
+    }
+    printf("Verified %d puzzles in %.1f ms on %d threads (%.0f puzzles/s, %d stolen)\n", c.n,
+           elapsed, nworkers, elapsed > 0 ? c.n * 1000.0 / elapsed : 0.0, stolen);
+    printf("Recursion: %ld nodes, %ld nogoods stored, %ld hits pruning %ld nodes\n", search.nodes,
+           search.nogood_stores, search.nogood_hits, search.pruned);
+    printf("Passed %d, failed %d", counts[VERIFY_OK], c.n - counts[VERIFY_OK]);
+    for (int k = 1; k < VERIFY_NCODES; k++)
+        if (counts[k]) printf(", %s %d", VERIFY_NAMES[k], counts[k]);
+    printf("\n");
+
+    free(pool.workers);
+    sfree(pool.results);
+    corpus_free(&c);
+    return counts[VERIFY_OK] == c.n ? 0 : 1;
+}
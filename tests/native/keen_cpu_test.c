@@ -0,0 +1,170 @@
+/*
+ * keen_cpu_test.c: Cross-check tests for keen_cpu.c kernel dispatch
+ *
+ * Runs every kernel table the running CPU supports against the scalar
+ * reference on random inputs, checks SHA-1 against known digests, and
+ * drives generation and validation with cross-check mode enabled.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keen.h"
+#include "keen_cpu.h"
+#include "keen_internal.h"
+#include "keen_validate.h"
+#include "puzzles.h"
+#include "test_puzzle.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST_ASSERT(cond, msg)                                      \
+    do {                                                            \
+        tests_run++;                                                \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL: %s (line %d): %s\n",             \
+                    __func__, __LINE__, msg);                       \
+            return 0;                                               \
+        }                                                           \
+        tests_passed++;                                             \
+    } while (0)
+
+#define RUN_TEST(fn)                                                \
+    do {                                                            \
+        printf("Running %s... ", #fn);                              \
+        if (fn()) {                                                 \
+            printf("PASS\n");                                       \
+        } else {                                                    \
+            printf("FAIL\n");                                       \
+        }                                                           \
+    } while (0)
+
+/*
+ * Test 1: SHA-1 through the dispatched kernel matches the FIPS 180
+ * digests for one- and two-block messages.
+ */
+static int test_sha1_vectors(void) {
+    static const struct {
+        const char* msg;
+        const char* hex;
+    } vectors[] = {
+        {"abc", "a9993e364706816aba3e25717850c26c9cd0d89d"},
+        {"", "da39a3ee5e6b4b0d3255bfef95601890afd80709"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "84983e441c3bd26ebaae4aa1f95129e5e54670f1"},
+    };
+
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+        unsigned char out[20];
+        char hex[41];
+        SHA_Simple(vectors[v].msg, (int)strlen(vectors[v].msg), out);
+        for (int i = 0; i < 20; i++) snprintf(hex + 2 * i, 3, "%02x", out[i]);
+        TEST_ASSERT(!strcmp(hex, vectors[v].hex), vectors[v].msg);
+    }
+    return 1;
+}
+
+/*
+ * Test 2: Every kernel table buildable from a subset of the CPU's
+ * features agrees with the scalar reference on random inputs.
+ */
+static int test_kernels_match_scalar(void) {
+    unsigned features = keen_cpu_features();
+    keen_kernels ref = keen_kernels_for(0);
+    random_state* rs = random_new("kernels", 7);
+    int fill_bad = 0, dup_bad = 0, sha_bad = 0;
+
+    printf("[features 0x%x, active %s] ", features, keen_kernels_get()->name);
+    TEST_ASSERT(!strcmp(ref.name, "scalar"), "no-feature table is scalar");
+
+    /* Walk all submasks of the feature set, including the full set */
+    unsigned sub = features;
+    do {
+        keen_kernels k = keen_kernels_for(sub);
+
+        for (int trial = 0; trial < 200; trial++) {
+            int n = (int)random_upto(rs, 40);
+            int value = (int)random_upto(rs, 1000) - 500;
+            int got[48], want[48];
+            for (int i = 0; i < 48; i++) got[i] = want[i] = i;
+            k.fill_i32(got, n, value);
+            ref.fill_i32(want, n, value);
+            fill_bad += memcmp(got, want, sizeof(got)) != 0;
+
+            uint16_t m[16 * 16], twice_got[16], twice_want[16];
+            int rows = (int)random_upto(rs, 17);
+            for (int i = 0; i < 16 * 16; i++) m[i] = (uint16_t)(1U << random_upto(rs, 17));
+            k.dup_masks(m, rows, twice_got);
+            ref.dup_masks(m, rows, twice_want);
+            dup_bad += memcmp(twice_got, twice_want, sizeof(twice_got)) != 0;
+
+            unsigned char block[64];
+            uint32_t h_got[5], h_want[5];
+            for (int i = 0; i < 64; i++) block[i] = (unsigned char)random_upto(rs, 256);
+            for (int i = 0; i < 5; i++) h_got[i] = h_want[i] = (uint32_t)random_bits(rs, 32);
+            k.sha1_block(h_got, block);
+            ref.sha1_block(h_want, block);
+            sha_bad += memcmp(h_got, h_want, sizeof(h_got)) != 0;
+        }
+        sub = (sub - 1) & features;
+    } while (sub != features);
+
+    random_free(rs);
+    TEST_ASSERT(fill_bad == 0, "fill_i32 differs from scalar");
+    TEST_ASSERT(dup_bad == 0, "dup_masks differs from scalar");
+    TEST_ASSERT(sha_bad == 0, "sha1_block differs from scalar");
+    return 1;
+}
+
+/*
+ * Test 3: With cross-check mode on, generation (SHA-1 and maxflow) and
+ * grid validation run every kernel call against the reference; any
+ * difference is fatal, so reaching the end is the check.
+ */
+static int test_crosscheck_generation(void) {
+    static const char* seeds[] = {"xc-1", "xc-2", "xc-3"};
+    int ok = 1;
+
+    keen_kernels_set_crosscheck(true);
+    TEST_ASSERT(!strcmp(keen_kernels_get()->name, "crosscheck"), "cross-check table active");
+
+    for (int s = 0; s < 3 && ok; s++) {
+        test_puzzle pz;
+        int w = 4 + 2 * s;
+        int errors[16 * 16];
+        if (!make_puzzle(w, DIFF_NORMAL, seeds[s], &pz)) {
+            ok = 0;
+            break;
+        }
+        validate_ctx ctx = {w, pz.soln, pz.dsf, pz.clues, 0, nullptr};
+        ok = kenken_validate_grid(&ctx, errors) == 0;
+        /* A duplicated digit must be flagged through the same kernel */
+        pz.soln[1] = pz.soln[0];
+        ok = ok && kenken_validate_grid(&ctx, errors) > 0;
+        free_puzzle(&pz);
+    }
+
+    keen_kernels_set_crosscheck(false);
+    TEST_ASSERT(ok, "generation and validation under cross-check");
+    TEST_ASSERT(strcmp(keen_kernels_get()->name, "crosscheck"), "cross-check table released");
+    return 1;
+}
+
+int main(void) {
+    printf("Kernel Dispatch Tests\n");
+    printf("=====================\n\n");
+
+    RUN_TEST(test_sha1_vectors);
+    RUN_TEST(test_kernels_match_scalar);
+    RUN_TEST(test_crosscheck_generation);
+
+    printf("\n=====================\n");
+    printf("Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
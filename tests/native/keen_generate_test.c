@@ -0,0 +1,703 @@
+/*
+ * keen_generate_test.c: Unit tests for the generation pipeline
+ *
+ * Checks that a reused generator context and plugged-in stages give the
+ * same puzzles as new_game_desc, that new_game_desc_from_grid builds on
+ * the grid it is given, that the stage timer sees every stage, that the
+ * difficulty predictor keeps its counters straight, that the adaptive
+ * controller learns from and steers the generator, that the
+ * region-growing partitioner makes sound cages, that clue values
+ * match their cages, that grids above 9x9 generate and encode, and
+ * that latin_check_lines names exactly the broken rows and columns.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keen.h"
+#include "keen_generate.h"
+#include "keen_internal.h"
+#include "keen_solver.h"
+#include "puzzles.h"
+#include "test_puzzle.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST_ASSERT(cond, msg)                                      \
+    do {                                                            \
+        tests_run++;                                                \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL: %s (line %d): %s\n",             \
+                    __func__, __LINE__, msg);                       \
+            return 0;                                               \
+        }                                                           \
+        tests_passed++;                                             \
+    } while (0)
+
+#define RUN_TEST(fn)                                                \
+    do {                                                            \
+        printf("Running %s... ", #fn);                              \
+        if (fn()) {                                                 \
+            printf("PASS\n");                                       \
+        } else {                                                    \
+            printf("FAIL\n");                                       \
+        }                                                           \
+    } while (0)
+
+/* Generate with a fresh new_game_desc call, for comparison. */
+static char* reference_desc(const game_params* params, const char* seed, char** aux) {
+    random_state* rs = random_new(seed, (int)strlen(seed));
+    char* desc = new_game_desc(params, rs, aux, 0);
+    random_free(rs);
+    return desc;
+}
+
+static int same_puzzle(keen_gen* g, const game_params* params, const char* seed) {
+    char *aux = nullptr, *raux = nullptr;
+    random_state* rs = random_new(seed, (int)strlen(seed));
+    char* desc = keen_gen_run(g, params, rs, &aux);
+    char* rdesc = reference_desc(params, seed, &raux);
+    int same = desc && rdesc && !strcmp(desc, rdesc) && !strcmp(aux, raux);
+
+    random_free(rs);
+    sfree(desc);
+    sfree(aux);
+    sfree(rdesc);
+    sfree(raux);
+    return same;
+}
+
+/*
+ * Test 1: One context reused across sizes, difficulties and profiles
+ * (growing and shrinking its buffers) matches one-off calls.
+ */
+static int test_reused_context(void) {
+    static const int sizes[] = {6, 4, 8, 3, 5, 7};
+    keen_gen* g = keen_gen_new();
+
+    for (int r = 0; r < 12; r++) {
+        char seed[32];
+        game_params params = {.w = sizes[r % 6], .diff = r % 3, .multiplication_only = 0,
+                              .mode_flags = r % 4 == 3 ? MODE_NUMBER_THEORY : 0,
+                              .profile = r % 4 == 3 ? 2 : r % 2};
+        snprintf(seed, sizeof(seed), "pipeline-%d", r);
+        TEST_ASSERT(same_puzzle(g, &params, seed), "Reused context gave a different puzzle");
+    }
+    keen_gen_free(g);
+    return 1;
+}
+
+/* Plugged-in stages that count their calls and defer to the defaults. */
+typedef struct {
+    int squares, grades;
+    int stage_calls[KEEN_STAGE_COUNT];
+    long stage_ns[KEEN_STAGE_COUNT];
+} stage_counts;
+
+static int counting_square(void* ctx, int w, digit* grid, random_state* rs) {
+    stage_counts* sc = ctx;
+    sc->squares++;
+    digit* sq = latin_generate(w, rs);
+    memcpy(grid, sq, (size_t)w * (size_t)w);
+    sfree(sq);
+    return true;
+}
+
+static int dry_square(void* ctx, [[maybe_unused]] int w, [[maybe_unused]] digit* grid,
+                      [[maybe_unused]] random_state* rs) {
+    ((stage_counts*)ctx)->squares++;
+    return false;
+}
+
+static int counting_grade(void* ctx, int w, int* dsf, clue_t* clues, digit* soln, int maxdiff,
+                          int mode_flags) {
+    ((stage_counts*)ctx)->grades++;
+    return keen_solver(w, dsf, clues, soln, maxdiff, mode_flags);
+}
+
+static void counting_timer(void* ctx, int stage, long ns) {
+    stage_counts* sc = ctx;
+    sc->stage_calls[stage]++;
+    sc->stage_ns[stage] += ns;
+}
+
+/*
+ * Test 2: Equivalent plugged-in stages change nothing, and the timer is
+ * called for every stage run; a square source that gives up ends the
+ * run.
+ */
+static int test_plugged_stages(void) {
+    game_params params = {.w = 6, .diff = DIFF_HARD, .multiplication_only = 0,
+                          .mode_flags = 0, .profile = 0};
+    stage_counts sc;
+    keen_gen* g = keen_gen_new();
+
+    memset(&sc, 0, sizeof(sc));
+    keen_gen_set_square_source(g, counting_square, &sc);
+    keen_gen_set_grader(g, counting_grade, &sc);
+    keen_gen_set_timer(g, counting_timer, &sc);
+    TEST_ASSERT(same_puzzle(g, &params, "plugged"), "Plugged stages gave a different puzzle");
+
+    TEST_ASSERT(sc.squares > 0 && sc.stage_calls[KEEN_STAGE_SQUARE] == sc.squares,
+                "Square stage not timed per attempt");
+    TEST_ASSERT(sc.grades > 0 && sc.stage_calls[KEEN_STAGE_GRADE] == sc.grades,
+                "Grade stage not timed per solve");
+    TEST_ASSERT(sc.stage_calls[KEEN_STAGE_PARTITION] == sc.squares,
+                "Partition stage not timed per attempt");
+    TEST_ASSERT(sc.stage_calls[KEEN_STAGE_TYPE] > 0 &&
+                    sc.stage_calls[KEEN_STAGE_VALUE] == sc.stage_calls[KEEN_STAGE_TYPE],
+                "Clue stages not timed");
+    TEST_ASSERT(sc.stage_calls[KEEN_STAGE_ENCODE] == 1, "Encoder not timed once");
+    for (int s = 0; s < KEEN_STAGE_COUNT; s++)
+        TEST_ASSERT(sc.stage_ns[s] >= 0, "Negative stage time");
+
+    /* Back to the defaults: the same puzzle again, no more counting */
+    keen_gen_set_square_source(g, nullptr, nullptr);
+    keen_gen_set_grader(g, nullptr, nullptr);
+    keen_gen_set_timer(g, nullptr, nullptr);
+    int squares = sc.squares;
+    TEST_ASSERT(same_puzzle(g, &params, "plugged"), "Default stages gave a different puzzle");
+    TEST_ASSERT(sc.squares == squares, "Unplugged square source still called");
+
+    /* A source that runs dry stops generation */
+    char* aux = nullptr;
+    random_state* rs = random_new("dry", 3);
+    sc.squares = 0;
+    keen_gen_set_square_source(g, dry_square, &sc);
+    TEST_ASSERT(keen_gen_run(g, &params, rs, &aux) == nullptr && aux == nullptr,
+                "Generation continued without squares");
+    TEST_ASSERT(sc.squares == 1, "Square source called after giving up");
+
+    random_free(rs);
+    keen_gen_free(g);
+    return 1;
+}
+
+/*
+ * Test 3: new_game_desc_from_grid builds its puzzle on the grid given,
+ * at the difficulty asked for.
+ */
+static int test_from_grid(void) {
+    random_state* rs = random_new("from-grid", 9);
+
+    for (int w = 4; w <= 7; w++) {
+        int a = w * w;
+        game_params params = {.w = w, .diff = DIFF_NORMAL, .multiplication_only = 0,
+                              .mode_flags = 0, .profile = 0};
+        digit* sq = latin_generate(w, rs);
+        char* aux = nullptr;
+        char* desc = new_game_desc_from_grid(&params, rs, sq, &aux, 0);
+        test_puzzle pz;
+
+        TEST_ASSERT(desc != nullptr, "Generation from a grid failed");
+        TEST_ASSERT(decode_puzzle(desc, aux, w, &pz), "Description does not decode");
+        TEST_ASSERT(!memcmp(pz.soln, sq, (size_t)a), "Solution is not the given grid");
+
+        digit* soln = snewn(a, digit);
+        memset(soln, 0, (size_t)a);
+        TEST_ASSERT(keen_solver(w, pz.dsf, pz.clues, soln, DIFF_NORMAL, 0) == DIFF_NORMAL,
+                    "Puzzle not graded Normal");
+        memset(soln, 0, (size_t)a);
+        TEST_ASSERT(keen_solver(w, pz.dsf, pz.clues, soln, DIFF_EASY, 0) > DIFF_EASY,
+                    "Puzzle solvable below Normal");
+
+        sfree(soln);
+        free_puzzle(&pz);
+        sfree(desc);
+        sfree(aux);
+        sfree(sq);
+    }
+    random_free(rs);
+    return 1;
+}
+
+/*
+ * Test 4: The predictor in shadow mode scores every attempt but changes
+ * nothing; in reject mode, every attempt is either rejected or graded and
+ * the puzzle produced still grades exactly at its target.
+ */
+static int test_predictor(void) {
+    game_params params = {.w = 5, .diff = DIFF_EXTREME, .multiplication_only = 0,
+                          .mode_flags = 0, .profile = 0};
+    keen_gen* g = keen_gen_new();
+
+    keen_gen_set_predictor(g, KEEN_PREDICT_SHADOW);
+    TEST_ASSERT(same_puzzle(g, &params, "predict-shadow"), "Shadow mode changed the puzzle");
+    const keen_gen_stats* st = keen_gen_get_stats(g);
+    TEST_ASSERT(st->runs == 1 && st->accepted == 1, "Run counters wrong");
+    TEST_ASSERT(st->scored == st->attempts && st->graded == st->attempts,
+                "Shadow mode skipped an attempt");
+    TEST_ASSERT(st->rejected == 0 && st->shadow_lost <= st->shadow_rejects,
+                "Shadow mode rejected an attempt");
+    keen_gen_free(g);
+
+    g = keen_gen_new();
+    keen_gen_set_predictor(g, KEEN_PREDICT_REJECT);
+    random_state* rs = random_new("predict-reject", 14);
+    char* aux = nullptr;
+    char* desc = keen_gen_run(g, &params, rs, &aux);
+    test_puzzle pz;
+    TEST_ASSERT(desc != nullptr, "Generation with the predictor failed");
+    TEST_ASSERT(decode_puzzle(desc, aux, params.w, &pz), "Description does not decode");
+    digit soln[25] = {0};
+    TEST_ASSERT(keen_solver(params.w, pz.dsf, pz.clues, soln, DIFF_EXTREME, 0) == DIFF_EXTREME,
+                "Puzzle not graded Extreme");
+    st = keen_gen_get_stats(g);
+    TEST_ASSERT(st->scored == st->attempts && st->graded + st->rejected == st->attempts,
+                "Reject counters don't add up");
+
+    free_puzzle(&pz);
+    sfree(desc);
+    sfree(aux);
+    random_free(rs);
+
+    /* Targets below Extreme are never predicted */
+    long scored = st->scored;
+    params.diff = DIFF_NORMAL;
+    TEST_ASSERT(same_puzzle(g, &params, "predict-normal"), "Predictor changed a Normal puzzle");
+    TEST_ASSERT(st->runs == 2 && st->scored == scored, "Predictor ran below Extreme");
+    keen_gen_free(g);
+    return 1;
+}
+
+/*
+ * Test 5: Generating with an adaptive controller still gives puzzles at
+ * the target, and every attempt is recorded in it.
+ */
+static int test_adapt_generates(void) {
+    game_params params = {.w = 5, .diff = DIFF_NORMAL, .multiplication_only = 0,
+                          .mode_flags = 0, .profile = 0};
+    keen_gen* g = keen_gen_new();
+    keen_adapt* ad = keen_adapt_new();
+    random_state* rs = random_new("adapt", 5);
+    digit soln[25];
+
+    keen_gen_set_adapt(g, ad);
+    for (int r = 0; r < 6; r++) {
+        char* aux = nullptr;
+        char* desc = keen_gen_run(g, &params, rs, &aux);
+        test_puzzle pz;
+
+        TEST_ASSERT(desc != nullptr, "Adaptive generation failed");
+        TEST_ASSERT(decode_puzzle(desc, aux, params.w, &pz), "Description does not decode");
+        memset(soln, 0, sizeof(soln));
+        TEST_ASSERT(keen_solver(params.w, pz.dsf, pz.clues, soln, DIFF_NORMAL, 0) == DIFF_NORMAL,
+                    "Adapted puzzle not graded Normal");
+        free_puzzle(&pz);
+        sfree(desc);
+        sfree(aux);
+    }
+
+    long tries, hits;
+    keen_adapt_totals(ad, params.w, params.diff, params.profile, &tries, &hits);
+    TEST_ASSERT(tries == keen_gen_get_stats(g)->attempts && hits == 6,
+                "Attempts not recorded");
+
+    random_free(rs);
+    keen_adapt_free(ad);
+    keen_gen_free(g);
+    return 1;
+}
+
+/*
+ * Test 6: The controller moves to the setting with the best hit rate,
+ * keeps the cage cap within its limit, and survives a save and load.
+ */
+static int test_adapt_learns(void) {
+    static const char path[] = "keen_adapt_test.txt";
+    const keen_knobs fixed = {4, 6, KEEN_OPS_HARD};
+    keen_adapt* ad = keen_adapt_new();
+    keen_knobs k;
+    long tries, hits;
+
+    keen_adapt_best(ad, 6, DIFF_HARD, 0, &fixed, 6, &k);
+    TEST_ASSERT(!memcmp(&k, &fixed, sizeof(k)), "Empty controller moved off the defaults");
+
+    /* Easy clue types never hit; dominoes every time and small cages each
+     * add 8% to a 2% hit rate */
+    unsigned long state = 1;
+    for (int i = 0; i < 4000; i++) {
+        keen_knobs used = {i % 2 ? 2 : 4, i % 3 ? 4 : 6, i % 5 ? KEEN_OPS_HARD : KEEN_OPS_EASY};
+        int rate = used.op_order == KEEN_OPS_EASY
+                       ? 0
+                       : 2 + 8 * (used.domino_divisor == 2) + 8 * (used.maxblk == 4);
+        state = state * 1103515245 + 12345;
+        keen_adapt_record(ad, 6, DIFF_HARD, 0, &used, (int)((state >> 16) % 100) < rate);
+    }
+    keen_adapt_best(ad, 6, DIFF_HARD, 0, &fixed, 6, &k);
+    TEST_ASSERT(k.domino_divisor == 2 && k.maxblk == 4 && k.op_order == KEEN_OPS_HARD,
+                "Controller didn't pick the best settings");
+
+    /* A cap that hits more often is still out of reach above the limit */
+    for (int i = 0; i < 400; i++)
+        keen_adapt_record(ad, 6, DIFF_HARD, 0, &(keen_knobs){2, 8, KEEN_OPS_HARD}, true);
+    keen_adapt_best(ad, 6, DIFF_HARD, 0, &fixed, 6, &k);
+    TEST_ASSERT(k.maxblk == 4, "Cage cap exceeded its limit");
+    keen_adapt_best(ad, 6, DIFF_HARD, 0, &fixed, 16, &k);
+    TEST_ASSERT(k.maxblk == 8, "Cage cap ignored a better value");
+
+    /* Exploring still mostly follows the best settings */
+    int best = 0;
+    for (int i = 0; i < 200; i++) {
+        keen_adapt_choose(ad, 6, DIFF_HARD, 0, &fixed, 16, &k);
+        best += k.domino_divisor == 2;
+    }
+    TEST_ASSERT(best > 150 && best < 200, "Exploration rate off");
+
+    /* Other cells are untouched */
+    keen_adapt_best(ad, 7, DIFF_HARD, 0, &fixed, 6, &k);
+    TEST_ASSERT(!memcmp(&k, &fixed, sizeof(k)), "Learning leaked into another cell");
+
+    keen_adapt* loaded = keen_adapt_new();
+    TEST_ASSERT(keen_adapt_save(ad, path), "Save failed");
+    TEST_ASSERT(keen_adapt_load(loaded, path), "Load failed");
+    keen_adapt_totals(loaded, 6, DIFF_HARD, 0, &tries, &hits);
+    TEST_ASSERT(tries == 4400 && hits > 400, "Counts lost in the file");
+    keen_adapt_best(loaded, 6, DIFF_HARD, 0, &fixed, 16, &k);
+    TEST_ASSERT(k.domino_divisor == 2 && k.maxblk == 8, "Loaded controller chose differently");
+
+    /* Anything else is refused, and leaves nothing behind */
+    FILE* fp = fopen(path, "w");
+    fputs("keen-adapt 1\n6 2 0 divisor 2 10 11\n", fp);
+    fclose(fp);
+    TEST_ASSERT(!keen_adapt_load(loaded, path), "Corrupt file loaded");
+    keen_adapt_totals(loaded, 6, DIFF_HARD, 0, &tries, &hits);
+    TEST_ASSERT(tries == 0, "Corrupt file left counts behind");
+    remove(path);
+    TEST_ASSERT(!keen_adapt_load(loaded, path), "Missing file loaded");
+
+    keen_adapt_free(loaded);
+    keen_adapt_free(ad);
+    return 1;
+}
+
+/*
+ * Test 7: Non-Classik puzzles lifted by cage merging keep cages within
+ * the size cap, with clues that hold for the solution and grade at the
+ * target.
+ */
+static int test_merged_cages(void) {
+    keen_gen* g = keen_gen_new();
+    int merged = 0;
+
+    for (int r = 0; r < 6; r++) {
+        char seed[32];
+        game_params params = {.w = 7 + r % 3, .diff = DIFF_HARD, .multiplication_only = 0,
+                              .mode_flags = 0, .profile = 2};
+        int w = params.w, a = w * w;
+        snprintf(seed, sizeof(seed), "merge-%d", r);
+        random_state* rs = random_new(seed, (int)strlen(seed));
+        char* aux = nullptr;
+        char* desc = keen_gen_run(g, &params, rs, &aux);
+        test_puzzle pz;
+
+        TEST_ASSERT(desc != nullptr, "Generation failed");
+        TEST_ASSERT(decode_puzzle(desc, aux, w, &pz), "Description does not decode");
+        for (int i = 0; i < a; i++) {
+            int size = dsf_size(pz.dsf, i);
+            TEST_ASSERT(size <= 8, "Cage over the size cap");
+            if (dsf_canonify(pz.dsf, i) != i || (pz.clues[i] & CMASK) != C_ADD) continue;
+            clue_t sum = 0;
+            for (int j = 0; j < a; j++)
+                if (dsf_canonify(pz.dsf, j) == i) sum += pz.soln[j];
+            TEST_ASSERT((pz.clues[i] & ~CMASK) == sum, "Cage sum wrong");
+            if (size >= 4) merged++;
+        }
+        digit* soln = snewn(a, digit);
+        memset(soln, 0, (size_t)a);
+        TEST_ASSERT(keen_solver(w, pz.dsf, pz.clues, soln, DIFF_HARD, 0) == DIFF_HARD,
+                    "Merged puzzle not graded Hard");
+        TEST_ASSERT(!memcmp(soln, pz.soln, (size_t)a), "Wrong solution");
+
+        sfree(soln);
+        free_puzzle(&pz);
+        sfree(desc);
+        sfree(aux);
+        random_free(rs);
+    }
+    TEST_ASSERT(merged > 0, "No large cages seen");
+    keen_gen_free(g);
+    return 1;
+}
+
+/* Whether every cage of dsf is a connected group of at most maxblk squares. */
+static int cages_ok(int w, int* dsf, int maxblk) {
+    int a = w * w, ok = true;
+    int* seen = snewn(a, int);
+    int* stack = snewn(a, int);
+
+    memset(seen, 0, (size_t)a * sizeof(int));
+    for (int i = 0; i < a && ok; i++) {
+        if (dsf_canonify(dsf, i) != i) continue;
+        int n = 0, reached = 0;
+        stack[n++] = i;
+        seen[i] = true;
+        while (n) {
+            int c = stack[--n], x = c % w, y = c / w;
+            int nb[4] = {x > 0 ? c - 1 : -1, x + 1 < w ? c + 1 : -1, y > 0 ? c - w : -1,
+                         y + 1 < w ? c + w : -1};
+            reached++;
+            for (int k = 0; k < 4; k++)
+                if (nb[k] >= 0 && !seen[nb[k]] && dsf_canonify(dsf, nb[k]) == i)
+                    seen[nb[k]] = true, stack[n++] = nb[k];
+        }
+        ok = reached == dsf_size(dsf, i) && reached <= maxblk;
+    }
+    sfree(stack);
+    sfree(seen);
+    return ok;
+}
+
+/*
+ * Test 8: The region-growing partitioner always succeeds with connected
+ * cages under the cap, follows a requested size mix, and drives the
+ * generator to puzzles at the target.
+ */
+static int test_grow_partitioner(void) {
+    random_state* rs = random_new("grow", 4);
+    int* dsf = snew_dsf(81);
+    keen_cage_sizes triples = {{[3] = 1}};
+    long hist[KEEN_MAX_CAGE + 1] = {0};
+
+    for (int r = 0; r < 140; r++) {
+        int w = 3 + r % 7, maxblk = 4 + r % 5;
+        dsf_init(dsf, w * w);
+        TEST_ASSERT(keen_partition_grow(nullptr, w, r % DIFFCOUNT, maxblk, dsf, rs),
+                    "Partitioner failed");
+        TEST_ASSERT(cages_ok(w, dsf, maxblk), "Bad cage");
+
+        dsf_init(dsf, 36);
+        keen_partition_grow(&triples, 6, DIFF_HARD, 6, dsf, rs);
+        TEST_ASSERT(cages_ok(6, dsf, 6), "Bad cage");
+        for (int i = 0; i < 36; i++)
+            if (dsf_canonify(dsf, i) == i) hist[dsf_size(dsf, i)]++;
+    }
+    TEST_ASSERT(hist[3] * 4 > (hist[1] + hist[2] + hist[4] + hist[5] + hist[6]) * 5,
+                "Cage sizes ignore the target");
+
+    keen_gen* g = keen_gen_new();
+    keen_gen_set_partitioner(g, keen_partition_grow, nullptr);
+    for (int w = 4; w <= 7; w++) {
+        game_params params = {.w = w, .diff = DIFF_NORMAL, .multiplication_only = 0,
+                              .mode_flags = 0, .profile = 0};
+        char* aux = nullptr;
+        char* desc = keen_gen_run(g, &params, rs, &aux);
+        test_puzzle pz;
+        digit soln[49] = {0};
+
+        TEST_ASSERT(desc != nullptr, "Generation with the partitioner failed");
+        TEST_ASSERT(decode_puzzle(desc, aux, w, &pz), "Description does not decode");
+        TEST_ASSERT(keen_solver(w, pz.dsf, pz.clues, soln, DIFF_NORMAL, 0) == DIFF_NORMAL,
+                    "Puzzle not graded Normal");
+        free_puzzle(&pz);
+        sfree(desc);
+        sfree(aux);
+    }
+    keen_gen_free(g);
+    sfree(dsf);
+    random_free(rs);
+    return 1;
+}
+
+/* A cage's clue value worked out from its digits. */
+static clue_t cage_value(clue_t op, const digit* d, int n) {
+    clue_t v = d[0];
+    for (int m = 1; m < n; m++) {
+        clue_t x = d[m], hi = v > x ? v : x, lo = v > x ? x : v;
+        switch (op) {
+            case C_ADD: v += x; break;
+            case C_MUL: v *= x; break;
+            case C_SUB: v = hi - lo; break;
+            case C_DIV: v = hi / lo; break;
+            case C_MOD: v = hi % lo; break;
+            case C_XOR: v ^= x; break;
+            case C_EXP:
+                v = 1;
+                for (clue_t e = 0; e < hi; e++) v *= lo;
+                break;
+            case C_GCD:
+            case C_LCM: {
+                clue_t a = hi, b = lo;
+                while (b) {
+                    clue_t t = a % b;
+                    a = b;
+                    b = t;
+                }
+                v = op == C_GCD ? a : hi / a * lo;
+            } break;
+        }
+    }
+    return v;
+}
+
+/*
+ * Test 9: Every clue the typer and valuer write, in every op-adding
+ * mode, matches its cage's digits.
+ */
+static int test_clue_values(void) {
+    static const int modes[] = {0, MODE_NUMBER_THEORY, MODE_EXPONENT, MODE_BITWISE,
+                                MODE_MODULAR};
+    keen_gen* g = keen_gen_new();
+    int pair_ops = 0;
+
+    for (int r = 0; r < 15; r++) {
+        char seed[32];
+        game_params params = {.w = 4 + r % 3, .diff = r % 3, .multiplication_only = 0,
+                              .mode_flags = modes[r % 5], .profile = r % 5 ? 2 : 0};
+        int w = params.w, a = w * w;
+        snprintf(seed, sizeof(seed), "values-%d", r);
+        random_state* rs = random_new(seed, (int)strlen(seed));
+        char* aux = nullptr;
+        char* desc = keen_gen_run(g, &params, rs, &aux);
+        test_puzzle pz;
+
+        TEST_ASSERT(desc != nullptr, "Generation failed");
+        TEST_ASSERT(decode_puzzle(desc, aux, w, &pz), "Description does not decode");
+        for (int i = 0; i < a; i++) {
+            if (dsf_canonify(pz.dsf, i) != i) continue;
+            digit d[81];
+            int n = 0;
+            for (int j = 0; j < a; j++)
+                if (dsf_canonify(pz.dsf, j) == i) d[n++] = pz.soln[j];
+            clue_t op = pz.clues[i] & CMASK, v = cage_value(op, d, n);
+            if (params.mode_flags & MODE_MODULAR) v %= (clue_t)w;
+            TEST_ASSERT((pz.clues[i] & ~CMASK) == v, "Clue value wrong");
+            if (op != C_ADD && op != C_MUL) pair_ops++;
+        }
+        free_puzzle(&pz);
+        sfree(desc);
+        sfree(aux);
+        random_free(rs);
+    }
+    TEST_ASSERT(pair_ops > 0, "No domino-only clues seen");
+    keen_gen_free(g);
+    return 1;
+}
+
+/*
+ * Test 10: Classik grids above 9x9 generate at the requested level,
+ * with cage roots written at a fixed width wide enough for every cell
+ * index and digits above 9 written as letters.
+ */
+static int test_large_grids(void) {
+    static const int sizes[] = {10, 12, 16};
+    keen_gen* g = keen_gen_new();
+
+    for (int r = 0; r < 3; r++) {
+        char seed[32];
+        game_params params = {.w = sizes[r], .diff = DIFF_NORMAL, .multiplication_only = 0,
+                              .mode_flags = 0, .profile = 0};
+        int w = params.w, a = w * w, width = a > 100 ? 3 : 2;
+        snprintf(seed, sizeof(seed), "large-%d", r);
+        random_state* rs = random_new(seed, (int)strlen(seed));
+        char* aux = nullptr;
+        char* desc = keen_gen_run(g, &params, rs, &aux);
+        test_puzzle pz;
+
+        TEST_ASSERT(desc != nullptr, "Generation failed");
+        TEST_ASSERT(strcspn(desc, ",") == (size_t)width, "Cage root has the wrong width");
+        TEST_ASSERT(decode_puzzle(desc, aux, w, &pz), "Description does not decode");
+        for (int i = 0; i < a; i++) {
+            int row = 0, col = 0;
+            for (int j = 0; j < w; j++) {
+                row |= 1 << pz.soln[i / w * w + j];
+                col |= 1 << pz.soln[j * w + i % w];
+            }
+            TEST_ASSERT(row == ((1 << (w + 1)) - 2) && col == row, "Solution is not Latin");
+        }
+        digit* soln = snewn(a, digit);
+        memset(soln, 0, (size_t)a);
+        TEST_ASSERT(keen_solver(w, pz.dsf, pz.clues, soln, DIFF_NORMAL, 0) == DIFF_NORMAL,
+                    "Puzzle does not grade at its level");
+        TEST_ASSERT(!memcmp(soln, pz.soln, (size_t)a), "Solver found a different solution");
+        sfree(soln);
+        free_puzzle(&pz);
+        sfree(desc);
+        sfree(aux);
+        random_free(rs);
+    }
+    keen_gen_free(g);
+    return 1;
+}
+
+/* Count the flagged lines and check they are exactly the expected ones. */
+static int lines_match(const unsigned char* bad, int order, int a, int b) {
+    for (int i = 0; i < order; i++)
+        if (bad[i] != (i == a || i == b)) return 0;
+    return 1;
+}
+
+/*
+ * Test 11: latin_check_lines passes generated squares and flags just
+ * the lines a swap, a bad digit or repeated rows break, on both the
+ * word-per-line path (order <= 16) and the general one.
+ */
+static int test_latin_check(void) {
+    static const int orders[] = {3, 5, 9, 12, 16, 20};
+    random_state* rs = random_new("latin-check", 11);
+    unsigned char rows[20], cols[20];
+
+    for (int r = 0; r < 6; r++) {
+        int o = orders[r];
+        digit* sq = latin_generate(o, rs);
+
+        TEST_ASSERT(latin_check_lines(sq, o, rows, cols) == 0, "Latin square flagged");
+        TEST_ASSERT(lines_match(rows, o, -1, -1) && lines_match(cols, o, -1, -1),
+                    "Line of a latin square flagged");
+
+        /* Swapping within row 1 breaks the two columns involved */
+        digit t = sq[o + 0];
+        sq[o + 0] = sq[o + 2];
+        sq[o + 2] = t;
+        TEST_ASSERT(latin_check_lines(sq, o, rows, cols) == 2, "Swap not counted");
+        TEST_ASSERT(lines_match(rows, o, -1, -1) && lines_match(cols, o, 0, 2),
+                    "Swap flagged the wrong lines");
+        sq[o + 2] = sq[o + 0];
+        sq[o + 0] = t;
+
+        /* Out-of-range digits break their row and column */
+        for (int bad = 0; bad <= 1; bad++) {
+            digit keep = sq[2 * o + 1];
+            sq[2 * o + 1] = (digit)(bad ? o + 1 : 0);
+            TEST_ASSERT(latin_check_lines(sq, o, rows, cols) == 2, "Bad digit not counted");
+            TEST_ASSERT(lines_match(rows, o, 2, -1) && lines_match(cols, o, 1, -1),
+                        "Bad digit flagged the wrong lines");
+            TEST_ASSERT(latin_check(sq, o), "latin_check missed a bad digit");
+            sq[2 * o + 1] = keep;
+        }
+
+        /* Every digit o times over, but in repeated rows */
+        for (int i = 0; i < o * o; i++) sq[i] = (digit)(i % o + 1);
+        TEST_ASSERT(latin_check_lines(sq, o, nullptr, nullptr) == o, "Repeated rows passed");
+        sfree(sq);
+    }
+    random_free(rs);
+    return 1;
+}
+
+int main(void) {
+    printf("Generation Pipeline Unit Tests\n");
+    printf("==============================\n\n");
+
+    RUN_TEST(test_reused_context);
+    RUN_TEST(test_plugged_stages);
+    RUN_TEST(test_from_grid);
+    RUN_TEST(test_predictor);
+    RUN_TEST(test_adapt_generates);
+    RUN_TEST(test_adapt_learns);
+    RUN_TEST(test_merged_cages);
+    RUN_TEST(test_grow_partitioner);
+    RUN_TEST(test_clue_values);
+    RUN_TEST(test_large_grids);
+    RUN_TEST(test_latin_check);
+
+    printf("\n==============================\n");
+    printf("Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,371 @@
+/*
+ * keen_hints_test.c: Unit tests for keen_hints.c
+ *
+ * Generates Classik puzzles, decodes their descriptions and checks the
+ * hint entry points against the generator's own solution.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keen.h"
+#include "keen_hints.h"
+#include "keen_internal.h"
+#include "keen_solver.h"
+#include "puzzles.h"
+#include "test_puzzle.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST_ASSERT(cond, msg)                                      \
+    do {                                                            \
+        tests_run++;                                                \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL: %s (line %d): %s\n",             \
+                    __func__, __LINE__, msg);                       \
+            return 0;                                               \
+        }                                                           \
+        tests_passed++;                                             \
+    } while (0)
+
+#define RUN_TEST(fn)                                                \
+    do {                                                            \
+        printf("Running %s... ", #fn);                              \
+        if (fn()) {                                                 \
+            printf("PASS\n");                                       \
+        } else {                                                    \
+            printf("FAIL\n");                                       \
+        }                                                           \
+    } while (0)
+
+/*
+ * Test 1: Following the engine's hints from an empty grid solves every
+ * puzzle the generator grades at Extreme or below, and every hint agrees
+ * with the solution.
+ */
+static int test_engine_solves_puzzles(void) {
+    for (int w = 4; w <= 7; w++)
+        for (int diff = DIFF_EASY; diff <= DIFF_EXTREME; diff++) {
+            char seed[32];
+            test_puzzle pz;
+            snprintf(seed, sizeof(seed), "hints-%d-%d", w, diff);
+            TEST_ASSERT(make_puzzle(w, diff, seed, &pz), "Puzzle generation failed");
+
+            int a = w * w;
+            hint_engine* eng = kenken_hint_engine_new(w, pz.dsf, pz.clues, 0, nullptr);
+            hint_result hint;
+            int filled = 0;
+
+            while (kenken_hint_engine_next(eng, &hint)) {
+                TEST_ASSERT(hint.value == pz.soln[hint.cell], "Hint disagrees with solution");
+                TEST_ASSERT(hint.hint_type != HINT_NONE, "Hint without a type");
+                kenken_hint_engine_set_cell(eng, hint.cell, hint.value);
+                filled++;
+            }
+            TEST_ASSERT(filled == a, "Engine stalled before the grid was full");
+
+            kenken_hint_engine_free(eng);
+            free_puzzle(&pz);
+        }
+    return 1;
+}
+
+/*
+ * Test 2: Clearing and overwriting cells (including with a wrong digit)
+ * keeps the engine consistent with the player's grid.
+ */
+static int test_engine_tracks_edits(void) {
+    test_puzzle pz;
+    TEST_ASSERT(make_puzzle(6, DIFF_HARD, "hints-edits", &pz), "Puzzle generation failed");
+
+    int w = pz.w, a = w * w;
+    digit* grid = snewn(a, digit);
+    memset(grid, 0, (size_t)a);
+    hint_engine* eng = kenken_hint_engine_new(w, pz.dsf, pz.clues, 0, grid);
+    hint_result hint;
+
+    /* Fill half the grid from the solution, then clear a quarter again. */
+    for (int i = 0; i < a; i += 2) grid[i] = pz.soln[i];
+    kenken_hint_engine_sync(eng, grid);
+    for (int i = 0; i < a; i += 4) grid[i] = 0;
+    kenken_hint_engine_sync(eng, grid);
+
+    TEST_ASSERT(kenken_hint_engine_next(eng, &hint), "No hint for a consistent grid");
+    TEST_ASSERT(grid[hint.cell] == 0, "Hint for a filled cell");
+    TEST_ASSERT(hint.value == pz.soln[hint.cell], "Hint disagrees with solution");
+
+    /* A digit that clashes with its row leaves nothing to deduce. */
+    int cell = 1;
+    grid[0] = pz.soln[0];
+    grid[cell] = pz.soln[0];
+    kenken_hint_engine_sync(eng, grid);
+    TEST_ASSERT(!kenken_hint_engine_next(eng, &hint), "Hint offered for a contradictory grid");
+    TEST_ASSERT(hint.hint_type == HINT_NONE, "Expected HINT_NONE");
+
+    /* Fixing the mistake brings hints back. */
+    grid[cell] = pz.soln[cell];
+    kenken_hint_engine_set_cell(eng, cell, grid[cell]);
+    TEST_ASSERT(kenken_hint_engine_next(eng, &hint), "No hint after fixing the grid");
+    TEST_ASSERT(hint.value == pz.soln[hint.cell], "Hint disagrees with solution");
+
+    kenken_hint_engine_free(eng);
+    sfree(grid);
+    free_puzzle(&pz);
+    return 1;
+}
+
+/*
+ * Test 3: A recorded trace places every square with the solution's digit,
+ * and a fresh engine's first hint is the trace's first placement.
+ */
+static int test_trace_matches_solution(void) {
+    for (int diff = DIFF_EASY; diff <= DIFF_EXTREME; diff++) {
+        char seed[32];
+        test_puzzle pz;
+        snprintf(seed, sizeof(seed), "trace-%d", diff);
+        TEST_ASSERT(make_puzzle(6, diff, seed, &pz), "Puzzle generation failed");
+
+        int a = pz.w * pz.w, placed = 0, first = -1;
+        digit* soln = snewn(a, digit);
+        keen_trace trace = {nullptr, 0, 0};
+        memset(soln, 0, (size_t)a);
+
+        int ret = keen_solver_trace(pz.w, pz.dsf, pz.clues, soln, diff, 0, &trace);
+        digit* plain = snewn(a, digit);
+        memset(plain, 0, (size_t)a);
+        TEST_ASSERT(keen_solver(pz.w, pz.dsf, pz.clues, plain, diff, 0) == ret,
+                    "Traced and plain solves disagree");
+        TEST_ASSERT(!memcmp(plain, soln, (size_t)a), "Traced and plain solutions differ");
+        sfree(plain);
+
+        for (int i = 0; i < trace.nsteps; i++) {
+            const keen_trace_step* st = &trace.steps[i];
+            TEST_ASSERT(st->cell >= 0 && st->cell < a, "Trace step outside the grid");
+            if (st->value) {
+                TEST_ASSERT(st->value == pz.soln[st->cell], "Trace placed a wrong digit");
+                if (first < 0) first = i;
+                placed++;
+            } else {
+                TEST_ASSERT(st->elim != 0, "Elimination step removed nothing");
+                TEST_ASSERT(!(st->elim & (1U << pz.soln[st->cell])),
+                            "Trace eliminated the solution digit");
+            }
+        }
+        TEST_ASSERT(placed == a, "Trace does not cover the grid");
+
+        hint_engine* eng = kenken_hint_engine_new(pz.w, pz.dsf, pz.clues, 0, nullptr);
+        hint_result hint;
+        TEST_ASSERT(kenken_hint_engine_next(eng, &hint), "No hint on an empty grid");
+        TEST_ASSERT(hint.cell == trace.steps[first].cell, "First hint is not the first placement");
+
+        kenken_hint_engine_free(eng);
+        keen_trace_free(&trace);
+        sfree(soln);
+        free_puzzle(&pz);
+    }
+    return 1;
+}
+
+/*
+ * Test 4: The stateless entry point still reports the easiest hint.
+ */
+static int test_stateless_hint(void) {
+    test_puzzle pz;
+    TEST_ASSERT(make_puzzle(5, DIFF_EASY, "hints-stateless", &pz), "Puzzle generation failed");
+
+    int a = pz.w * pz.w;
+    digit* grid = snewn(a, digit);
+    for (int i = 0; i < a; i++) grid[i] = i % 3 ? pz.soln[i] : 0;
+
+    hint_ctx ctx = {pz.w, grid, pz.dsf, pz.clues, 0, pz.soln};
+    hint_result hint;
+    TEST_ASSERT(kenken_get_hint(&ctx, &hint), "No hint for a two-thirds full grid");
+    TEST_ASSERT(grid[hint.cell] == 0, "Hint for a filled cell");
+    TEST_ASSERT(hint.value == pz.soln[hint.cell], "Hint disagrees with solution");
+
+    sfree(grid);
+    free_puzzle(&pz);
+    return 1;
+}
+
+/*
+ * Test 5: The batch API returns one correct hint per cell, sorted by rank,
+ * and agrees with the single-hint entry point on the cheapest one.
+ */
+static int test_all_hints(void) {
+    int forced = 0;
+
+    for (int diff = DIFF_EASY; diff <= DIFF_HARD; diff++) {
+        char seed[32];
+        test_puzzle pz;
+        snprintf(seed, sizeof(seed), "all-hints-%d", diff);
+        TEST_ASSERT(make_puzzle(6, diff, seed, &pz), "Puzzle generation failed");
+
+        int a = pz.w * pz.w;
+        digit* grid = snewn(a, digit);
+        hint_result* all = snewn(a, hint_result);
+        memset(grid, 0, (size_t)a);
+
+        for (int round = 0; round < 3; round++) {
+            hint_ctx ctx = {pz.w, grid, pz.dsf, pz.clues, 0, nullptr};
+            hint_result first;
+            int n = kenken_get_all_hints(&ctx, all, a);
+            int seen[64] = {0};
+
+            for (int i = 0; i < n; i++) {
+                TEST_ASSERT(grid[all[i].cell] == 0, "Hint for a filled cell");
+                TEST_ASSERT(all[i].value == pz.soln[all[i].cell], "Hint disagrees with solution");
+                TEST_ASSERT(!seen[all[i].cell]++, "Two hints for one cell");
+                TEST_ASSERT(i == 0 || all[i - 1].rank <= all[i].rank, "Hints not sorted by rank");
+                if (all[i].hint_type == HINT_CAGE_FORCE) forced++;
+            }
+            if (kenken_get_hint(&ctx, &first)) {
+                TEST_ASSERT(n > 0 && all[0].rank <= first.rank, "Batch missed the cheapest hint");
+                TEST_ASSERT(kenken_get_all_hints(&ctx, all, 1) == 1, "Capacity not honoured");
+            }
+
+            /* Fill in a third of the solution and look again. */
+            for (int i = round; i < a; i += 3) grid[i] = pz.soln[i];
+        }
+
+        sfree(all);
+        sfree(grid);
+        free_puzzle(&pz);
+    }
+    TEST_ASSERT(forced > 0, "No cage-forced hints found");
+    return 1;
+}
+
+/* Reference scan: does val fit at (row, col) given the grid's rows and columns? */
+static int fits(const digit* grid, int w, int row, int col, int val) {
+    if (grid[row * w + col]) return 0;
+    for (int k = 0; k < w; k++)
+        if (grid[row * w + k] == val || grid[k * w + col] == val) return 0;
+    return 1;
+}
+
+/*
+ * Test 6: The bitboard hint search finds the same first hint as a plain
+ * row x value x column rescan, across partly filled grids.
+ */
+static int test_bitboard_matches_scan(void) {
+    test_puzzle pz;
+    TEST_ASSERT(make_puzzle(9, DIFF_NORMAL, "hints-bitboard", &pz), "Puzzle generation failed");
+
+    int w = pz.w, a = w * w;
+    digit* grid = snewn(a, digit);
+    unsigned long state = 12345;
+
+    for (int round = 0; round < 200; round++) {
+        hint_ctx ctx = {w, grid, pz.dsf, pz.clues, 0, nullptr};
+        hint_result hint;
+        int type = HINT_NONE, cell = -1, value = 0;
+
+        for (int i = 0; i < a; i++) {
+            state = state * 1103515245 + 12345;
+            grid[i] = (state >> 16) % 4 == 0 ? pz.soln[i] : 0;
+        }
+
+        for (int i = 0; i < a && type == HINT_NONE; i++)
+            if (!grid[i] && dsf_size(pz.dsf, i) == 1) type = HINT_CAGE_SINGLE, cell = i;
+        for (int i = 0; i < a && type == HINT_NONE; i++) {
+            int count = 0, last = 0;
+            for (int v = 1; v <= w; v++)
+                if (fits(grid, w, i / w, i % w, v)) count++, last = v;
+            if (count == 1) type = HINT_NAKED_SINGLE, cell = i, value = last;
+        }
+        for (int line = 0; line < 2 * w && type == HINT_NONE; line++)
+            for (int v = 1; v <= w && type == HINT_NONE; v++) {
+                int count = 0, last = -1;
+                for (int k = 0; k < w; k++) {
+                    int r = line < w ? line : k, c = line < w ? k : line - w;
+                    if (fits(grid, w, r, c, v)) count++, last = r * w + c;
+                }
+                if (count == 1) type = HINT_HIDDEN_SINGLE, cell = last, value = v;
+            }
+
+        TEST_ASSERT(kenken_get_hint(&ctx, &hint) == (type != HINT_NONE), "Hint presence differs");
+        TEST_ASSERT(hint.hint_type == type, "Hint type differs from the rescan");
+        if (type != HINT_NONE) {
+            TEST_ASSERT(hint.cell == cell, "Hint cell differs from the rescan");
+            if (type != HINT_CAGE_SINGLE)
+                TEST_ASSERT(hint.value == value, "Hint value differs from the rescan");
+        }
+    }
+
+    sfree(grid);
+    free_puzzle(&pz);
+    return 1;
+}
+
+/*
+ * Test 7: Explaining a single cell agrees with a plain rescan of its row
+ * and column, and with its cage size.
+ */
+static int test_explain_matches_scan(void) {
+    test_puzzle pz;
+    TEST_ASSERT(make_puzzle(9, DIFF_NORMAL, "hints-explain", &pz), "Puzzle generation failed");
+
+    int w = pz.w, a = w * w;
+    digit* grid = snewn(a, digit);
+    unsigned long state = 54321;
+
+    for (int round = 0; round < 50; round++) {
+        hint_ctx ctx = {w, grid, pz.dsf, pz.clues, 0, pz.soln};
+
+        for (int i = 0; i < a; i++) {
+            state = state * 1103515245 + 12345;
+            grid[i] = (state >> 16) % 3 == 0 ? pz.soln[i] : 0;
+        }
+
+        for (int cell = 0; cell < a; cell++) {
+            hint_result hint;
+            int type = HINT_NONE, value = 0, count = 0, last = 0;
+
+            if (!grid[cell]) {
+                for (int v = 1; v <= w; v++)
+                    if (fits(grid, w, cell / w, cell % w, v)) count++, last = v;
+                if (dsf_size(pz.dsf, cell) == 1)
+                    type = HINT_CAGE_SINGLE, value = (int)(pz.clues[cell] & 0x1FFFFFFFL);
+                else if (count == 1)
+                    type = HINT_NAKED_SINGLE, value = last;
+                else if (fits(grid, w, cell / w, cell % w, pz.soln[cell]))
+                    type = HINT_CAGE_FORCE, value = pz.soln[cell];
+            }
+
+            TEST_ASSERT(kenken_explain_cell(&ctx, cell, &hint) == (type != HINT_NONE),
+                        "Explanation presence differs");
+            if (type != HINT_NONE) {
+                TEST_ASSERT(hint.hint_type == type, "Explanation type differs from the rescan");
+                TEST_ASSERT(hint.value == value, "Explanation value differs from the rescan");
+            }
+        }
+    }
+
+    sfree(grid);
+    free_puzzle(&pz);
+    return 1;
+}
+
+int main(void) {
+    printf("Hint System Unit Tests\n");
+    printf("======================\n\n");
+
+    RUN_TEST(test_engine_solves_puzzles);
+    RUN_TEST(test_engine_tracks_edits);
+    RUN_TEST(test_trace_matches_solution);
+    RUN_TEST(test_stateless_hint);
+    RUN_TEST(test_all_hints);
+    RUN_TEST(test_bitboard_matches_scan);
+    RUN_TEST(test_explain_matches_scan);
+
+    printf("\n======================\n");
+    printf("Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,650 @@
+/*
+ * keen_solver_test.c: Unit tests for keen_solver.c
+ *
+ * Builds loosely clued puzzles over random latin squares, and generates
+ * Incomprehensible ones, so that the solver has to recurse, and checks
+ * its verdicts under every branching strategy.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keen.h"
+#include "keen_internal.h"
+#include "keen_solver.h"
+#include "puzzles.h"
+#include "test_puzzle.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST_ASSERT(cond, msg)                                      \
+    do {                                                            \
+        tests_run++;                                                \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL: %s (line %d): %s\n",             \
+                    __func__, __LINE__, msg);                       \
+            return 0;                                               \
+        }                                                           \
+        tests_passed++;                                             \
+    } while (0)
+
+#define RUN_TEST(fn)                                                \
+    do {                                                            \
+        printf("Running %s... ", #fn);                              \
+        if (fn()) {                                                 \
+            printf("PASS\n");                                       \
+        } else {                                                    \
+            printf("FAIL\n");                                       \
+        }                                                           \
+    } while (0)
+
+static const int strategies[] = {
+    KEEN_BRANCH_MRV,
+    KEEN_BRANCH_MRV_CAGE,
+    KEEN_BRANCH_CAGE,
+    KEEN_BRANCH_MRV | KEEN_BRANCH_VALUE_ORDER,
+    KEEN_BRANCH_MRV_CAGE | KEEN_BRANCH_VALUE_ORDER,
+};
+#define NSTRATEGIES ((int)(sizeof(strategies) / sizeof(strategies[0])))
+
+/*
+ * Cage a latin square into horizontal dominoes (plus single squares at
+ * odd-width row ends) clued with op, or with ADD where op doesn't fit.
+ * Rows in the given_rows bitmask are given outright as single squares.
+ */
+static void domino_puzzle(int w, const digit* sq, clue_t op, unsigned given_rows, int* dsf,
+                          clue_t* clues) {
+    int a = w * w;
+
+    dsf_init(dsf, a);
+    memset(clues, 0, (size_t)a * sizeof(clue_t));
+    for (int i = 0; i < a; i++) {
+        if (given_rows & (1U << (i / w))) {
+            clues[i] = C_ADD | sq[i];
+            continue;
+        }
+        if (i % w % 2 || i % w == w - 1) {
+            if (i % w % 2 == 0) clues[i] = C_ADD | sq[i];
+            continue;
+        }
+        dsf_merge(dsf, i, i + 1);
+        int lo = min(sq[i], sq[i + 1]), hi = max(sq[i], sq[i + 1]);
+        switch (op) {
+            case C_MUL: clues[i] = C_MUL | (clue_t)(lo * hi); break;
+            case C_SUB: clues[i] = C_SUB | (clue_t)(hi - lo); break;
+            case C_DIV:
+                clues[i] = hi % lo ? (C_ADD | (clue_t)(lo + hi)) : (C_DIV | (clue_t)(hi / lo));
+                break;
+            default: clues[i] = C_ADD | (clue_t)(lo + hi); break;
+        }
+    }
+}
+
+/*
+ * Test 1: Every strategy reaches the same verdict on puzzles that need
+ * recursion, and a unique solution is the latin square the clues came
+ * from.
+ */
+static int test_strategies_agree(void) {
+    static const clue_t ops[] = {C_ADD, C_MUL, C_SUB, C_DIV};
+    random_state* rs = random_new("branching", 9);
+    int unique = 0, ambiguous = 0, recursed = 0;
+
+    for (int round = 0; round < 48; round++) {
+        int w = 5 + round % 4, a = w * w;
+        digit* sq = latin_generate(w, rs);
+        int* dsf = snew_dsf(a);
+        clue_t* clues = snewn(a, clue_t);
+        digit* soln = snewn(a, digit);
+        int verdict = -1;
+
+        domino_puzzle(w, sq, ops[round / 4 % 4], 0x11U << (round % 3), dsf, clues);
+        for (int s = 0; s < NSTRATEGIES; s++) {
+            memset(soln, 0, (size_t)a);
+            int ret = keen_solver_branching(w, dsf, clues, soln, DIFF_INCOMPREHENSIBLE, 0,
+                                            strategies[s]);
+            TEST_ASSERT(ret != diff_impossible && ret != diff_unfinished,
+                        "Solvable puzzle reported impossible");
+            if (verdict < 0) verdict = ret;
+            TEST_ASSERT(ret == verdict, "Strategies disagree on uniqueness");
+            if (ret != diff_ambiguous)
+                TEST_ASSERT(!memcmp(soln, sq, (size_t)a), "Unique solution differs");
+        }
+        if (verdict == diff_ambiguous)
+            ambiguous++;
+        else
+            unique++;
+
+        sfree(soln);
+        sfree(clues);
+        sfree(dsf);
+        sfree(sq);
+    }
+    random_free(rs);
+
+    /* Generated Incomprehensible puzzles: unique, but only by guessing */
+    for (int w = 5; w <= 7; w++)
+        for (int k = 0; k < 3; k++) {
+            char seed[32];
+            test_puzzle pz;
+            snprintf(seed, sizeof(seed), "branch-%d-%d", w, k);
+            TEST_ASSERT(make_puzzle(w, DIFF_INCOMPREHENSIBLE, seed, &pz),
+                        "Puzzle generation failed");
+
+            int a = w * w;
+            digit* soln = snewn(a, digit);
+            memset(soln, 0, (size_t)a);
+            if (keen_solver(w, pz.dsf, pz.clues, soln, DIFF_LUDICROUS, 0) == diff_unfinished)
+                recursed++;
+            for (int s = 0; s < NSTRATEGIES; s++) {
+                memset(soln, 0, (size_t)a);
+                TEST_ASSERT(keen_solver_branching(w, pz.dsf, pz.clues, soln,
+                                                  DIFF_INCOMPREHENSIBLE, 0,
+                                                  strategies[s]) == DIFF_INCOMPREHENSIBLE,
+                            "Generated puzzle not uniquely solved");
+                TEST_ASSERT(!memcmp(soln, pz.soln, (size_t)a), "Wrong solution");
+            }
+            sfree(soln);
+            free_puzzle(&pz);
+        }
+
+    /* The corpus should exercise both outcomes, and real guessing */
+    TEST_ASSERT(unique > 0 && recursed > 0 && ambiguous > 0,
+                "Corpus lacks unique, recursive or ambiguous puzzles");
+    return 1;
+}
+
+/*
+ * Test 2: Contradictory clues are impossible under every strategy.
+ */
+static int test_impossible(void) {
+    int w = 6, a = w * w;
+    random_state* rs = random_new("impossible", 10);
+    digit* sq = latin_generate(w, rs);
+    int* dsf = snew_dsf(a);
+    clue_t* clues = snewn(a, clue_t);
+    digit soln[36];
+
+    /* Sums whose dominoes can only be filled by clashing digits */
+    domino_puzzle(w, sq, C_ADD, 0, dsf, clues);
+    clues[0] = C_ADD | 3; /* {1,2} */
+    clues[2] = C_ADD | 3; /* {1,2} again in the same row */
+    clues[4] = C_ADD | 3;
+    for (int s = 0; s < NSTRATEGIES; s++) {
+        memset(soln, 0, sizeof(soln));
+        TEST_ASSERT(keen_solver_branching(w, dsf, clues, soln, DIFF_INCOMPREHENSIBLE, 0,
+                                          strategies[s]) == diff_impossible,
+                    "Contradiction not found");
+    }
+
+    sfree(clues);
+    sfree(dsf);
+    sfree(sq);
+    random_free(rs);
+    return 1;
+}
+
+/*
+ * Test 3: A grader reused across puzzles and strategies matches one-off
+ * keen_solver calls.
+ */
+static int test_grader_matches_solver(void) {
+    random_state* rs = random_new("grader", 6);
+    keen_grader* g = keen_grader_new();
+
+    for (int round = 0; round < 24; round++) {
+        int w = 4 + round % 5, a = w * w;
+        digit* sq = latin_generate(w, rs);
+        int* dsf = snew_dsf(a);
+        clue_t* clues = snewn(a, clue_t);
+        digit* soln = snewn(a, digit);
+        digit* gsoln = snewn(a, digit);
+
+        domino_puzzle(w, sq, round % 2 ? C_MUL : C_ADD, 1U << (round % 3), dsf, clues);
+        keen_grader_set_branching(g, strategies[round % NSTRATEGIES]);
+        keen_grader_load(g, w, dsf, clues, 0);
+        for (int diff = DIFF_EASY; diff <= DIFF_INCOMPREHENSIBLE; diff += 2) {
+            memset(soln, 0, (size_t)a);
+            int ret = keen_solver(w, dsf, clues, soln, diff, 0);
+            TEST_ASSERT(keen_grader_solve(g, gsoln, diff) == ret, "Grader verdict differs");
+            if (ret < diff_impossible)
+                TEST_ASSERT(!memcmp(soln, gsoln, (size_t)a), "Grader solution differs");
+        }
+
+        sfree(gsoln);
+        sfree(soln);
+        sfree(clues);
+        sfree(dsf);
+        sfree(sq);
+    }
+    keen_grader_free(g);
+    random_free(rs);
+    return 1;
+}
+
+/*
+ * Test 4: Caching impossible states never changes a verdict or solution,
+ * and the search counters see the recursion either way.
+ */
+static int test_nogoods_agree(void) {
+    random_state* rs = random_new("nogoods", 7);
+    keen_grader* plain = keen_grader_new();
+    keen_grader* cached = keen_grader_new();
+
+    keen_grader_set_nogoods(cached, true);
+    for (int round = 0; round < 32; round++) {
+        int w = 5 + round % 4, a = w * w;
+        digit* sq = latin_generate(w, rs);
+        int* dsf = snew_dsf(a);
+        clue_t* clues = snewn(a, clue_t);
+        digit* soln = snewn(a, digit);
+        digit* csoln = snewn(a, digit);
+
+        domino_puzzle(w, sq, round % 3 ? C_MUL : C_SUB, 0x21U << (round % 2), dsf, clues);
+        if (round % 4 == 3) clues[0] = C_ADD | 3, clues[2] = C_ADD | 3;
+        keen_grader_load(plain, w, dsf, clues, 0);
+        keen_grader_load(cached, w, dsf, clues, 0);
+        int ret = keen_grader_solve(plain, soln, DIFF_INCOMPREHENSIBLE);
+        TEST_ASSERT(keen_grader_solve(cached, csoln, DIFF_INCOMPREHENSIBLE) == ret,
+                    "Nogood cache changed the verdict");
+        if (ret < diff_impossible)
+            TEST_ASSERT(!memcmp(soln, csoln, (size_t)a), "Nogood cache changed the solution");
+
+        sfree(csoln);
+        sfree(soln);
+        sfree(clues);
+        sfree(dsf);
+        sfree(sq);
+    }
+
+    const struct latin_search_stats* ps = keen_grader_stats(plain);
+    const struct latin_search_stats* cs = keen_grader_stats(cached);
+    TEST_ASSERT(ps->nodes > 0 && ps->nogood_stores == 0, "Plain search counters wrong");
+    TEST_ASSERT(cs->nodes <= ps->nodes,
+                "Nogood cache added search nodes");
+
+    keen_grader_free(cached);
+    keen_grader_free(plain);
+    random_free(rs);
+    return 1;
+}
+
+/* Grade one puzzle with and without batching at every level; 1 if they agree. */
+static int batching_agrees(keen_grader* batched, keen_grader* ladder, int w, int* dsf,
+                           clue_t* clues) {
+    int a = w * w, same = 1;
+    digit* bsoln = snewn(a, digit);
+    digit* lsoln = snewn(a, digit);
+
+    keen_grader_load(batched, w, dsf, clues, 0);
+    keen_grader_load(ladder, w, dsf, clues, 0);
+    for (int diff = DIFF_EASY; diff <= DIFF_INCOMPREHENSIBLE && same; diff++) {
+        int ret = keen_grader_solve(ladder, lsoln, diff);
+        same = keen_grader_solve(batched, bsoln, diff) == ret &&
+               (ret == diff_impossible || !memcmp(bsoln, lsoln, (size_t)a));
+    }
+
+    sfree(lsoln);
+    sfree(bsoln);
+    return same;
+}
+
+/*
+ * Test 5: Batched propagation classifies a corpus of generated puzzles
+ * at every level (and looser recursive ones) exactly as the one-step
+ * ladder does, leaving the same grid behind.
+ */
+static int test_batching_agrees(void) {
+    keen_grader* batched = keen_grader_new();
+    keen_grader* ladder = keen_grader_new();
+    random_state* rs = random_new("batching", 8);
+    int graded = 0;
+
+    keen_grader_set_batching(batched, true);
+    for (int diff = DIFF_EASY; diff <= DIFF_EXTREME; diff++)
+        for (int w = 4; w <= (diff < DIFF_EXTREME ? 9 : 6); w++)
+            for (int k = 0; k < 2; k++) {
+                char seed[32];
+                test_puzzle pz;
+                snprintf(seed, sizeof(seed), "batch-%d-%d-%d", diff, w, k);
+                TEST_ASSERT(make_puzzle(w, diff, seed, &pz), "Puzzle generation failed");
+                TEST_ASSERT(batching_agrees(batched, ladder, w, pz.dsf, pz.clues),
+                            "Batching changed a generated puzzle's grading");
+                free_puzzle(&pz);
+                graded++;
+            }
+
+    for (int round = 0; round < 16; round++) {
+        int w = 5 + round % 4, a = w * w;
+        digit* sq = latin_generate(w, rs);
+        int* dsf = snew_dsf(a);
+        clue_t* clues = snewn(a, clue_t);
+
+        domino_puzzle(w, sq, round % 2 ? C_MUL : C_SUB, 0x5U << (round % 3), dsf, clues);
+        TEST_ASSERT(batching_agrees(batched, ladder, w, dsf, clues),
+                    "Batching changed a recursive puzzle's grading");
+        graded++;
+
+        sfree(clues);
+        sfree(dsf);
+        sfree(sq);
+    }
+
+    random_free(rs);
+    keen_grader_free(ladder);
+    keen_grader_free(batched);
+    TEST_ASSERT(graded == 3 * 6 * 2 + 3 * 2 + 16, "Corpus incomplete");
+    return 1;
+}
+
+/*
+ * Run one NORMAL cage pass over a w x w grid whose top-left 2x2 block is
+ * a single cage clued clue (every other square clued 1, so no other cage
+ * touches it), with the block's first three squares placed as in fix
+ * (0 = left open), and compare the block's candidates against the
+ * digits that appear in some brute-forced layout. 1 if they agree.
+ */
+static int block_candidates_agree(int w, clue_t clue, int mode_flags, const digit* fix) {
+    static const int off[4] = {0, 1, 0, 1}, row[4] = {0, 0, 1, 1};
+    int a = w * w, same = 1;
+    int* dsf = snew_dsf(a);
+    clue_t* clues = snewn(a, clue_t);
+    unsigned long value = (unsigned long)(clue & ~CMASK);
+    unsigned want[4] = {0, 0, 0, 0};
+
+    for (int i = 0; i < a; i++) clues[i] = C_ADD | 1;
+    dsf_merge(dsf, 0, 1);
+    dsf_merge(dsf, 0, w);
+    dsf_merge(dsf, 0, w + 1);
+    clues[dsf_canonify(dsf, 0)] = clue;
+
+    /* Squares 0,1 share a row, as do 2,3; 0,2 and 1,3 share a column */
+    for (int d0 = 1; d0 <= w; d0++)
+        for (int d1 = 1; d1 <= w; d1++)
+            for (int d2 = 1; d2 <= w; d2++)
+                for (int d3 = 1; d3 <= w; d3++) {
+                    int d[4] = {d0, d1, d2, d3};
+                    unsigned long r = (unsigned long)d0;
+                    if (d0 == d1 || d2 == d3 || d0 == d2 || d1 == d3) continue;
+                    if (mode_flags & MODE_KILLER && (d0 == d3 || d1 == d2)) continue;
+                    if ((fix[0] && d0 != fix[0]) || (fix[1] && d1 != fix[1]) ||
+                        (fix[2] && d2 != fix[2]))
+                        continue;
+                    for (int k = 1; k < 4; k++) {
+                        unsigned long x = r, y = (unsigned long)d[k];
+                        if ((clue & CMASK) == C_XOR || (clue & CMASK) == C_ADD ||
+                            (clue & CMASK) == C_MUL) {
+                            r = (clue & CMASK) == C_XOR   ? r ^ y
+                                : (clue & CMASK) == C_ADD ? r + y
+                                                          : r * y;
+                            continue;
+                        }
+                        while (y) {
+                            unsigned long t = x % y;
+                            x = y;
+                            y = t;
+                        }
+                        r = (clue & CMASK) == C_GCD ? x : r / x * (unsigned long)d[k];
+                    }
+                    if (mode_flags & MODE_MODULAR ? r % (unsigned long)w != value : r != value)
+                        continue;
+                    for (int k = 0; k < 4; k++) want[k] |= 1U << d[k];
+                }
+
+    keen_session* s = keen_session_new(w, dsf, clues, mode_flags);
+    for (int k = 0; k < 3; k++)
+        if (fix[k]) keen_session_place(s, row[k] * w + off[k], fix[k]);
+    keen_session_cage_pass(s, DIFF_NORMAL);
+    for (int k = 0; k < 4; k++)
+        same &= keen_session_candidates(s, row[k] * w + off[k]) == want[k];
+
+    keen_session_free(s);
+    sfree(clues);
+    sfree(dsf);
+    return same;
+}
+
+/* block_candidates_agree with the block open, then with random squares placed. */
+static int block_agrees(random_state* rs, int w, clue_t clue, int mode_flags) {
+    digit fix[3] = {0, 0, 0};
+    if (!block_candidates_agree(w, clue, mode_flags, fix)) return 0;
+    for (int trial = 0; trial < 6; trial++) {
+        /* Squares 1 and 2 each share a line with square 0 only */
+        fix[0] = (digit)(1 + random_upto(rs, (unsigned long)w));
+        do fix[1] = (digit)(1 + random_upto(rs, (unsigned long)w));
+        while (fix[1] == fix[0]);
+        do fix[2] = (digit)(trial % 2 ? 0 : 1 + random_upto(rs, (unsigned long)w));
+        while (fix[2] == fix[0]);
+        if (!block_candidates_agree(w, clue, mode_flags, fix)) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Test 6: GCD and LCM cages keep exactly the digits of their valid
+ * layouts, for every reachable clue and some unreachable ones, plain
+ * and modular (where a residue of 0 must not divide by zero), and an
+ * LCM clue with a prime factor no digit has makes a puzzle unsolvable.
+ */
+static int test_gcd_lcm_layouts(void) {
+    static const int widths[] = {4, 6, 9, 12};
+    random_state* rs = random_new("gcdlcm", 6);
+    int checked = 0;
+
+    for (int wi = 0; wi < 4; wi++) {
+        int w = widths[wi];
+        for (unsigned long g = 1; g <= (unsigned long)w + 1; g++) {
+            TEST_ASSERT(block_agrees(rs, w, C_GCD | g, 0), "GCD candidates differ");
+            checked++;
+        }
+        /* Every LCM of four digits up to 12 divides 27720; up to 128
+         * also covers primes (37, 41, ...) no digit can supply */
+        for (unsigned long L = 1; L <= 27720; L++) {
+            if (27720 % L && L > 128) continue;
+            TEST_ASSERT(block_agrees(rs, w, C_LCM | L, 0), "LCM candidates differ");
+            checked++;
+        }
+        for (unsigned long v = 0; v < (unsigned long)w; v++) {
+            TEST_ASSERT(block_agrees(rs, w, C_GCD | v, MODE_MODULAR),
+                        "Modular GCD candidates differ");
+            TEST_ASSERT(block_agrees(rs, w, C_LCM | v, MODE_MODULAR),
+                        "Modular LCM candidates differ");
+            checked += 2;
+        }
+    }
+
+    random_free(rs);
+    TEST_ASSERT(checked > 4 * 64, "Too few clues checked");
+
+    /* An LCM of 74 = 2 * 37 has no layout, so the puzzle has no solution */
+    {
+        int w = 9, a = w * w;
+        random_state* lrs = random_new("lcm-prime", 9);
+        digit* sq = latin_generate(w, lrs);
+        int* dsf = snew_dsf(a);
+        clue_t* clues = snewn(a, clue_t);
+        digit* soln = snewn(a, digit);
+
+        domino_puzzle(w, sq, C_ADD, 0, dsf, clues);
+        clues[0] = C_LCM | 74;
+        memset(soln, 0, (size_t)a);
+        int ret = keen_solver(w, dsf, clues, soln, DIFF_INCOMPREHENSIBLE, 0);
+
+        sfree(soln);
+        sfree(clues);
+        sfree(dsf);
+        sfree(sq);
+        random_free(lrs);
+        TEST_ASSERT(ret == diff_impossible, "LCM with a large prime factor solved");
+    }
+    return 1;
+}
+
+/*
+ * Test 7: XOR cages keep exactly the digits of their valid layouts, for
+ * every clue up to 31 (beyond what four digits reach at small w), plain
+ * and modular.
+ */
+static int test_xor_layouts(void) {
+    static const int widths[] = {4, 5, 9, 12, 16};
+    random_state* rs = random_new("xor", 3);
+
+    for (int wi = 0; wi < 5; wi++) {
+        int w = widths[wi];
+        for (unsigned long v = 0; v < 32; v++)
+            TEST_ASSERT(block_agrees(rs, w, C_XOR | v, MODE_BITWISE), "XOR candidates differ");
+        for (unsigned long v = 0; v < (unsigned long)w; v++)
+            TEST_ASSERT(block_agrees(rs, w, C_XOR | v, MODE_BITWISE | MODE_MODULAR),
+                        "Modular XOR candidates differ");
+    }
+
+    random_free(rs);
+    return 1;
+}
+
+/*
+ * Test 8: Modular ADD and MUL cages keep exactly the digits of their
+ * valid layouts for every residue, including ones (like odd products
+ * mod an even width) that no layout reaches.
+ */
+static int test_modular_arith_layouts(void) {
+    static const int widths[] = {4, 5, 7, 9, 12, 16};
+    random_state* rs = random_new("modular", 7);
+
+    for (int wi = 0; wi < 6; wi++) {
+        int w = widths[wi];
+        for (unsigned long v = 0; v < (unsigned long)w; v++) {
+            TEST_ASSERT(block_agrees(rs, w, C_ADD | v, MODE_MODULAR),
+                        "Modular ADD candidates differ");
+            TEST_ASSERT(block_agrees(rs, w, C_MUL | v, MODE_MODULAR),
+                        "Modular MUL candidates differ");
+        }
+    }
+
+    random_free(rs);
+    return 1;
+}
+
+/*
+ * Test 9: Killer ADD and MUL cages keep exactly the digits of their
+ * valid distinct-digit layouts, for every sum and for every product of
+ * up to four digits, and generated HARD Killer puzzles still grade as
+ * HARD with their own solution.
+ */
+static int test_killer_layouts(void) {
+    static const int widths[] = {4, 6, 9, 12};
+    random_state* rs = random_new("killer", 6);
+
+    for (int wi = 0; wi < 4; wi++) {
+        int w = widths[wi];
+        for (unsigned long v = 1; v <= 4 * (unsigned long)w + 1; v++)
+            TEST_ASSERT(block_agrees(rs, w, C_ADD | v, MODE_KILLER), "Killer ADD candidates differ");
+        for (unsigned long v = 1; v <= (unsigned long)w * w * w * w; v++) {
+            /* Only products of digits up to w (or just past them) */
+            unsigned long m = v;
+            for (unsigned long d = (unsigned long)w; d > 1; d--)
+                while (m % d == 0) m /= d;
+            if (m > 1) continue;
+            TEST_ASSERT(block_agrees(rs, w, C_MUL | v, MODE_KILLER), "Killer MUL candidates differ");
+        }
+    }
+
+    for (int w = 4; w <= 7; w++) {
+        char seed[32];
+        test_puzzle pz;
+        snprintf(seed, sizeof(seed), "killer-%d", w);
+        TEST_ASSERT(make_puzzle_mode(w, DIFF_HARD, MODE_KILLER, seed, &pz),
+                    "Killer puzzle generation failed");
+        digit* soln = snewn(w * w, digit);
+        memset(soln, 0, (size_t)(w * w));
+        int ret = keen_solver(w, pz.dsf, pz.clues, soln, DIFF_HARD, MODE_KILLER);
+        int same = !memcmp(soln, pz.soln, (size_t)(w * w));
+        sfree(soln);
+        free_puzzle(&pz);
+        TEST_ASSERT(ret == DIFF_HARD && same, "Killer puzzle graded differently");
+    }
+
+    random_free(rs);
+    return 1;
+}
+
+/*
+ * Test 10: The bitmask forcing-chain search and the cube scan it
+ * replaced make the same elimination (or none) on random partial cubes,
+ * thinned to leave plenty of bivalue squares, at every order up to 16.
+ */
+static int test_forcing_agrees(void) {
+    random_state* rs = random_new("forcing", 7);
+    int found = 0;
+
+    for (int o = 3; o <= 16; o++) {
+        digit* sq = latin_generate(o, rs);
+        digit* grid = snewn(o * o, digit);
+        struct latin_solver solver_s, *solver = &solver_s;
+        size_t cubesize = (size_t)o * o * o;
+
+        memset(grid, 0, (size_t)(o * o));
+        latin_solver_alloc(solver, grid, o);
+        struct latin_solver_scratch* scratch = latin_solver_new_scratch(solver);
+        unsigned char* start = snewn(cubesize, unsigned char);
+
+        for (int trial = 0; trial < 300; trial++) {
+            /* Keep the true digit and, mostly, one or two others */
+            for (int x = 0; x < o; x++)
+                for (int y = 0; y < o; y++) {
+                    int extra = (int)random_upto(rs, 4) == 0 ? (int)random_upto(rs, o) : 1;
+                    for (int n = 1; n <= o; n++) cube(x, y, n) = n == sq[y * o + x];
+                    while (extra-- > 0) cube(x, y, 1 + (int)random_upto(rs, o)) = true;
+                }
+            memcpy(start, solver->cube, cubesize);
+
+            int scan = latin_solver_forcing_scan(solver, scratch);
+            unsigned char* after_scan = snewn(cubesize, unsigned char);
+            memcpy(after_scan, solver->cube, cubesize);
+            memcpy(solver->cube, start, cubesize);
+            int masks = latin_solver_forcing(solver, scratch);
+            int same = !memcmp(after_scan, solver->cube, cubesize);
+            sfree(after_scan);
+
+            TEST_ASSERT(scan == masks, "Forcing chain verdicts differ");
+            TEST_ASSERT(same, "Forcing chains eliminated different candidates");
+            found += scan;
+        }
+
+        sfree(start);
+        latin_solver_free_scratch(scratch);
+        latin_solver_free(solver);
+        sfree(grid);
+        sfree(sq);
+    }
+    TEST_ASSERT(found > 0, "No forcing chains found");
+
+    random_free(rs);
+    return 1;
+}
+
+int main(void) {
+    printf("Solver Unit Tests\n");
+    printf("=================\n\n");
+
+    RUN_TEST(test_strategies_agree);
+    RUN_TEST(test_impossible);
+    RUN_TEST(test_grader_matches_solver);
+    RUN_TEST(test_nogoods_agree);
+    RUN_TEST(test_batching_agrees);
+    RUN_TEST(test_gcd_lcm_layouts);
+    RUN_TEST(test_xor_layouts);
+    RUN_TEST(test_modular_arith_layouts);
+    RUN_TEST(test_killer_layouts);
+    RUN_TEST(test_forcing_agrees);
+
+    printf("\n=================\n");
+    printf("Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
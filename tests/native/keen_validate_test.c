@@ -0,0 +1,276 @@
+/*
+ * keen_validate_test.c: Unit tests for keen_validate.c
+ *
+ * Checks the row/column/cage error flags on hand-built grids and that
+ * grids taken from a generated puzzle's solution are never flagged.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keen.h"
+#include "keen_internal.h"
+#include "keen_validate.h"
+#include "puzzles.h"
+#include "test_puzzle.h"
+
+/* Test result tracking */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST_ASSERT(cond, msg)                                      \
+    do {                                                            \
+        tests_run++;                                                \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL: %s (line %d): %s\n",             \
+                    __func__, __LINE__, msg);                       \
+            return 0;                                               \
+        }                                                           \
+        tests_passed++;                                             \
+    } while (0)
+
+#define RUN_TEST(fn)                                                \
+    do {                                                            \
+        printf("Running %s... ", #fn);                              \
+        if (fn()) {                                                 \
+            printf("PASS\n");                                       \
+        } else {                                                    \
+            printf("FAIL\n");                                       \
+        }                                                           \
+    } while (0)
+
+/*
+ * A 4x4 puzzle whose first row is one cage with the given clue and whose
+ * other squares are single-cell cages.
+ */
+static void row_cage_puzzle(int ncells, clue_t clue, int* dsf, clue_t* clues) {
+    dsf_init(dsf, 16);
+    memset(clues, 0, 16 * sizeof(clue_t));
+    for (int i = 1; i < ncells; i++) dsf_merge(dsf, 0, i);
+    for (int i = 0; i < 16; i++)
+        if (dsf_canonify(dsf, i) == i) clues[i] = C_ADD | 1;
+    clues[0] = clue;
+}
+
+static int first_row_flags(int ncells, clue_t clue, const digit* row, int mode_flags) {
+    int dsf[16], errors[16];
+    clue_t clues[16];
+    digit grid[16] = {0};
+    validate_ctx ctx = {4, grid, dsf, clues, mode_flags};
+    int flags = 0;
+
+    row_cage_puzzle(ncells, clue, dsf, clues);
+    memcpy(grid, row, 4);
+    kenken_validate_grid(&ctx, errors);
+    for (int i = 0; i < 4; i++) flags |= errors[i];
+
+    /* The single-cell check must agree with the full-grid one. */
+    for (int i = 0; i < 4; i++)
+        if ((kenken_validate_cell(&ctx, i) & VALID_ERR_CAGE_INFEASIBLE) !=
+            (errors[i] & VALID_ERR_CAGE_INFEASIBLE))
+            return -1;
+    return flags;
+}
+
+/*
+ * Test 1: Duplicates and wrong full cages are flagged as before.
+ */
+static int test_row_col_cage_errors(void) {
+    TEST_ASSERT(first_row_flags(2, C_ADD | 3, (digit[]){1, 1, 0, 0}, 0) & VALID_ERR_ROW,
+                "Row duplicate not flagged");
+    TEST_ASSERT(first_row_flags(2, C_ADD | 5, (digit[]){1, 3, 0, 0}, 0) & VALID_ERR_CAGE,
+                "Wrong full cage not flagged");
+    TEST_ASSERT(first_row_flags(2, C_ADD | 4, (digit[]){1, 3, 0, 0}, 0) == VALID_OK,
+                "Correct full cage flagged");
+    return 1;
+}
+
+/*
+ * Test 2: Partly filled cages that cannot reach their clue are flagged
+ * as infeasible; reachable ones are not.
+ */
+static int test_partial_cage_feasibility(void) {
+    /* One cell left: 3 + x = 3 needs x = 0 */
+    TEST_ASSERT(first_row_flags(2, C_ADD | 3, (digit[]){3, 0, 0, 0}, 0) ==
+                    VALID_ERR_CAGE_INFEASIBLE, "Unreachable sum not flagged");
+    TEST_ASSERT(first_row_flags(2, C_ADD | 3, (digit[]){2, 0, 0, 0}, 0) == VALID_OK,
+                "Reachable sum flagged");
+
+    /* Two cells left: 3 + x + y >= 3 + 1 + 1 > 4 */
+    TEST_ASSERT(first_row_flags(3, C_ADD | 4, (digit[]){3, 0, 0, 0}, 0) ==
+                    VALID_ERR_CAGE_INFEASIBLE, "Sum below the minimum not flagged");
+    TEST_ASSERT(first_row_flags(3, C_ADD | 10, (digit[]){1, 0, 0, 0}, 0) ==
+                    VALID_ERR_CAGE_INFEASIBLE, "Sum above the maximum not flagged");
+    TEST_ASSERT(first_row_flags(3, C_ADD | 8, (digit[]){1, 0, 0, 0}, 0) == VALID_OK,
+                "Reachable three-cell sum flagged");
+
+    /* Products: 3 does not divide 8; 1 * x * y <= 4 * 3 < 24 */
+    TEST_ASSERT(first_row_flags(3, C_MUL | 8, (digit[]){3, 0, 0, 0}, 0) ==
+                    VALID_ERR_CAGE_INFEASIBLE, "Non-divisor product not flagged");
+    TEST_ASSERT(first_row_flags(4, C_MUL | 24, (digit[]){0, 4, 0, 0}, 0) == VALID_OK,
+                "Reachable product flagged");
+
+    /* Two-cell ops are decided once one digit is in: |4 - x| = 3 needs x = 1 or 7 */
+    TEST_ASSERT(first_row_flags(2, C_SUB | 3, (digit[]){4, 0, 0, 0}, 0) == VALID_OK,
+                "Reachable difference flagged");
+    TEST_ASSERT(first_row_flags(2, C_SUB | 3, (digit[]){2, 0, 0, 0}, 0) ==
+                    VALID_ERR_CAGE_INFEASIBLE, "Unreachable difference not flagged");
+
+    /* Nothing entered yet: nothing to blame */
+    TEST_ASSERT(first_row_flags(4, C_ADD | 10, (digit[]){0, 0, 0, 0}, 0) == VALID_OK,
+                "Empty cage flagged");
+    return 1;
+}
+
+/*
+ * Test 3: Any partial fill of a generated puzzle's solution is free of
+ * errors, so the feasibility check never flags a cage that can still be
+ * completed.
+ */
+static int test_solution_subsets_valid(void) {
+    static const int modes[] = {0, MODE_KILLER, MODE_BITWISE, MODE_NUMBER_THEORY};
+    unsigned long state = 4242;
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+        for (int w = 4; w <= 8; w++) {
+            char seed[32];
+            test_puzzle pz;
+            snprintf(seed, sizeof(seed), "validate-%zu-%d", m, w);
+            TEST_ASSERT(make_puzzle_mode(w, DIFF_NORMAL, modes[m], seed, &pz),
+                        "Puzzle generation failed");
+
+            int a = w * w;
+            digit* grid = snewn(a, digit);
+            int* errors = snewn(a, int);
+            validate_ctx ctx = {w, grid, pz.dsf, pz.clues, modes[m]};
+
+            for (int round = 0; round < 50; round++) {
+                for (int i = 0; i < a; i++) {
+                    state = state * 1103515245 + 12345;
+                    grid[i] = (int)((state >> 16) % 8) < round % 8 ? pz.soln[i] : 0;
+                }
+                TEST_ASSERT(kenken_validate_grid(&ctx, errors) == 0,
+                            "Partial solution flagged as an error");
+            }
+
+            sfree(errors);
+            sfree(grid);
+            free_puzzle(&pz);
+        }
+    return 1;
+}
+
+/*
+ * Test 4: Whole-grid duplicate flags match a plain pairwise scan on
+ * random grids (with empty squares and plenty of repeats), 3x3 to 16x16.
+ */
+static int test_line_duplicates_match_scan(void) {
+    unsigned long state = 99;
+    int dsf[256], errors[256];
+    clue_t clues[256];
+    digit grid[256];
+
+    for (int round = 0; round < 400; round++) {
+        int w = 3 + round % 14, a = w * w;
+        validate_ctx ctx = {w, grid, dsf, clues, 0};
+
+        /* Single-cell cages matching the grid keep cage flags out of it */
+        dsf_init(dsf, a);
+        for (int i = 0; i < a; i++) {
+            state = state * 1103515245 + 12345;
+            grid[i] = (digit)((state >> 16) % (unsigned)(w + 1));
+            clues[i] = C_ADD | grid[i];
+        }
+        kenken_validate_grid(&ctx, errors);
+
+        for (int i = 0; i < a; i++) {
+            int expect = 0;
+            for (int k = 0; k < w && grid[i]; k++) {
+                if (k != i % w && grid[(i / w) * w + k] == grid[i]) expect |= VALID_ERR_ROW;
+                if (k != i / w && grid[k * w + i % w] == grid[i]) expect |= VALID_ERR_COL;
+            }
+            TEST_ASSERT(errors[i] == expect, "Duplicate flags differ from the pairwise scan");
+        }
+    }
+    return 1;
+}
+
+/*
+ * Test 5: Validating through a prebuilt cage index gives the same flags
+ * as building one per call, including for cages larger than 16 squares,
+ * and an index built for another size is not used.
+ */
+static int test_cage_index(void) {
+    int w = 6, a = w * w;
+    int dsf[36], errors[36], indexed[36];
+    clue_t clues[36];
+    digit grid[36];
+    validate_ctx ctx = {w, grid, dsf, clues, 0};
+
+    /* The first 20 squares form one cage; the rest are single cells */
+    dsf_init(dsf, a);
+    for (int i = 1; i < 20; i++) dsf_merge(dsf, 0, i);
+    int sum = 0;
+    for (int i = 0; i < a; i++) {
+        grid[i] = (digit)((i / w + i % w) % w + 1);
+        clues[i] = C_ADD | grid[i];
+        if (i < 20) sum += grid[i];
+    }
+    clues[0] = C_ADD | (clue_t)sum;
+
+    cage_index* idx = kenken_cage_index_new(w, dsf);
+    TEST_ASSERT(idx->ncages == 1 + (a - 20), "Wrong number of cages");
+    TEST_ASSERT(idx->maxsize == 20, "Wrong largest cage");
+    TEST_ASSERT(idx->start[idx->cage_of[19] + 1] - idx->start[idx->cage_of[19]] == 20,
+                "Big cage members missing");
+
+    TEST_ASSERT(kenken_validate_grid(&ctx, errors) == 0, "Correct big cage flagged");
+    grid[5] = grid[4]; /* Breaks the row and the sum */
+    kenken_validate_grid(&ctx, errors);
+    TEST_ASSERT(errors[12] & VALID_ERR_CAGE, "Wrong big cage not flagged");
+    ctx.cages = idx;
+    kenken_validate_grid(&ctx, indexed);
+    TEST_ASSERT(!memcmp(errors, indexed, sizeof(errors)), "Indexed flags differ");
+    TEST_ASSERT(kenken_validate_cell(&ctx, 5) == errors[5], "Indexed cell check differs");
+
+    /* Partly filled: the remaining squares can't make up the sum */
+    for (int i = 10; i < 20; i++) grid[i] = 0;
+    grid[5] = (digit)w;
+    kenken_validate_grid(&ctx, indexed);
+    ctx.cages = nullptr;
+    kenken_validate_grid(&ctx, errors);
+    TEST_ASSERT(!memcmp(errors, indexed, sizeof(errors)), "Indexed partial flags differ");
+
+    /* An index built for another grid size is ignored, not read past */
+    int small_dsf[16];
+    dsf_init(small_dsf, 16);
+    cage_index* small = kenken_cage_index_new(4, small_dsf);
+    TEST_ASSERT(idx->w == w && small->w == 4, "Index width not recorded");
+    ctx.cages = small;
+    kenken_validate_grid(&ctx, indexed);
+    TEST_ASSERT(!memcmp(errors, indexed, sizeof(errors)), "Mismatched index used");
+    TEST_ASSERT(kenken_validate_cell(&ctx, 5) == errors[5], "Mismatched index used for a cell");
+    kenken_cage_index_free(small);
+
+    kenken_cage_index_free(idx);
+    return 1;
+}
+
+int main(void) {
+    printf("Validation Unit Tests\n");
+    printf("=====================\n\n");
+
+    RUN_TEST(test_row_col_cage_errors);
+    RUN_TEST(test_partial_cage_feasibility);
+    RUN_TEST(test_solution_subsets_valid);
+    RUN_TEST(test_line_duplicates_match_scan);
+    RUN_TEST(test_cage_index);
+
+    printf("\n=====================\n");
+    printf("Results: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -279,6 +279,44 @@ static int test_negative_capacity(void) {
     return 1;
 }
 
+/*
+ * Test 10: Bipartite matching at order 16, as the latin square generator
+ * builds it: rows 0..15, digits 16..31, source 32, sink 33. Each row can
+ * take its own digit or the next one round, so all 16 match; with the
+ * last digit cut off from the sink only 15 do. Past 32 vertices, so it
+ * catches a visited set that is one machine word wide.
+ */
+static int test_wide_matching(void) {
+    enum { O = 16, NV = 2 * O + 2, NE = 4 * O };
+    int edges[2 * NE], capacity[NE], flow[NE], backedges[NE];
+    int ne = 0;
+
+    for (int r = 0; r < O; r++) {
+        int d0 = r, d1 = (r + 1) % O;
+        edges[2 * ne] = r, edges[2 * ne + 1] = O + (d0 < d1 ? d0 : d1), capacity[ne++] = 1;
+        edges[2 * ne] = r, edges[2 * ne + 1] = O + (d0 < d1 ? d1 : d0), capacity[ne++] = 1;
+    }
+    for (int d = 0; d < O; d++)
+        edges[2 * ne] = O + d, edges[2 * ne + 1] = 2 * O + 1, capacity[ne++] = 1;
+    for (int r = 0; r < O; r++) edges[2 * ne] = 2 * O, edges[2 * ne + 1] = r, capacity[ne++] = 1;
+
+    void* scratch = malloc((size_t)maxflow_scratch_size(NV));
+    TEST_ASSERT(scratch != NULL, "Failed to allocate scratch");
+    maxflow_setup_backedges(ne, edges, backedges);
+
+    int result =
+        maxflow_with_scratch(scratch, NV, 2 * O, 2 * O + 1, ne, edges, backedges, capacity, flow, NULL);
+    TEST_ASSERT(result == O, "Expected a perfect matching");
+
+    capacity[2 * O + O - 1] = 0; /* last digit -> sink */
+    result =
+        maxflow_with_scratch(scratch, NV, 2 * O, 2 * O + 1, ne, edges, backedges, capacity, flow, NULL);
+    free(scratch);
+    TEST_ASSERT(result == O - 1, "Expected one row unmatched");
+
+    return 1;
+}
+
 int main(void) {
     printf("Max-Flow Algorithm Unit Tests\n");
     printf("==============================\n\n");
@@ -292,6 +330,7 @@ int main(void) {
     RUN_TEST(test_single_node);
     RUN_TEST(test_linear_chain);
     RUN_TEST(test_negative_capacity);
+    RUN_TEST(test_wide_matching);
 
     printf("\n==============================\n");
     printf("Results: %d/%d tests passed\n", tests_passed, tests_run);
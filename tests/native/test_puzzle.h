@@ -0,0 +1,103 @@
+/*
+ * test_puzzle.h: Shared puzzle fixtures for the native unit tests
+ *
+ * Generates puzzles through new_game_desc and decodes the description
+ * and aux solution into the dsf/clue/solution arrays the hint and
+ * validation APIs take.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef TEST_PUZZLE_H
+#define TEST_PUZZLE_H
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keen.h"
+#include "keen_internal.h"
+#include "puzzles.h"
+
+/* A generated puzzle in the form the hint/validation APIs take. */
+typedef struct {
+    int w;
+    int* dsf;
+    clue_t* clues;
+    digit* soln;
+} test_puzzle;
+
+static clue_t op_from_letter(char c) {
+    switch (c) {
+        case 'a': return C_ADD;
+        case 's': return C_SUB;
+        case 'm': return C_MUL;
+        case 'd': return C_DIV;
+        case 'e': return C_EXP;
+        case 'o': return C_MOD;
+        case 'g': return C_GCD;
+        case 'l': return C_LCM;
+        case 'x': return C_XOR;
+        default: return C_ADD;
+    }
+}
+
+/* Decode "roots;opvalue,..." plus the "S..." solution string. */
+static int decode_puzzle(const char* desc, const char* aux, int w, test_puzzle* pz) {
+    int a = w * w;
+    const char* p = desc;
+
+    pz->w = w;
+    pz->dsf = snew_dsf(a);
+    pz->clues = snewn(a, clue_t);
+    pz->soln = snewn(a, digit);
+    memset(pz->clues, 0, (size_t)a * sizeof(clue_t));
+
+    for (int i = 0; i < a; i++) {
+        int root = (int)strtol(p, (char**)&p, 10);
+        if (root < 0 || root >= a) return 0;
+        dsf_merge(pz->dsf, root, i);
+        if (*p == ',') p++;
+    }
+    if (*p++ != ';') return 0;
+
+    for (int i = 0; i < a; i++) {
+        if (dsf_canonify(pz->dsf, i) != i) continue;
+        clue_t op = op_from_letter(*p++);
+        pz->clues[i] = op | (clue_t)strtol(p, (char**)&p, 10);
+        if (*p == ',') p++;
+    }
+
+    if (!aux || aux[0] != 'S') return 0;
+    for (int i = 0; i < a; i++) {
+        char c = aux[i + 1];
+        pz->soln[i] = (digit)(isdigit((unsigned char)c) ? c - '0' : c - 'A' + 10);
+    }
+    return 1;
+}
+
+static int make_puzzle_mode(int w, int diff, int mode_flags, const char* seed, test_puzzle* pz) {
+    game_params params = {
+        .w = w, .diff = diff, .multiplication_only = 0, .mode_flags = mode_flags, .profile = 0};
+    random_state* rs = random_new(seed, (int)strlen(seed));
+    char* aux = nullptr;
+    char* desc = new_game_desc(&params, rs, &aux, 0);
+    int ok = desc && decode_puzzle(desc, aux, w, pz);
+
+    sfree(desc);
+    sfree(aux);
+    random_free(rs);
+    return ok;
+}
+
+[[maybe_unused]] static int make_puzzle(int w, int diff, const char* seed, test_puzzle* pz) {
+    return make_puzzle_mode(w, diff, 0, seed, pz);
+}
+
+static void free_puzzle(test_puzzle* pz) {
+    sfree(pz->dsf);
+    sfree(pz->clues);
+    sfree(pz->soln);
+}
+
+#endif /* TEST_PUZZLE_H */